@@ -0,0 +1,112 @@
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+--
+--  file:    dbg_bulk_unit_read.lua
+--  brief:   compares per-unit Spring.GetUnit* calls with Spring.GetUnitsFields
+--  author:  agent
+--
+--  Copyright (C) 2026.
+--  Licensed under the terms of the GNU GPL, v2 or later.
+--
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+
+function widget:GetInfo()
+  return {
+    name      = "BulkUnitReadBench",
+    desc      = "Benchmarks per-unit vs. bulk unit reads (use with ~5000 units)",
+    author    = "agent",
+    date      = "Oct 19, 2026",
+    license   = "GNU GPL, v2 or later",
+    layer     = 0,
+    enabled   = false  --  loaded by default?
+  }
+end
+
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+--
+--  Spawn the units first, ie. "/cheat" then "/give 5000 armpw".
+--  Every 'interval' frames both read paths are timed over all
+--  visible units and the per-unit cost is echoed.
+--
+
+local interval = 90
+local rounds   = 10
+
+local spDiffTimers       = Spring.DiffTimers
+local spEcho             = Spring.Echo
+local spGetAllUnits      = Spring.GetAllUnits
+local spGetTimer         = Spring.GetTimer
+local spGetUnitDefID     = Spring.GetUnitDefID
+local spGetUnitHealth    = Spring.GetUnitHealth
+local spGetUnitPosition  = Spring.GetUnitPosition
+local spGetUnitTeam      = Spring.GetUnitTeam
+local spGetUnitsFields   = Spring.GetUnitsFields
+
+local fields = { "defID", "team", "health", "x", "y", "z" }
+local result = nil  --  reused between calls
+
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+
+local function PerUnitRead()
+  local sum = 0
+  local units = spGetAllUnits()
+  for i = 1, #units do
+    local unitID = units[i]
+    local defID  = spGetUnitDefID(unitID)
+    local team   = spGetUnitTeam(unitID)
+    local health = spGetUnitHealth(unitID)
+    local x, y, z = spGetUnitPosition(unitID)
+    sum = sum + (health or 0) + x
+  end
+  return #units, sum
+end
+
+
+local function BulkRead()
+  local sum = 0
+  local n
+  result, n = spGetUnitsFields(nil, fields, result)
+  local health, xs = result.health, result.x
+  for i = 1, n do
+    sum = sum + (health[i] or 0) + xs[i]
+  end
+  return n, sum
+end
+
+
+local function Time(func)
+  local count = 0
+  local t0 = spGetTimer()
+  for r = 1, rounds do
+    count = func()
+  end
+  return spDiffTimers(spGetTimer(), t0) / rounds, count
+end
+
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+
+function widget:GameFrame(frame)
+  if ((frame % interval) ~= 0) then
+    return
+  end
+
+  local perUnitTime, count = Time(PerUnitRead)
+  local bulkTime           = Time(BulkRead)
+  if (count == 0) then
+    return
+  end
+
+  spEcho(string.format(
+    "BulkUnitReadBench: %i units, per-unit %.3f ms (%.2f us/unit), " ..
+    "bulk %.3f ms (%.2f us/unit)",
+    count,
+    perUnitTime * 1000, perUnitTime * 1000000 / count,
+    bulkTime    * 1000, bulkTime    * 1000000 / count))
+end
+
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
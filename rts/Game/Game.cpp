@@ -40,6 +40,7 @@
 #include "CommandMessage.h"
 #include "GameSetup.h"
 #include "GameVersion.h"
+#include "LoadTasks.h"
 #include "LoadSaveHandler.h"
 #include "SelectedUnits.h"
 #include "PlayerHandler.h"
@@ -95,6 +96,7 @@
 #include "Lua/LuaUnsyncedCtrl.h"
 #include "Sim/Misc/CategoryHandler.h"
 #include "Sim/Misc/DamageArrayHandler.h"
+#include "Sim/Misc/DefsCache.h"
 #include "Sim/Features/FeatureHandler.h"
 #include "Sim/Misc/GeometricObjects.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
@@ -315,6 +317,93 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 
 	helper = new CGameHelper();
 
+	// the stages of loading, see LoadTasks.h; path costs are calculated in
+	// the background while the models are parsed and the interface is set up,
+	// the path cache files are read and written on the main thread
+	CLoadTasks loadTasks;
+	loadTasks.Add("defs", boost::bind(&CGame::LoadDefinitions, this, modName, mapname));
+	loadTasks.Add("map", boost::bind(&CGame::LoadMap, this, mapname), "defs");
+	loadTasks.Add("sim", boost::bind(&CGame::LoadSimulation, this), "map");
+	loadTasks.Add("features", boost::bind(&CGame::LoadFeatures, this, saveFile || CScriptHandler::Instance().chosenScript->loadGame), "sim");
+	loadTasks.Add("pathing", boost::bind(&CGame::LoadPathing, this), "features");
+	loadTasks.Add("pathcosts", boost::bind(&CGame::LoadPathCosts, this), "pathing", CLoadTasks::Background);
+	loadTasks.Add("models", boost::bind(&CGame::LoadModels, this), "sim");
+	loadTasks.Add("interface", boost::bind(&CGame::LoadInterface, this), "sim");
+	loadTasks.Add("pathsave", boost::bind(&CGame::SavePathCosts, this), "pathcosts");
+	// synced Lua may change the blocking map, so it has to wait for the path costs
+	loadTasks.Add("lua", boost::bind(&CGame::LoadLua, this), "pathsave models interface");
+	loadTasks.Run(mapname + " / " + modName);
+
+	delete defsParser;
+	defsParser = NULL;
+
+	CPlayer* p = playerHandler->Player(gu->myPlayerNum);
+	PrintLoadMsg("Finalizing...");
+
+	if (true || !shadowHandler->drawShadows) { // FIXME ?
+		glLightfv(GL_LIGHT1, GL_AMBIENT, mapInfo->light.unitAmbientColor);
+		glLightfv(GL_LIGHT1, GL_DIFFUSE, mapInfo->light.unitSunColor);
+		glLightfv(GL_LIGHT1, GL_SPECULAR, mapInfo->light.unitAmbientColor);
+		glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, 0);
+		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, 0);
+	}
+
+	lastframe = SDL_GetTicks();
+	lastModGameTimeMeasure = lastframe;
+	lastUpdate = lastframe;
+	lastMoveUpdate = lastframe;
+	lastUpdateRaw = lastframe;
+	updateDeltaSeconds = 0.0f;
+	script = CScriptHandler::Instance().chosenScript;
+	assert(script);
+	eventHandler.GamePreload();
+
+	glFogfv(GL_FOG_COLOR, mapInfo->atmosphere.fogColor);
+	glFogf(GL_FOG_START, 0.0f);
+	glFogf(GL_FOG_END, gu->viewRange * 0.98f);
+	glFogf(GL_FOG_DENSITY, 1.0f);
+	glFogi(GL_FOG_MODE,GL_LINEAR);
+	glEnable(GL_FOG);
+	glClearColor(mapInfo->atmosphere.fogColor[0], mapInfo->atmosphere.fogColor[1], mapInfo->atmosphere.fogColor[2], 0.0f);
+#ifdef TRACE_SYNC
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+	tracefile.NewInterval();
+#endif
+
+	activeController = this;
+
+	if (!saveFile) {
+		UnloadStartPicture();
+	}
+
+	net->loading = false;
+	thread.join();
+#ifdef USE_GML
+	logOutput.Print("Spring %s MT (%d threads)",SpringVersion::GetFull().c_str(), gmlThreadCount);
+#else
+	logOutput.Print("Spring %s",SpringVersion::GetFull().c_str());
+#endif
+	logOutput.Print("Build date/time: %s", SpringVersion::BuildTime);
+	//sending your playername to the server indicates that you are finished loading
+	net->Send(CBaseNetProtocol::Get().SendPlayerName(gu->myPlayerNum, p->name));
+
+	lastCpuUsageTime = gu->gameTime + 10;
+
+	mouse->ShowMouse();
+
+	// last in, first served
+	luaInputReceiver = new LuaInputReceiver();
+}
+
+
+void CGame::LoadDefinitions(const std::string& modName, const std::string& mapname)
+{
 	modInfo.Init(modName.c_str());
 
 	if (!sideParser.Load()) {
@@ -327,9 +416,32 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 	defsParser->GetTable("Spring");
 	defsParser->AddFunc("GetModOptions", LuaSyncedRead::GetModOptions);
 	defsParser->EndTable();
+
+	const CDefsCache defsCache(modName, mapname);
+	const bool defsCached = defsCache.IsEnabled() && defsCache.Load(*defsParser);
+	{
+		// decompress the definitions and unit scripts on all cores up front,
+		// the parser and the def handlers then read them from the cache
+		std::vector<std::string> prefetch;
+		prefetch.push_back("gamedata/");
+		if (!defsCached) {
+			prefetch.push_back("units/");
+			prefetch.push_back("weapons/");
+			prefetch.push_back("features/");
+		}
+		prefetch.push_back("scripts/");
+		vfsHandler->Prefetch(prefetch);
+	}
 	// run the parser
-	if (!defsParser->Execute()) {
-		throw content_error(defsParser->GetErrorLog());
+	if (defsCached) {
+		logOutput.Print("Using cached definitions");
+	} else {
+		if (!defsParser->Execute()) {
+			throw content_error(defsParser->GetErrorLog());
+		}
+		if (defsCache.IsEnabled()) {
+			defsCache.Save(*defsParser);
+		}
 	}
 	const LuaTable root = defsParser->GetRoot();
 	if (!root.IsValid()) {
@@ -352,7 +464,11 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 	if (!root.SubTable("MoveDefs").IsValid()) {
 		throw content_error("Error loading MoveDefs");
 	}
+}
+
 
+void CGame::LoadMap(const std::string& mapname)
+{
 	explGenHandler = new CExplosionGeneratorHandler();
 
 	shadowHandler = new CShadowHandler();
@@ -365,8 +481,11 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 	moveinfo = new CMoveInfo();
 	groundDecals = new CGroundDecalHandler();
 	ReColorTeams();
+}
 
 
+void CGame::LoadSimulation()
+{
 	guihandler = new CGuiHandler();
 	minimap = new CMiniMap();
 
@@ -398,18 +517,64 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 	unitDrawer = new CUnitDrawer();
 	fartextureHandler = new CFartextureHandler();
 	modelParser = new C3DModelParser();
+}
 
-	featureHandler->LoadFeaturesFromMap(saveFile || CScriptHandler::Instance().chosenScript->loadGame);
+
+void CGame::LoadFeatures(bool loadGame)
+{
+	{
+		// the features placed on the map need their models right away
+		PrintLoadMsg("Parsing feature models");
+		std::vector<std::string> models;
+		const std::map<std::string, const FeatureDef*>& featureDefs = featureHandler->GetFeatureDefs();
+		std::map<std::string, const FeatureDef*>::const_iterator fit;
+		for (fit = featureDefs.begin(); fit != featureDefs.end(); ++fit) {
+			if (fit->second->drawType == DRAWTYPE_3DO && !fit->second->modelname.empty()) {
+				models.push_back(fit->second->modelname);
+			}
+		}
+		modelParser->Preload(models);
+	}
+
+	featureHandler->LoadFeaturesFromMap(loadGame);
+}
+
+
+void CGame::LoadPathing()
+{
+	// needs the map and the features on it, reads the path cache files
 	pathManager = new CPathManager();
-#ifdef SYNCCHECK
-	// update the checksum with path data
-	{ SyncedUint tmp(pathManager->GetPathChecksum()); }
-#endif
-	logOutput.Print("Pathing data checksum: %08x\n", pathManager->GetPathChecksum());
+}
+
+
+void CGame::LoadPathCosts()
+{
+	// runs in the background, only if the cache files were missing or stale
+	pathManager->CalcPathCosts();
+}
 
-	delete defsParser;
-	defsParser = NULL;
 
+void CGame::SavePathCosts()
+{
+	pathManager->SavePathCosts();
+}
+
+
+void CGame::LoadModels()
+{
+	// parse the unit models on all cores now, instead of one
+	// at a time whenever one is seen for the first time in game
+	PrintLoadMsg("Parsing unit models");
+	std::vector<std::string> models;
+	for (int i = 1; i <= unitDefHandler->numUnitDefs; i++) {
+		models.push_back(unitDefHandler->unitDefs[i].modelDef.modelpath);
+	}
+	modelParser->Preload(models);
+}
+
+
+void CGame::LoadInterface()
+{
 	sky = CBaseSky::GetSky();
 
 	resourceBar = new CResourceBar();
@@ -422,8 +587,17 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 		grouphandlers[a] = new CGroupHandler(a);
 
 	globalAI = new CGlobalAIHandler();
+}
+
+
+void CGame::LoadLua()
+{
+#ifdef SYNCCHECK
+	// update the checksum with path data
+	{ SyncedUint tmp(pathManager->GetPathChecksum()); }
+#endif
+	logOutput.Print("Pathing data checksum: %08x\n", pathManager->GetPathChecksum());
 
-	CPlayer* p = playerHandler->Player(gu->myPlayerNum);
 	GameSetupDrawer::Enable();
 
 	if (gs->useLuaRules) {
@@ -438,67 +612,6 @@ CGame::CGame(std::string mapname, std::string modName, CLoadSaveHandler *saveFil
 		PrintLoadMsg("Loading LuaUI");
 		CLuaUI::LoadHandler();
 	}
-	PrintLoadMsg("Finalizing...");
-
-	if (true || !shadowHandler->drawShadows) { // FIXME ?
-		glLightfv(GL_LIGHT1, GL_AMBIENT, mapInfo->light.unitAmbientColor);
-		glLightfv(GL_LIGHT1, GL_DIFFUSE, mapInfo->light.unitSunColor);
-		glLightfv(GL_LIGHT1, GL_SPECULAR, mapInfo->light.unitAmbientColor);
-		glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, 0);
-		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, 0);
-	}
-
-	lastframe = SDL_GetTicks();
-	lastModGameTimeMeasure = lastframe;
-	lastUpdate = lastframe;
-	lastMoveUpdate = lastframe;
-	lastUpdateRaw = lastframe;
-	updateDeltaSeconds = 0.0f;
-	script = CScriptHandler::Instance().chosenScript;
-	assert(script);
-	eventHandler.GamePreload();
-
-	glFogfv(GL_FOG_COLOR, mapInfo->atmosphere.fogColor);
-	glFogf(GL_FOG_START, 0.0f);
-	glFogf(GL_FOG_END, gu->viewRange * 0.98f);
-	glFogf(GL_FOG_DENSITY, 1.0f);
-	glFogi(GL_FOG_MODE,GL_LINEAR);
-	glEnable(GL_FOG);
-	glClearColor(mapInfo->atmosphere.fogColor[0], mapInfo->atmosphere.fogColor[1], mapInfo->atmosphere.fogColor[2], 0.0f);
-#ifdef TRACE_SYNC
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-	tracefile.NewInterval();
-#endif
-
-	activeController = this;
-
-	if (!saveFile) {
-		UnloadStartPicture();
-	}
-
-	net->loading = false;
-	thread.join();
-#ifdef USE_GML
-	logOutput.Print("Spring %s MT (%d threads)",SpringVersion::GetFull().c_str(), gmlThreadCount);
-#else
-	logOutput.Print("Spring %s",SpringVersion::GetFull().c_str());
-#endif
-	logOutput.Print("Build date/time: %s", SpringVersion::BuildTime);
-	//sending your playername to the server indicates that you are finished loading
-	net->Send(CBaseNetProtocol::Get().SendPlayerName(gu->myPlayerNum, p->name));
-
-	lastCpuUsageTime = gu->gameTime + 10;
-
-	mouse->ShowMouse();
-
-	// last in, first served
-	luaInputReceiver = new LuaInputReceiver();
 }
 
 
@@ -2682,6 +2795,8 @@ bool CGame::Draw() {
 
 	eventHandler.Update();
 
+	if (luaUI) { luaUI->CollectGarbage(); }
+
 	eventHandler.DrawGenesis();
 
 	// XXX ugly hack to minimize luaUI errors
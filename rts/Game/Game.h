@@ -139,6 +139,18 @@ private:
 
 	void ReColorTeams();
 
+	/// the stages of loading, run by the constructor through CLoadTasks
+	void LoadDefinitions(const std::string& modName, const std::string& mapname);
+	void LoadMap(const std::string& mapname);
+	void LoadSimulation();
+	void LoadFeatures(bool loadGame);
+	void LoadPathing();
+	void LoadPathCosts();
+	void SavePathCosts();
+	void LoadModels();
+	void LoadInterface();
+	void LoadLua();
+
 	void ReloadCOB(const std::string& msg, int player);
 	void Skip(int toFrame);
 
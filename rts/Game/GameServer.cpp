@@ -38,6 +38,7 @@
 #include "Net/LocalConnection.h"
 #include "Net/UnpackPacket.h"
 #include "DemoReader.h"
+#include "Server/SyncResponseChecker.h"
 #include "AutohostInterface.h"
 #include "Util.h"
 #include "GlobalUnsynced.h" // for syncdebug
@@ -78,6 +79,7 @@ GameParticipant::GameParticipant()
 , ping (0)
 , lastKeyframeResponse(0)
 , isLocal(false)
+, isRelay(false)
 {
 }
 namespace {
@@ -98,7 +100,7 @@ void SetBoolArg(bool& value, const std::string& str)
 
 CGameServer* gameServer=0;
 
-CGameServer::CGameServer(const LocalSetup* settings, bool onlyLocal, const GameData* const newGameData, const CGameSetup* const mysetup)
+CGameServer::CGameServer(const LocalSetup* settings, bool onlyLocal, const GameData* const newGameData, const CGameSetup* const mysetup, bool ownThread)
 : setup(mysetup)
 {
 	assert(setup);
@@ -133,7 +135,11 @@ CGameServer::CGameServer(const LocalSetup* settings, bool onlyLocal, const GameD
 	enforceSpeed=!setup->hostDemo && configHandler.Get("EnforceGameSpeed", false);
 
 	if (!onlyLocal)
+	{
 		UDPNet.reset(new netcode::UDPListener(settings->hostport));
+		// spectators of big games get lots of small messages, which compress well
+		UDPNet->SetCompression(configHandler.Get("NetworkCompression", false));
+	}
 
 	if (settings->autohostport > 0) {
 		AddAutohostInterface(settings->autohostport);
@@ -156,6 +162,7 @@ CGameServer::CGameServer(const LocalSetup* settings, bool onlyLocal, const GameD
 
 	players.resize(setup->playerStartingData.size());
 	std::copy(setup->playerStartingData.begin(), setup->playerStartingData.end(), players.begin());
+	syncChecker.reset(new CSyncResponseChecker(MAX_PLAYERS, SYNCCHECK_TIMEOUT, configHandler.Get("SyncCheckSpectatorInterval", 16)));
 
 	RestrictedAction("kick");			RestrictedAction("kickbynum");
 	RestrictedAction("setminspeed");	RestrictedAction("setmaxspeed");
@@ -176,7 +183,10 @@ CGameServer::CGameServer(const LocalSetup* settings, bool onlyLocal, const GameD
 	RestrictedAction("luagaia");
 	RestrictedAction("singlestep");
 
-	thread = new boost::thread(boost::bind<void, CGameServer, CGameServer*>(&CGameServer::UpdateLoop, this));
+	if (ownThread)
+		thread = new boost::thread(boost::bind<void, CGameServer, CGameServer*>(&CGameServer::UpdateLoop, this));
+	else
+		thread = NULL;
 
 #ifdef STREFLOP_H
 	// Something in CGameServer::CGameServer borks the FPU control word
@@ -189,8 +199,16 @@ CGameServer::CGameServer(const LocalSetup* settings, bool onlyLocal, const GameD
 CGameServer::~CGameServer()
 {
 	quitServer=true;
-	thread->join();
-	delete thread;
+	if (thread)
+	{
+		thread->join();
+		delete thread;
+	}
+	else
+	{
+		boost::recursive_mutex::scoped_lock scoped_lock(gameServerMutex);
+		SendQuit();
+	}
 }
 
 void CGameServer::AddLocalClient(const std::string& myName, const std::string& myVersion)
@@ -271,7 +289,7 @@ void CGameServer::SendDemoData(const bool skipping)
 			serverframenum++;
 #ifdef SYNCCHECK
 			if (!skipping)
-				outstandingSyncFrames.push_back(serverframenum);
+				syncChecker->NewFrame(serverframenum);
 			CheckSync();
 #endif
 			Broadcast(boost::shared_ptr<const RawPacket>(buf));
@@ -322,80 +340,43 @@ void CGameServer::Warning(const std::string& message)
 void CGameServer::CheckSync()
 {
 #ifdef SYNCCHECK
-	// Check sync
-	std::deque<int>::iterator f = outstandingSyncFrames.begin();
-	while (f != outstandingSyncFrames.end()) {
-		std::vector<int> noSyncResponse;
-		//maps incorrect checksum to players with that checksum
-		std::map<unsigned, std::vector<int> > desyncGroups;
-		bool bComplete = true;
-		bool bGotCorrectChecksum = false;
-		unsigned correctChecksum = 0;
-		for (unsigned a = 0; a < players.size(); ++a) {
-			if (!players[a].link)
-				continue;
-			std::map<int, unsigned>::iterator it = players[a].syncResponse.find(*f);
-			if (it == players[a].syncResponse.end()) {
-				if (*f >= serverframenum - SYNCCHECK_TIMEOUT)
-					bComplete = false;
-				else
-					noSyncResponse.push_back(a);
-			} else {
-				if (!bGotCorrectChecksum) {
-					bGotCorrectChecksum = true;
-					correctChecksum = it->second;
-				} else if (it->second != correctChecksum) {
-					desyncGroups[it->second].push_back(a);
-				}
-			}
-		}
+	std::vector<CSyncResponseChecker::Desync> desyncs;
+	std::vector<CSyncResponseChecker::Missing> missing;
+	syncChecker->Update(serverframenum, desyncs, missing);
 
-		if (!noSyncResponse.empty()) {
-			if (!syncWarningFrame || (*f - syncWarningFrame > SYNCCHECK_MSG_TIMEOUT)) {
-				syncWarningFrame = *f;
+	for (std::vector<CSyncResponseChecker::Missing>::const_iterator m = missing.begin(); m != missing.end(); ++m) {
+		if (!syncWarningFrame || (m->frameNum - syncWarningFrame > SYNCCHECK_MSG_TIMEOUT)) {
+			syncWarningFrame = m->frameNum;
 
-				std::string players = GetPlayerNames(noSyncResponse);
-				Warning(str(format(NoSyncResponse) %players %(*f)));
-			}
+			std::string players = GetPlayerNames(m->players);
+			Warning(str(format(NoSyncResponse) %players %m->frameNum));
 		}
+	}
 
-		// If anything's in it, we have a desync.
-		// TODO take care of !bComplete case?
-		// Should we start resync then immediately or wait for the missing packets (while paused)?
-		if ( /*bComplete && */ !desyncGroups.empty()) {
-			if (!syncErrorFrame || (*f - syncErrorFrame > SYNCCHECK_MSG_TIMEOUT)) {
-				syncErrorFrame = *f;
+	// Should we start resync then immediately or wait for the missing packets (while paused)?
+	for (std::vector<CSyncResponseChecker::Desync>::const_iterator d = desyncs.begin(); d != desyncs.end(); ++d) {
+		if (!syncErrorFrame || (d->frameNum - syncErrorFrame > SYNCCHECK_MSG_TIMEOUT)) {
+			syncErrorFrame = d->frameNum;
 
-				// TODO enable this when we have resync
-				//serverNet->SendPause(SERVER_PLAYER, true);
+			// TODO enable this when we have resync
+			//serverNet->SendPause(SERVER_PLAYER, true);
 #ifdef SYNCDEBUG
-				CSyncDebugger::GetInstance()->ServerTriggerSyncErrorHandling(serverframenum);
-				Broadcast(CBaseNetProtocol::Get().SendPause(gu->myPlayerNum, true));
-				isPaused = true;
-				Broadcast(CBaseNetProtocol::Get().SendSdCheckrequest(serverframenum));
+			CSyncDebugger::GetInstance()->ServerTriggerSyncErrorHandling(serverframenum);
+			Broadcast(CBaseNetProtocol::Get().SendPause(gu->myPlayerNum, true));
+			isPaused = true;
+			Broadcast(CBaseNetProtocol::Get().SendSdCheckrequest(serverframenum));
 #endif
-				//For each group, output a message with list of playernames in it.
-				// TODO this should be linked to the resync system so it can roundrobin
-				// the resync checksum request packets to multiple clients in the same group.
-				std::map<unsigned, std::vector<int> >::const_iterator g = desyncGroups.begin();
-				for (; g != desyncGroups.end(); ++g) {
-					std::string players = GetPlayerNames(g->second);
-					Warning(str(format(SyncError) %players %(*f) %(g->first ^ correctChecksum)));
-				}
-			}
 		}
-
-		// Remove complete sets (for which all player's checksums have been received).
-		if (bComplete) {
-// 			if (*f >= serverframenum - SYNCCHECK_TIMEOUT)
-// 				logOutput.Print("Succesfully purged outstanding sync frame %d from the deque", *f);
-			for (unsigned a = 0; a < players.size(); ++a) {
-				if (players[a].myState >= GameParticipant::DISCONNECTED)
-					players[a].syncResponse.erase(*f);
-			}
-			f = outstandingSyncFrames.erase(f);
-		} else
-			++f;
+		if (syncErrorFrame == d->frameNum) {
+			// one message per group of players with the same checksum
+			// TODO this should be linked to the resync system so it can roundrobin
+			// the resync checksum request packets to multiple clients in the same group.
+			std::string players = GetPlayerNames(d->players);
+			if (d->other)
+				Warning(str(format(SyncErrorOther) %players %d->frameNum));
+			else
+				Warning(str(format(SyncError) %players %d->frameNum %(d->checksum ^ d->correctChecksum)));
+		}
 	}
 #else
 	// Make it clear this build isn't suitable for release.
@@ -573,6 +554,7 @@ void CGameServer::ProcessPacket(const unsigned playernum, boost::shared_ptr<cons
 			Broadcast(CBaseNetProtocol::Get().SendPlayerLeft(a, 1));
 			players[a].myState = GameParticipant::DISCONNECTED;
 			players[a].link.reset();
+			syncChecker->RemovePlayer(a);
 			if (hostif)
 			{
 				hostif->SendPlayerLeft(a, 1);
@@ -706,9 +688,8 @@ void CGameServer::ProcessPacket(const unsigned playernum, boost::shared_ptr<cons
 				Warning(str(format(WrongPlayer) %(unsigned)inbuf[0] %a %(unsigned)inbuf[1]));
 			} else {
 				int frameNum = *(int*)&inbuf[2];
-				if (outstandingSyncFrames.empty() || frameNum >= outstandingSyncFrames.front())
-					players[a].syncResponse[frameNum] = *(unsigned*)&inbuf[6];
-				else if (serverframenum - delayedSyncResponseFrame > SYNCCHECK_MSG_TIMEOUT) {
+				if (!syncChecker->AddResponse(a, frameNum, *(unsigned*)&inbuf[6])
+						&& serverframenum - delayedSyncResponseFrame > SYNCCHECK_MSG_TIMEOUT) {
 					delayedSyncResponseFrame = serverframenum;
 					Warning(str(format(DelayedSyncResponse) %players[a].name %frameNum %serverframenum));
 				}
@@ -802,6 +783,7 @@ void CGameServer::ProcessPacket(const unsigned playernum, boost::shared_ptr<cons
 						}
 						players[player].team = 0;
 						players[player].spectator = true;
+						syncChecker->AddPlayer(player, false);
 						if (hostif) hostif->SendPlayerDefeated(player);
 						break;
 					}
@@ -809,6 +791,7 @@ void CGameServer::ProcessPacket(const unsigned playernum, boost::shared_ptr<cons
 						Broadcast(CBaseNetProtocol::Get().SendResign(player));
 						players[player].team = 0;
 						players[player].spectator = true;
+						syncChecker->AddPlayer(player, false);
 						if (hostif) hostif->SendPlayerDefeated(player);
 						break;
 					}
@@ -842,6 +825,8 @@ void CGameServer::ProcessPacket(const unsigned playernum, boost::shared_ptr<cons
 								{
 									players[i].team = 0;
 									players[i].spectator = true;
+									if (players[i].link && !players[i].isRelay)
+										syncChecker->AddPlayer(i, false);
 									if (hostif) hostif->SendPlayerDefeated(i);
 								}
 							}
@@ -934,7 +919,10 @@ void CGameServer::ServerReadNet()
 			std::string name, version;
 			msg >> name;
 			msg >> version;
-			BindConnection(name, version, false, UDPNet->AcceptConnection());
+			unsigned char isRelay = 0;
+			if (packet->length > 5 + name.size() + version.size())
+				msg >> isRelay;
+			BindConnection(name, version, false, UDPNet->AcceptConnection(), isRelay != 0);
 		}
 		else
 		{
@@ -957,6 +945,7 @@ void CGameServer::ServerReadNet()
 			Message(str(format(PlayerLeft) %players[a].name %" timeout")); //this must happen BEFORE the reset!
 			players[a].myState = GameParticipant::DISCONNECTED;
 			players[a].link.reset();
+			syncChecker->RemovePlayer(a);
 			Broadcast(CBaseNetProtocol::Get().SendPlayerLeft(a, 0));
 			if (hostif)
 			{
@@ -1174,7 +1163,7 @@ void CGameServer::PushAction(const Action& action)
 	else if (action.command == "singlestep")
 	{
 		if (isPaused && !demoReader)
-			gameServer->CreateNewFrame(true, true);
+			CreateNewFrame(true, true);
 	}
 #ifdef DEDICATED // we already have a quit command in the client
 	else if (action.command == "kill")
@@ -1319,7 +1308,7 @@ void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 				else
 					Broadcast(CBaseNetProtocol::Get().SendNewFrame());
 #ifdef SYNCCHECK
-				outstandingSyncFrames.push_back(serverframenum);
+				syncChecker->NewFrame(serverframenum);
 #endif
 			}
 		}
@@ -1347,19 +1336,34 @@ void CGameServer::UpdateLoop()
 			hasData = UDPNet->HasIncomingData(10); // may block up to 10 ms if there is no data (don't need a lock)
 		}
 
-		if (UDPNet)
-			UDPNet->Update();
-
-		boost::recursive_mutex::scoped_lock scoped_lock(gameServerMutex);
-		if (hasData)
-			ServerReadNet(); // new data arrived, we may have new packets
-		Update();
+		Poll(hasData);
 	}
+	SendQuit();
+}
+
+void CGameServer::Poll(bool hasData)
+{
+	if (UDPNet)
+		UDPNet->Update();
+
+	boost::recursive_mutex::scoped_lock scoped_lock(gameServerMutex);
+	if (hasData)
+		ServerReadNet(); // new data arrived, we may have new packets
+	Update();
+}
+
+void CGameServer::SendQuit()
+{
 	if (hostif)
 		hostif->SendQuit();
 	Broadcast(CBaseNetProtocol::Get().SendQuit());
 }
 
+int CGameServer::GetSocketFD() const
+{
+	return (UDPNet ? UDPNet->GetSocketFD() : -1);
+}
+
 bool CGameServer::WaitsOnCon() const
 {
 	return (UDPNet && UDPNet->Listen());
@@ -1379,6 +1383,7 @@ void CGameServer::KickPlayer(const int playerNum)
 		players[playerNum].link->SendData(CBaseNetProtocol::Get().SendQuit());
 		players[playerNum].link.reset();
 		players[playerNum].myState = GameParticipant::DISCONNECTED;
+		syncChecker->RemovePlayer(playerNum);
 		if (hostif)
 		{
 			hostif->SendPlayerLeft(playerNum, 2);
@@ -1388,7 +1393,7 @@ void CGameServer::KickPlayer(const int playerNum)
 		Message(str( format("Attempt to kick player %d who is not connected") %playerNum ));
 }
 
-unsigned CGameServer::BindConnection(std::string name, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link)
+unsigned CGameServer::BindConnection(std::string name, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link, bool isRelay)
 {
 	unsigned hisNewNumber = 0;
 	bool found = false;
@@ -1441,8 +1446,18 @@ unsigned CGameServer::BindConnection(std::string name, const std::string& versio
 		}
 	}
 
+	if (isRelay && !players[hisNewNumber].spectator)
+	{
+		// relays are not sync checked, so only spectators may claim to be one
+		Message(str(format("Player %s is not a spectator, ignoring its relay flag") %name));
+		isRelay = false;
+	}
+
 	players[hisNewNumber].link = link;
 	players[hisNewNumber].isLocal = isLocal;
+	players[hisNewNumber].isRelay = isRelay;
+	if (!isRelay) // relays don't simulate
+		syncChecker->AddPlayer(hisNewNumber, !players[hisNewNumber].spectator);
 
 	link->SendData(boost::shared_ptr<const RawPacket>(gameData->Pack()));
 	link->SendData(CBaseNetProtocol::Get().SendSetPlayerNum((unsigned char)hisNewNumber));
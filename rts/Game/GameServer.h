@@ -25,6 +25,7 @@ namespace netcode
 	class UDPListener;
 }
 class CDemoReader;
+class CSyncResponseChecker;
 class AutohostInterface;
 class CGameSetup;
 class LocalSetup;
@@ -53,10 +54,9 @@ public:
 	int lastKeyframeResponse;
 
 	bool isLocal;
+	/// spectator relay (CGameRelay), forwards our stream to its own spectators
+	bool isRelay;
 	boost::shared_ptr<netcode::CConnection> link;
-#ifdef SYNCCHECK
-	std::map<int, unsigned> syncResponse; // syncResponse[frameNum] = checksum
-#endif
 };
 
 class GameTeam
@@ -75,7 +75,10 @@ class CGameServer : public CommandReceiver
 {
 	friend class CLoadSaveHandler;     //For initialize server state after load
 public:
-	CGameServer(const LocalSetup* settings, bool onlyLocal, const GameData* const gameData, const CGameSetup* const setup);
+	/**
+	@param ownThread if false, no server thread is started and the owner has to call Poll() regularly (used to run several games in one process)
+	*/
+	CGameServer(const LocalSetup* settings, bool onlyLocal, const GameData* const gameData, const CGameSetup* const setup, bool ownThread = true);
 	virtual ~CGameServer();
 
 	void AddLocalClient(const std::string& myName, const std::string& myVersion);
@@ -101,6 +104,16 @@ public:
 	/// Is the server still running?
 	bool HasFinished() const;
 
+	/**
+	@brief Run one iteration of the server loop
+	Only for servers created without their own thread.
+	@param hasData whether the caller saw incoming data on our socket
+	*/
+	void Poll(bool hasData);
+
+	/// native handle of our UDP socket, for callers multiplexing several servers (-1 if there is none)
+	int GetSocketFD() const;
+
 #ifdef DEBUG
 	bool gameClientUpdated;			//used to prevent the server part to update to fast when the client is mega slow (running some sort of debug mode)
 #endif
@@ -119,12 +132,14 @@ private:
 	*/
 	void KickPlayer(const int playerNum);
 
-	unsigned BindConnection(std::string name, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link);
+	unsigned BindConnection(std::string name, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link, bool isRelay = false);
 
 	void CheckForGameStart(bool forced=false);
 	void StartGame();
 	void UpdateLoop();
 	void Update();
+	/// tell clients and autohost that we are going down
+	void SendQuit();
 	void ProcessPacket(const unsigned playernum, boost::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
 	void ServerReadNet();
@@ -190,9 +205,7 @@ private:
 	bool noHelperAIs;
 
 	/////////////////// sync stuff ///////////////////
-#ifdef SYNCCHECK
-	std::deque<int> outstandingSyncFrames;
-#endif
+	boost::scoped_ptr<CSyncResponseChecker> syncChecker;
 	int syncErrorFrame;
 	int syncWarningFrame;
 	int delayedSyncResponseFrame;
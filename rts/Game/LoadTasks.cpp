@@ -0,0 +1,156 @@
+#include "StdAfx.h"
+#include "LoadTasks.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <SDL_timer.h>
+
+#include "mmgr.h"
+
+#include "LogOutput.h"
+#include "Exceptions.h"
+#include "Rendering/GL/myGL.h"
+
+void CLoadTasks::Add(const std::string& name, const Task& task, const std::string& after, Where where)
+{
+	Entry entry;
+	entry.name = name;
+	entry.task = task;
+	entry.where = where;
+	entry.state = Entry::Waiting;
+	entry.start = entry.end = 0;
+
+	std::istringstream names(after);
+	std::string dep;
+	while (names >> dep) {
+		unsigned i = 0;
+		while (i < tasks.size() && tasks[i].name != dep)
+			++i;
+		if (i == tasks.size())
+			throw std::runtime_error("CLoadTasks: " + name + " waits for unknown task " + dep);
+		entry.after.push_back(i);
+	}
+	tasks.push_back(entry);
+}
+
+bool CLoadTasks::IsReady(const Entry& entry) const
+{
+	for (unsigned d = 0; d < entry.after.size(); ++d) {
+		if (tasks[entry.after[d]].state != Entry::Done)
+			return false;
+	}
+	return true;
+}
+
+void CLoadTasks::RunBackground(unsigned i)
+{
+	streflop_init<streflop::Simple>();
+	DeferLoadMsgs();
+
+	Entry& entry = tasks[i];
+	std::string what;
+	bool content = false;
+	try {
+		entry.task();
+	} catch (const content_error& e) {
+		what = e.what();
+		content = true;
+	} catch (const std::exception& e) {
+		what = e.what();
+	} catch (...) {
+		what = "unknown exception";
+	}
+
+	boost::mutex::scoped_lock lock(mutex);
+	entry.end = SDL_GetTicks();
+	entry.state = Entry::Done;
+	if (!what.empty() && error.empty()) {
+		error = entry.name + ": " + what;
+		contentError = content;
+	}
+}
+
+void CLoadTasks::Run(const std::string& title)
+{
+	const unsigned start = SDL_GetTicks();
+	std::vector<boost::thread*> threads;
+
+	try {
+		while (true) {
+			int next = -1; // main thread task to run
+			bool finished = true;
+			bool started = false;
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				if (!error.empty())
+					break;
+				for (unsigned i = 0; i < tasks.size(); ++i) {
+					Entry& entry = tasks[i];
+					if (entry.state != Entry::Done)
+						finished = false;
+					if (entry.state != Entry::Waiting || !IsReady(entry))
+						continue;
+					if (entry.where == Background) {
+						entry.state = Entry::Running;
+						entry.start = SDL_GetTicks();
+						threads.push_back(new boost::thread(boost::bind(&CLoadTasks::RunBackground, this, i)));
+						started = true;
+					} else if (next < 0) {
+						next = i;
+					}
+				}
+			}
+			if (finished)
+				break;
+
+			PrintDeferredLoadMsg();
+			if (next >= 0) {
+				// the background tasks never touch main thread tasks, no lock needed
+				Entry& entry = tasks[next];
+				entry.state = Entry::Running;
+				entry.start = SDL_GetTicks();
+				entry.task();
+				boost::mutex::scoped_lock lock(mutex);
+				entry.end = SDL_GetTicks();
+				entry.state = Entry::Done;
+			} else if (!started) {
+				// everything left waits for a background task
+				SDL_Delay(50);
+			}
+		}
+	} catch (...) {
+		// the threads use what the failed task left behind, let them finish first
+		for (unsigned t = 0; t < threads.size(); ++t) {
+			threads[t]->join();
+			delete threads[t];
+		}
+		PrintDeferredLoadMsg();
+		throw;
+	}
+
+	for (unsigned t = 0; t < threads.size(); ++t) {
+		threads[t]->join();
+		delete threads[t];
+	}
+	PrintDeferredLoadMsg();
+
+	if (!error.empty()) {
+		if (contentError)
+			throw content_error(error);
+		throw std::runtime_error(error);
+	}
+	LogTimes(title, start);
+}
+
+void CLoadTasks::LogTimes(const std::string& title, unsigned start) const
+{
+	logOutput.Print("Load times for %s:", title.c_str());
+	for (unsigned i = 0; i < tasks.size(); ++i) {
+		const Entry& entry = tasks[i];
+		logOutput.Print("  %-12s %-10s start %6u ms, took %6u ms", entry.name.c_str(),
+			(entry.where == Background) ? "background" : "main", entry.start - start, entry.end - entry.start);
+	}
+	logOutput.Print("  total %u ms", SDL_GetTicks() - start);
+}
@@ -0,0 +1,70 @@
+#ifndef LOADTASKS_H
+#define LOADTASKS_H
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+@brief Runs the stages of loading a game in dependency order
+Every task names the tasks it has to wait for. Tasks on the main thread
+(everything touching GL or the VFS) run in the order they were added as soon
+as what they wait for is done. Background tasks get a thread of their own and
+overlap with every task not waiting for them; their load messages are shown
+by the main thread (see DeferLoadMsgs). The time spent in each task is logged
+at the end.
+*/
+class CLoadTasks : boost::noncopyable
+{
+public:
+	typedef boost::function<void()> Task;
+	enum Where { MainThread, Background };
+
+	CLoadTasks() : contentError(false) {}
+
+	/**
+	@param name short name for the log
+	@param after space separated names of tasks to wait for, these must have been added already
+	*/
+	void Add(const std::string& name, const Task& task, const std::string& after = "", Where where = MainThread);
+
+	/**
+	@brief Run all tasks
+	If one of them throws, the ones still running are waited for and the
+	exception is passed on (as content_error or std::runtime_error for
+	background tasks).
+	@param title what is being loaded, heads the timing table
+	*/
+	void Run(const std::string& title);
+
+private:
+	struct Entry
+	{
+		std::string name;
+		Task task;
+		/// indices of the tasks to wait for
+		std::vector<unsigned> after;
+		Where where;
+		enum { Waiting, Running, Done } state;
+		/// SDL_GetTicks() when started and finished
+		unsigned start;
+		unsigned end;
+	};
+
+	/// thread function of background tasks
+	void RunBackground(unsigned i);
+	/// @return whether all tasks entry waits for are done, lock mutex first
+	bool IsReady(const Entry& entry) const;
+	void LogTimes(const std::string& title, unsigned start) const;
+
+	std::vector<Entry> tasks;
+	/// guards the state and times of background tasks and the error
+	boost::mutex mutex;
+	/// message of the first background task that failed
+	std::string error;
+	bool contentError;
+};
+
+#endif
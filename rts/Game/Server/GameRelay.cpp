@@ -0,0 +1,217 @@
+#include "GameRelay.h"
+
+#include <SDL_timer.h>
+
+#include "Net/UDPListener.h"
+#include "Net/UDPConnection.h"
+#include "Net/UDPSocket.h"
+#include "Net/RawPacket.h"
+#include "Net/UnpackPacket.h"
+#include "BaseNetProtocol.h"
+#include "LogOutput.h"
+#include "Game/GameVersion.h"
+
+using netcode::RawPacket;
+
+namespace {
+/// don't queue more than this per spectator and update while catching up
+const unsigned maxBurstBytes = 64 * 1024;
+}
+
+CGameRelay::CGameRelay(const std::string& hostAddress, int hostPort, const std::string& name, int listenPort, unsigned _delay, unsigned _maxBacklog)
+: hostQuit(false)
+, backlogStart(0)
+, backlogBytes(0)
+, joinable(true)
+, delay(_delay)
+, maxBacklog(_maxBacklog)
+{
+	boost::shared_ptr<netcode::UDPSocket> sock(new netcode::UDPSocket(0));
+	sock->SetBlocking(false);
+	host.reset(new netcode::UDPConnection(sock, hostAddress, hostPort));
+	host->SendData(CBaseNetProtocol::Get().SendAttemptConnect(name, SpringVersion::GetFull(), true));
+	host->Flush(true);
+
+	listener.reset(new netcode::UDPListener(listenPort));
+	logOutput.Print("Relaying %s:%i on port %i (delay %u ms)", hostAddress.c_str(), hostPort, listenPort, delay);
+}
+
+CGameRelay::~CGameRelay()
+{
+	if (!hostQuit)
+	{
+		host->SendData(CBaseNetProtocol::Get().SendQuit());
+		host->Flush(true);
+	}
+	for (std::vector<Spectator>::iterator it = spectators.begin(); it != spectators.end(); ++it)
+	{
+		it->link->SendData(CBaseNetProtocol::Get().SendQuit());
+		it->link->Flush(true);
+	}
+}
+
+void CGameRelay::Update()
+{
+	const unsigned now = SDL_GetTicks();
+
+	if (!hostQuit)
+		ReadHost();
+	TrimBacklog();
+	listener->Update();
+	AcceptSpectators();
+
+	for (std::vector<Spectator>::iterator it = spectators.begin(); it != spectators.end(); )
+	{
+		ServeSpectator(*it, now);
+
+		bool leaving = it->link->CheckTimeout();
+		boost::shared_ptr<const RawPacket> packet;
+		while ((packet = it->link->GetData()))
+		{
+			if (packet->length > 0 && packet->data[0] == NETMSG_QUIT)
+				leaving = true;
+			// everything else is dropped, spectators of a relay have no say in the game
+		}
+		if (leaving)
+		{
+			logOutput.Print("Spectator left relay (%s)", it->link->Statistics().c_str());
+			it = spectators.erase(it);
+		}
+		else
+		{
+			it->link->Flush(false);
+			++it;
+		}
+	}
+}
+
+bool CGameRelay::HasFinished() const
+{
+	if (!hostQuit)
+		return false;
+	for (std::vector<Spectator>::const_iterator it = spectators.begin(); it != spectators.end(); ++it)
+	{
+		if (it->next < backlogStart + backlog.size() || !it->link->IsDrained())
+			return false;
+	}
+	return true;
+}
+
+unsigned CGameRelay::NumSpectators() const
+{
+	return spectators.size();
+}
+
+void CGameRelay::ReadHost()
+{
+	host->Update();
+	const unsigned now = SDL_GetTicks();
+
+	boost::shared_ptr<const RawPacket> packet;
+	while ((packet = host->GetData()))
+	{
+		if (packet->length == 0)
+			continue;
+
+		switch (packet->data[0])
+		{
+			case NETMSG_KEYFRAME:
+				// the server needs this to keep track of our lag, spectators answer to us
+				host->SendData(CBaseNetProtocol::Get().SendKeyFrame(*(int*)&packet->data[1]));
+				break;
+			case NETMSG_QUIT:
+				logOutput.Print("Host quit, relaying the rest of the game");
+				hostQuit = true;
+				break;
+			default:
+				break;
+		}
+
+		LoggedPacket logged;
+		logged.time = now;
+		logged.packet = packet;
+		backlog.push_back(logged);
+		backlogBytes += packet->length;
+	}
+
+	if (!hostQuit && host->CheckTimeout())
+	{
+		logOutput.Print("Lost connection to host");
+		LoggedPacket logged;
+		logged.time = now;
+		logged.packet = CBaseNetProtocol::Get().SendQuit();
+		backlog.push_back(logged);
+		backlogBytes += logged.packet->length;
+		hostQuit = true;
+	}
+	host->Flush(false);
+}
+
+void CGameRelay::AcceptSpectators()
+{
+	while (listener->HasIncomingConnections())
+	{
+		boost::shared_ptr<netcode::UDPConnection> prev = listener->PreviewConnection().lock();
+		boost::shared_ptr<const RawPacket> packet = prev->GetData();
+
+		if (packet && packet->length >= 3 && packet->data[0] == NETMSG_ATTEMPTCONNECT && joinable)
+		{
+			netcode::UnpackPacket msg(packet, 3);
+			std::string name;
+			msg >> name;
+			Spectator spec;
+			spec.link = listener->AcceptConnection();
+			spec.next = 0;
+			spectators.push_back(spec);
+			logOutput.Print("Spectator %s connected to relay (%u total)", name.c_str(), (unsigned)spectators.size());
+		}
+		else
+		{
+			listener->RejectConnection();
+		}
+	}
+}
+
+void CGameRelay::ServeSpectator(Spectator& spec, unsigned now)
+{
+	unsigned sent = 0;
+	while (spec.next < backlogStart + backlog.size() && sent < maxBurstBytes)
+	{
+		const LoggedPacket& logged = backlog[spec.next - backlogStart];
+		if (logged.time + delay > now)
+			break;
+		spec.link->SendData(logged.packet);
+		sent += logged.packet->length;
+		++spec.next;
+	}
+}
+
+void CGameRelay::TrimBacklog()
+{
+	if (backlogBytes <= maxBacklog)
+		return;
+
+	if (joinable)
+	{
+		logOutput.Print("Relay backlog reached %u KB, not accepting more spectators", maxBacklog / 1024);
+		joinable = false;
+	}
+	while (backlogBytes > maxBacklog && !backlog.empty())
+	{
+		for (std::vector<Spectator>::iterator it = spectators.begin(); it != spectators.end(); )
+		{
+			if (it->next == backlogStart)
+			{
+				logOutput.Print("Spectator fell too far behind, dropping it (%s)", it->link->Statistics().c_str());
+				it->link->SendData(CBaseNetProtocol::Get().SendQuit());
+				it->link->Flush(true);
+				it = spectators.erase(it);
+			}
+			else
+				++it;
+		}
+		backlogBytes -= backlog.front().packet->length;
+		backlog.pop_front();
+		++backlogStart;
+	}
+}
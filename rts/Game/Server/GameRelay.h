@@ -0,0 +1,97 @@
+#ifndef GAMERELAY_H
+#define GAMERELAY_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace netcode
+{
+	class RawPacket;
+	class CConnection;
+	class UDPConnection;
+	class UDPListener;
+}
+
+/**
+@brief Fans one game stream out to many spectators
+The relay connects to a CGameServer as a single client (flagged as relay in
+NETMSG_ATTEMPTCONNECT, so the server does not expect sync responses from it)
+and records everything the server sends. Spectators connect to the relay
+instead of the server and get the recorded stream replayed from the start, so
+late joiners catch up like they would on the server itself. With a delay set,
+spectators only see messages older than that, which hides live information
+from players watching their own game.
+
+The recorded stream is kept up to a size limit. Beyond that the relay stops
+accepting spectators, forgets messages every spectator was sent and drops
+spectators that fall too far behind.
+
+Spectators are read-only: everything they send except NETMSG_QUIT is dropped.
+The name in their NETMSG_ATTEMPTCONNECT is only logged, and since the
+NETMSG_SETPLAYERNUM the server sent the relay is replayed too, every
+spectator takes on the relay's player number.
+*/
+class CGameRelay : boost::noncopyable
+{
+public:
+	/**
+	@param hostAddress address of the game server
+	@param hostPort port of the game server
+	@param name player name to connect with (must be a spectator in the script)
+	@param listenPort port spectators connect to
+	@param delay milliseconds the spectator stream lags behind the game
+	@param maxBacklog bytes of the recorded stream to keep
+	*/
+	CGameRelay(const std::string& hostAddress, int hostPort, const std::string& name, int listenPort, unsigned delay = 0, unsigned maxBacklog = 128 * 1024 * 1024);
+	~CGameRelay();
+
+	/// Receive from the host, accept spectators and send them what is due
+	void Update();
+
+	/// The host has quit and every spectator got the whole stream
+	bool HasFinished() const;
+
+	unsigned NumSpectators() const;
+	/// Number of messages received from the host so far, including forgotten ones
+	unsigned NumBacklogMessages() const { return backlogStart + backlog.size(); }
+
+private:
+	struct Spectator
+	{
+		boost::shared_ptr<netcode::UDPConnection> link;
+		/// number of the next message to send, counted from the start of the game
+		unsigned next;
+	};
+	struct LoggedPacket
+	{
+		unsigned time;
+		boost::shared_ptr<const netcode::RawPacket> packet;
+	};
+
+	void ReadHost();
+	void AcceptSpectators();
+	void ServeSpectator(Spectator& spec, unsigned now);
+	/// forget old messages while the backlog is over maxBacklog
+	void TrimBacklog();
+
+	boost::shared_ptr<netcode::CConnection> host;
+	bool hostQuit;
+	std::deque<LoggedPacket> backlog;
+	/// number of the first message in backlog
+	unsigned backlogStart;
+	unsigned backlogBytes;
+	/// false once messages were forgotten, late joiners could not catch up
+	bool joinable;
+
+	boost::scoped_ptr<netcode::UDPListener> listener;
+	std::vector<Spectator> spectators;
+
+	const unsigned delay;
+	const unsigned maxBacklog;
+};
+
+#endif
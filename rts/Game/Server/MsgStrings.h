@@ -16,6 +16,7 @@ const std::string NoClientsExit = "No clients connected, shutting down server";
 const std::string NoSyncResponse = "No sync response from %s for frame %d";
 const std::string DelayedSyncResponse = "Delayed response from %s for frame %d (current %d)";
 const std::string SyncError = "Sync error for %s in frame %d (%x)";
+const std::string SyncErrorOther = "Sync error for %s in frame %d (other checksums)";
 const std::string NoSyncCheck = "Warning: Sync checking disabled!";
 
 const std::string NewConnection = "Player %s connected with number %d (client version %s)";
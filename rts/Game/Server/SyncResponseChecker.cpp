@@ -0,0 +1,224 @@
+#include "SyncResponseChecker.h"
+
+#include <string.h>
+#include <algorithm>
+
+const unsigned char CSyncResponseChecker::NO_RESPONSE;
+const int CSyncResponseChecker::MAX_GROUPS;
+const int CSyncResponseChecker::OTHER_GROUP;
+
+CSyncResponseChecker::CSyncResponseChecker(int _maxPlayers, int _timeout, int _spectatorInterval)
+: maxPlayers(_maxPlayers)
+, timeout(_timeout)
+, spectatorInterval(std::max(_spectatorInterval, 1))
+, playerState(_maxPlayers, NOT_CONNECTED)
+, requiredSince(_maxPlayers, 0)
+, numRequired(0)
+, firstOutstanding(1)
+, lastFrame(0)
+{
+	// frames stay in the ring for a while after the timeout decided them,
+	// so late responses can still be compared
+	const int ringSize = std::max(2 * timeout, 64);
+	frames.resize(ringSize);
+	for (std::vector<Frame>::iterator f = frames.begin(); f != frames.end(); ++f) {
+		f->frameNum = -1;
+		f->decided = true;
+	}
+	groups.resize(ringSize * maxPlayers, NO_RESPONSE);
+}
+
+void CSyncResponseChecker::AddPlayer(int player, bool required)
+{
+	if (player < 0 || player >= maxPlayers)
+		return;
+	RemovePlayer(player);
+
+	if (required) {
+		playerState[player] = REQUIRED;
+		requiredSince[player] = lastFrame + 1;
+		++numRequired;
+	} else {
+		playerState[player] = SAMPLED;
+	}
+}
+
+void CSyncResponseChecker::RemovePlayer(int player)
+{
+	if (player < 0 || player >= maxPlayers)
+		return;
+
+	if (playerState[player] == REQUIRED) {
+		// don't wait for him any longer
+		for (int f = firstOutstanding; f <= lastFrame; ++f) {
+			Frame& frame = Slot(f);
+			if (frame.frameNum == f && !frame.decided && RequiredFor(player, f) && Group(f, player) == NO_RESPONSE)
+				--frame.numMissing;
+		}
+		--numRequired;
+	}
+	playerState[player] = NOT_CONNECTED;
+}
+
+void CSyncResponseChecker::NewFrame(int frameNum)
+{
+	if (frameNum <= lastFrame)
+		return;
+
+	// make room, only happens if Update() wasn't called for a long time
+	const int ringSize = frames.size();
+	for (; firstOutstanding <= frameNum - ringSize; ++firstOutstanding) {
+		Frame& old = Slot(firstOutstanding);
+		if (old.frameNum == firstOutstanding && !old.decided)
+			Decide(old, lateDesyncs, lateMissing);
+	}
+
+	Frame& frame = Slot(frameNum);
+	frame.frameNum = frameNum;
+	frame.decided = false;
+	frame.numMissing = numRequired;
+	frame.numGroups = 0;
+	frame.count[OTHER_GROUP] = 0;
+	frame.correctGroup = -1;
+	memset(&Group(frameNum, 0), NO_RESPONSE, maxPlayers);
+
+	lastFrame = frameNum;
+}
+
+bool CSyncResponseChecker::AddResponse(int player, int frameNum, unsigned checksum)
+{
+	if (player < 0 || player >= maxPlayers || playerState[player] == NOT_CONNECTED || frameNum > lastFrame)
+		return true;
+	if (frameNum <= lastFrame - (int)frames.size())
+		return false;
+
+	Frame& frame = Slot(frameNum);
+	if (frame.frameNum != frameNum)
+		return true; // not checked (skipped demo frames)
+	if (playerState[player] == SAMPLED && (frameNum % spectatorInterval) != 0)
+		return true;
+
+	unsigned char& group = Group(frameNum, player);
+	if (group != NO_RESPONSE)
+		return true; // duplicate
+
+	group = AddToGroup(frame, checksum);
+	if (RequiredFor(player, frameNum) && frame.numMissing > 0)
+		--frame.numMissing;
+
+	if (frame.decided && group != frame.correctGroup) {
+		Desync d;
+		d.frameNum = frameNum;
+		d.correctChecksum = frame.checksum[frame.correctGroup];
+		d.checksum = checksum;
+		d.other = false;
+		d.players.push_back(player);
+		lateDesyncs.push_back(d);
+	}
+	return true;
+}
+
+void CSyncResponseChecker::Update(int serverFrame, std::vector<Desync>& desyncs, std::vector<Missing>& missing)
+{
+	desyncs.insert(desyncs.end(), lateDesyncs.begin(), lateDesyncs.end());
+	missing.insert(missing.end(), lateMissing.begin(), lateMissing.end());
+	lateDesyncs.clear();
+	lateMissing.clear();
+
+	for (; firstOutstanding <= lastFrame; ++firstOutstanding) {
+		Frame& frame = Slot(firstOutstanding);
+		if (frame.frameNum != firstOutstanding || frame.decided)
+			continue;
+		if (frame.numMissing > 0 && firstOutstanding >= serverFrame - timeout)
+			break; // wait for the rest
+		Decide(frame, desyncs, missing);
+	}
+}
+
+int CSyncResponseChecker::NumOutstanding() const
+{
+	return lastFrame + 1 - firstOutstanding;
+}
+
+bool CSyncResponseChecker::RequiredFor(int player, int frameNum) const
+{
+	return playerState[player] == REQUIRED && frameNum >= requiredSince[player];
+}
+
+int CSyncResponseChecker::AddToGroup(Frame& frame, unsigned checksum)
+{
+	for (int g = 0; g < frame.numGroups; ++g) {
+		if (frame.checksum[g] == checksum) {
+			++frame.count[g];
+			return g;
+		}
+	}
+	if (frame.numGroups == OTHER_GROUP) {
+		// lots of different checksums, lump the rest together
+		++frame.count[OTHER_GROUP];
+		return OTHER_GROUP;
+	}
+	frame.checksum[frame.numGroups] = checksum;
+	frame.count[frame.numGroups] = 1;
+	return frame.numGroups++;
+}
+
+void CSyncResponseChecker::Decide(Frame& frame, std::vector<Desync>& desyncs, std::vector<Missing>& missing)
+{
+	const int f = frame.frameNum;
+	frame.decided = true;
+
+	if (frame.numMissing > 0) {
+		Missing m;
+		m.frameNum = f;
+		for (int p = 0; p < maxPlayers; ++p) {
+			if (RequiredFor(p, f) && Group(f, p) == NO_RESPONSE)
+				m.players.push_back(p);
+		}
+		if (!m.players.empty())
+			missing.push_back(m);
+	}
+
+	if (frame.numGroups == 0) {
+		frame.correctGroup = 0;
+		frame.checksum[0] = 0;
+		return;
+	}
+
+	// majority vote, ties go to the checksum which arrived first; the lumped
+	// together players don't agree on anything so they can't win
+	int best = 0;
+	for (int g = 1; g < frame.numGroups; ++g) {
+		if (frame.count[g] > frame.count[best])
+			best = g;
+	}
+	frame.correctGroup = best;
+
+	// only in case of a desync we need to know who sent what
+	for (int g = 0; g < frame.numGroups; ++g) {
+		if (g == best)
+			continue;
+		Desync d;
+		d.frameNum = f;
+		d.correctChecksum = frame.checksum[best];
+		d.checksum = frame.checksum[g];
+		d.other = false;
+		for (int p = 0; p < maxPlayers; ++p) {
+			if (Group(f, p) == g)
+				d.players.push_back(p);
+		}
+		desyncs.push_back(d);
+	}
+	if (frame.count[OTHER_GROUP] > 0) {
+		Desync d;
+		d.frameNum = f;
+		d.correctChecksum = frame.checksum[best];
+		d.checksum = 0;
+		d.other = true;
+		for (int p = 0; p < maxPlayers; ++p) {
+			if (Group(f, p) == OTHER_GROUP)
+				d.players.push_back(p);
+		}
+		desyncs.push_back(d);
+	}
+}
@@ -0,0 +1,128 @@
+#ifndef SYNCRESPONSECHECKER_H
+#define SYNCRESPONSECHECKER_H
+
+#include <vector>
+
+/**
+@brief Compares the checksums clients send for each frame
+The checksums of the last frames are kept in a ring buffer, grouped by value
+with a count each, so recording a response is O(1) and the correct checksum
+of a frame is simply the one most clients agree on. A frame is decided as
+soon as every player required for it has answered, or when it is older than
+the timeout; memory does not grow however far clients lag behind, responses
+for frames which already left the ring are dropped.
+
+Players are required, spectators are only sampled: their responses count for
+every spectatorInterval-th frame only, and a frame is not held back waiting
+for them. Responses arriving after a frame was decided are still compared to
+its result while it is in the ring.
+*/
+class CSyncResponseChecker
+{
+public:
+	/// players whose checksum differs from the majority
+	struct Desync
+	{
+		int frameNum;
+		unsigned correctChecksum;
+		/// not set if other is
+		unsigned checksum;
+		/// the players sent more distinct checksums than are remembered per frame
+		bool other;
+		std::vector<int> players;
+	};
+	/// required players which did not answer in time
+	struct Missing
+	{
+		int frameNum;
+		std::vector<int> players;
+	};
+
+	/**
+	@param maxPlayers player numbers range from 0 to maxPlayers-1
+	@param timeout frames to wait for a player's checksum
+	@param spectatorInterval spectator checksums are checked for every n-th frame
+	*/
+	CSyncResponseChecker(int maxPlayers, int timeout, int spectatorInterval = 16);
+
+	/**
+	@brief start or stop expecting checksums from a player
+	@param required true for players, false for spectators
+	*/
+	void AddPlayer(int player, bool required);
+	void RemovePlayer(int player);
+
+	/// the server sent out frameNum, expect checksums for it
+	void NewFrame(int frameNum);
+
+	/**
+	@brief record the checksum player computed for frameNum
+	@return false if frameNum left the ring buffer already (response is far too late)
+	*/
+	bool AddResponse(int player, int frameNum, unsigned checksum);
+
+	/**
+	@brief decide frames which are complete or timed out
+	Results are appended to desyncs / missing.
+	*/
+	void Update(int serverFrame, std::vector<Desync>& desyncs, std::vector<Missing>& missing);
+
+	/// frames not decided yet
+	int NumOutstanding() const;
+
+private:
+	/// a player's group in a frame which he didn't answer
+	static const unsigned char NO_RESPONSE = 0xFF;
+	/// distinct checksums remembered per frame, the last group collects the
+	/// players whose checksum did not fit in the others anymore
+	static const int MAX_GROUPS = 8;
+	static const int OTHER_GROUP = MAX_GROUPS - 1;
+
+	struct Frame
+	{
+		int frameNum; ///< -1 if unused
+		bool decided;
+		/// required players which have not answered yet
+		int numMissing;
+		/// not counting OTHER_GROUP
+		int numGroups;
+		unsigned checksum[MAX_GROUPS];
+		int count[MAX_GROUPS];
+		/// majority group, once decided
+		int correctGroup;
+	};
+	enum PlayerState
+	{
+		NOT_CONNECTED,
+		REQUIRED,
+		SAMPLED
+	};
+
+	Frame& Slot(int frameNum) { return frames[frameNum % frames.size()]; }
+	unsigned char& Group(int frameNum, int player) { return groups[(frameNum % frames.size()) * maxPlayers + player]; }
+	bool RequiredFor(int player, int frameNum) const;
+	void Decide(Frame& frame, std::vector<Desync>& desyncs, std::vector<Missing>& missing);
+	int AddToGroup(Frame& frame, unsigned checksum);
+
+	const int maxPlayers;
+	const int timeout;
+	const int spectatorInterval;
+
+	std::vector<Frame> frames;
+	/// group of each player in each frame, frames.size() * maxPlayers
+	std::vector<unsigned char> groups;
+	std::vector<PlayerState> playerState;
+	/// first frame a player was required for
+	std::vector<int> requiredSince;
+	int numRequired;
+
+	/// oldest frame not decided yet, lastFrame+1 if none
+	int firstOutstanding;
+	int lastFrame;
+
+	/// desyncs found outside of Update(), reported by the next one
+	std::vector<Desync> lateDesyncs;
+	std::vector<Missing> lateMissing;
+};
+
+#endif
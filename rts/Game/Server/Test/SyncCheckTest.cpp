@@ -0,0 +1,269 @@
+/**
+@file SyncCheckTest.cpp
+@brief Feeds synthetic checksums to CSyncResponseChecker
+
+Covers agreeing clients, a single desync, the majority vote, more distinct
+checksums than groups, players which stop answering, a client lagging far
+behind, late responses and spectator sampling. Prints the failed checks and returns non-zero if there were any.
+
+usage: SyncCheckTest
+*/
+
+#include <iostream>
+#include <vector>
+
+#include "SyncResponseChecker.h"
+
+static const int maxPlayers = 16;
+static const int timeout = 300;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #cond << std::endl; \
+		++failures; \
+	}
+
+typedef std::vector<CSyncResponseChecker::Desync> Desyncs;
+typedef std::vector<CSyncResponseChecker::Missing> Missings;
+
+/// frameNum's checksum as computed by a client in sync
+static unsigned Checksum(int frameNum)
+{
+	return frameNum * 2654435761u;
+}
+
+static void AllAgree()
+{
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	for (int p = 0; p < 4; ++p)
+		checker.AddPlayer(p, true);
+
+	Desyncs desyncs;
+	Missings missing;
+	for (int f = 1; f <= 1000; ++f) {
+		checker.NewFrame(f);
+		for (int p = 0; p < 4; ++p)
+			checker.AddResponse(p, f, Checksum(f));
+		checker.Update(f, desyncs, missing);
+	}
+	CHECK(desyncs.empty());
+	CHECK(missing.empty());
+	CHECK(checker.NumOutstanding() == 0);
+}
+
+static void OneDesync()
+{
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	for (int p = 0; p < 4; ++p)
+		checker.AddPlayer(p, true);
+
+	Desyncs desyncs;
+	Missings missing;
+	for (int f = 1; f <= 100; ++f) {
+		checker.NewFrame(f);
+		for (int p = 0; p < 4; ++p)
+			checker.AddResponse(p, f, (p == 2 && f == 50) ? 1234 : Checksum(f));
+		checker.Update(f, desyncs, missing);
+	}
+	CHECK(missing.empty());
+	CHECK(desyncs.size() == 1);
+	if (desyncs.size() == 1) {
+		CHECK(desyncs[0].frameNum == 50);
+		CHECK(desyncs[0].checksum == 1234);
+		CHECK(desyncs[0].correctChecksum == Checksum(50));
+		CHECK(desyncs[0].players.size() == 1 && desyncs[0].players[0] == 2);
+	}
+}
+
+static void MajorityVote()
+{
+	// the first answer is the odd one out, the majority still wins
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	for (int p = 0; p < 5; ++p)
+		checker.AddPlayer(p, true);
+
+	Desyncs desyncs;
+	Missings missing;
+	checker.NewFrame(1);
+	checker.AddResponse(0, 1, 7);
+	checker.AddResponse(1, 1, 9);
+	checker.AddResponse(2, 1, 9);
+	checker.AddResponse(3, 1, 8);
+	checker.AddResponse(4, 1, 9);
+	checker.Update(1, desyncs, missing);
+
+	CHECK(desyncs.size() == 2);
+	for (unsigned i = 0; i < desyncs.size(); ++i) {
+		CHECK(desyncs[i].correctChecksum == 9);
+		CHECK(desyncs[i].players.size() == 1);
+	}
+}
+
+static void ManyChecksums()
+{
+	// every player but the first three sends a checksum of his own
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	for (int p = 0; p < maxPlayers; ++p)
+		checker.AddPlayer(p, true);
+
+	Desyncs desyncs;
+	Missings missing;
+	checker.NewFrame(1);
+	for (int p = 0; p < maxPlayers; ++p)
+		checker.AddResponse(p, 1, (p < 3) ? Checksum(1) : 100 + p);
+	checker.Update(1, desyncs, missing);
+
+	// 7 groups with a checksum, one of them correct, then the rest as "other"
+	CHECK(desyncs.size() == 7);
+	int numOther = 0;
+	for (unsigned i = 0; i < desyncs.size(); ++i) {
+		CHECK(desyncs[i].correctChecksum == Checksum(1));
+		if (desyncs[i].other) {
+			++numOther;
+			CHECK((int)desyncs[i].players.size() == maxPlayers - 3 - 6);
+		} else {
+			CHECK(desyncs[i].players.size() == 1);
+			CHECK(desyncs[i].checksum == 100u + desyncs[i].players[0]);
+		}
+	}
+	CHECK(numOther == 1);
+}
+
+static void MissingPlayer()
+{
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	for (int p = 0; p < 3; ++p)
+		checker.AddPlayer(p, true);
+
+	// player 1 stops answering after frame 10
+	Desyncs desyncs;
+	Missings missing;
+	int f = 1;
+	for (; f <= 11 + timeout; ++f) {
+		checker.NewFrame(f);
+		for (int p = 0; p < 3; ++p) {
+			if (p != 1 || f <= 10)
+				checker.AddResponse(p, f, Checksum(f));
+		}
+		checker.Update(f, desyncs, missing);
+	}
+	CHECK(missing.empty()); // still within the timeout
+	CHECK(checker.NumOutstanding() == timeout + 1);
+
+	checker.NewFrame(f);
+	checker.Update(f, desyncs, missing);
+	CHECK(missing.size() == 1);
+	if (!missing.empty()) {
+		CHECK(missing[0].frameNum == 11);
+		CHECK(missing[0].players.size() == 1 && missing[0].players[0] == 1);
+	}
+
+	// once he's gone, nobody waits for him
+	checker.RemovePlayer(1);
+	missing.clear();
+	checker.Update(f, desyncs, missing);
+	CHECK(missing.empty());
+	CHECK(desyncs.empty());
+}
+
+static void LaggingClient()
+{
+	// a client which stopped answering altogether must not make the server grow
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	checker.AddPlayer(0, true);
+	checker.AddPlayer(1, true);
+
+	Desyncs desyncs;
+	Missings missing;
+	for (int f = 1; f <= 100000; ++f) {
+		checker.NewFrame(f);
+		checker.AddResponse(0, f, Checksum(f));
+		// Update() only every now and then
+		if (f % 1000 == 0)
+			checker.Update(f, desyncs, missing);
+	}
+	CHECK(checker.NumOutstanding() <= 2 * timeout);
+	CHECK(desyncs.empty());
+	CHECK(missing.size() > 0);
+
+	// way too late
+	CHECK(!checker.AddResponse(1, 5, Checksum(5)));
+}
+
+static void LateResponse()
+{
+	CSyncResponseChecker checker(maxPlayers, timeout);
+	checker.AddPlayer(0, true);
+	checker.AddPlayer(1, true);
+
+	Desyncs desyncs;
+	Missings missing;
+	int f = 1;
+	for (; f <= timeout + 2; ++f) {
+		checker.NewFrame(f);
+		checker.AddResponse(0, f, Checksum(f));
+		checker.Update(f, desyncs, missing);
+	}
+	CHECK(missing.size() == 1); // frame 1 timed out
+
+	// the answer for frame 1 arrives after all, but is wrong
+	CHECK(checker.AddResponse(1, 1, 42));
+	missing.clear();
+	checker.Update(f, desyncs, missing);
+	CHECK(desyncs.size() == 1);
+	if (!desyncs.empty()) {
+		CHECK(desyncs[0].frameNum == 1);
+		CHECK(desyncs[0].players.size() == 1 && desyncs[0].players[0] == 1);
+	}
+}
+
+static void SpectatorSampling()
+{
+	const int interval = 16;
+	CSyncResponseChecker checker(maxPlayers, timeout, interval);
+	checker.AddPlayer(0, true);
+	checker.AddPlayer(1, true);
+	checker.AddPlayer(5, false);
+
+	Desyncs desyncs;
+	Missings missing;
+	for (int f = 1; f <= 200; ++f) {
+		checker.NewFrame(f);
+		checker.AddResponse(0, f, Checksum(f));
+		checker.AddResponse(1, f, Checksum(f));
+		// the spectator is out of sync from frame 100 on, and answers slowly
+		if (f > 20)
+			checker.AddResponse(5, f - 20, (f - 20 >= 100) ? 0 : Checksum(f - 20));
+		checker.Update(f, desyncs, missing);
+	}
+	// frames are not held back for spectators
+	CHECK(checker.NumOutstanding() == 0);
+	CHECK(missing.empty());
+
+	// only the sampled frames 112, 128, ... 176 are compared
+	CHECK(desyncs.size() == 5);
+	for (unsigned i = 0; i < desyncs.size(); ++i) {
+		CHECK(desyncs[i].frameNum % interval == 0);
+		CHECK(desyncs[i].players.size() == 1 && desyncs[i].players[0] == 5);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	AllAgree();
+	OneDesync();
+	MajorityVote();
+	ManyChecksums();
+	MissingPlayer();
+	LaggingClient();
+	LateResponse();
+	SpectatorSampling();
+
+	if (failures)
+		std::cout << failures << " checks failed" << std::endl;
+	else
+		std::cout << "all checks passed" << std::endl;
+	return failures ? 1 : 0;
+}
@@ -7,6 +7,7 @@
 #include <SDL_keysym.h>
 #include <SDL_mouse.h>
 #include <SDL_timer.h>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "mmgr.h"
 
@@ -37,6 +38,7 @@
 #include "Sim/Weapons/Weapon.h"
 #include "EventHandler.h"
 #include "LogOutput.h"
+#include "ConfigHandler.h"
 #include "SpringApp.h"
 #include "FileSystem/FileHandler.h"
 
@@ -67,10 +69,20 @@ CLuaHandle::CLuaHandle(const string& _name, int _order,
 #else
   printTracebacks(false),
 #endif
-  callinErrors(0)
-{
-	L = lua_open();
+  callinErrors(0),
+  gcInCycle(false),
+  gcNextCycleKB(0),
+  gcCycles(0),
+  gcTime(0.0f)
+{
+	L = lua_newstate(LuaMemPool::Alloc, &memPool);
+	lua_atpanic(L, HandlePanic);
 	luaopen_debug(L);
+
+	// synced handles override these, see CLuaHandleSynced
+	SetGCParams(configHandler.Get("LuaGCStepSize", 0),
+	            configHandler.Get("LuaGCPause", 200),
+	            configHandler.Get("LuaGCStepMul", 200));
 }
 
 
@@ -99,6 +111,56 @@ void CLuaHandle::KillLua()
 }
 
 
+int CLuaHandle::HandlePanic(lua_State* L)
+{
+	logOutput.Print("PANIC: unprotected error in call to Lua API (%s)\n",
+	                lua_tostring(L, -1));
+	return 0;
+}
+
+
+/******************************************************************************/
+
+void CLuaHandle::SetGCParams(int stepSize, int pause, int stepMul)
+{
+	gcStepSize = stepSize;
+	gcPause    = pause;
+	lua_gc(L, LUA_GCSETPAUSE, pause);
+	lua_gc(L, LUA_GCSETSTEPMUL, stepMul);
+}
+
+
+void CLuaHandle::CollectGarbage()
+{
+	if ((L == NULL) || (gcStepSize <= 0)) {
+		return;
+	}
+
+	// lua's own collector still runs as a backstop, this only moves the
+	// bulk of the work to a fixed point in the frame in fixed-size steps
+	if (!gcInCycle && (lua_gc(L, LUA_GCCOUNT, 0) < gcNextCycleKB)) {
+		return;
+	}
+
+	const boost::posix_time::ptime startTime =
+		boost::posix_time::microsec_clock::universal_time();
+
+	CLuaHandle* orig = activeHandle;
+	SetActiveHandle();
+	gcInCycle = true;
+	if (lua_gc(L, LUA_GCSTEP, gcStepSize)) {
+		gcInCycle = false;
+		gcCycles++;
+		gcNextCycleKB = (lua_gc(L, LUA_GCCOUNT, 0) * gcPause) / 100;
+	}
+	SetActiveHandle(orig);
+
+	const boost::posix_time::time_duration elapsed =
+		boost::posix_time::microsec_clock::universal_time() - startTime;
+	gcTime += elapsed.total_microseconds() * 1.0e-6f;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
 
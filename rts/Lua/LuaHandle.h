@@ -19,6 +19,7 @@ using std::set;
 #include "LuaRBOs.h"
 //FIXME#include "LuaVBOs.h"
 #include "LuaDisplayLists.h"
+#include "LuaMemPool.h"
 
 
 #define LUA_HANDLE_ORDER_RULES            100
@@ -87,6 +88,13 @@ class CLuaHandle : public CEventClient
 		LuaRBOs& GetRBOs() { return rbos; }
 		CLuaDisplayLists& GetDisplayLists() { return displayLists; }
 
+		const LuaMemPool& GetMemPool() const { return memPool; }
+		float GetGCTime()   const { return gcTime; }
+		int   GetGCCycles() const { return gcCycles; }
+
+		/// runs this frame's share of the incremental garbage collector
+		void CollectGarbage();
+
 	public:
 		const bool userMode;
 
@@ -216,6 +224,9 @@ class CLuaHandle : public CEventClient
 
 		void KillLua();
 
+		/// pause and stepMul are passed to lua_gc, stepSize is for CollectGarbage()
+		void SetGCParams(int stepSize, int pause, int stepMul);
+
 		void SetActiveHandle();
 		void SetActiveHandle(CLuaHandle*);
 
@@ -237,6 +248,9 @@ class CLuaHandle : public CEventClient
 		inline bool CheckModUICtrl() { return modUICtrl || userMode; }
 
 	protected:
+		// must outlive L
+		LuaMemPool memPool;
+
 		lua_State* L;
 
 		bool killMe;
@@ -277,7 +291,15 @@ class CLuaHandle : public CEventClient
 
 		int callinErrors;
 
+		int   gcStepSize;    // KB of collector work per frame, 0 leaves GC to lua
+		int   gcPause;       // percent growth before the next cycle is started
+		bool  gcInCycle;
+		int   gcNextCycleKB;
+		int   gcCycles;
+		float gcTime;        // seconds spent in CollectGarbage()
+
 	protected: // call-outs
+		static int HandlePanic(lua_State* L);
 		static int KillActiveHandle(lua_State* L);
 		static int CallOutGetName(lua_State* L);
 		static int CallOutGetSynced(lua_State* L);
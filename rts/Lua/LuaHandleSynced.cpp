@@ -72,6 +72,11 @@ CLuaHandleSynced::CLuaHandleSynced(const string& _name, int _order,
   teamsLocked(false)
 {
 	printTracebacks = true;
+
+	// the LuaGC* config values differ between players, and the synced code
+	// can see when things are collected (weak tables, __gc); so keep lua's
+	// defaults here and leave the collector to lua itself
+	SetGCParams(0, 200, 200);
 }
 
 
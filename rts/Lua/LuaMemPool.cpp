@@ -0,0 +1,142 @@
+#include "StdAfx.h"
+// LuaMemPool.cpp: implementation of the LuaMemPool class.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+
+#include "mmgr.h"
+
+#include "LuaMemPool.h"
+
+
+/******************************************************************************/
+/******************************************************************************/
+
+LuaMemPool::LuaMemPool()
+: usedBytes(0),
+  numAllocs(0),
+  numSysAllocs(0)
+{
+	for (size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+		freeLists[i] = NULL;
+	}
+}
+
+
+LuaMemPool::~LuaMemPool()
+{
+	for (size_t i = 0; i < chunks.size(); i++) {
+		free(chunks[i]);
+	}
+}
+
+
+/******************************************************************************/
+
+void* LuaMemPool::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	LuaMemPool* pool = (LuaMemPool*)ud;
+	return pool->Realloc(ptr, osize, nsize);
+}
+
+
+void* LuaMemPool::Realloc(void* ptr, size_t osize, size_t nsize)
+{
+	// lua passes osize == 0 for new blocks
+	const size_t oldClass = (ptr == NULL) ? NO_SIZE_CLASS : GetSizeClass(osize);
+
+	if (nsize == 0) {
+		if (ptr != NULL) {
+			usedBytes -= osize;
+			if (oldClass != NO_SIZE_CLASS) {
+				FreeBlock(ptr, oldClass);
+			} else {
+				free(ptr);
+			}
+		}
+		return NULL;
+	}
+
+	const size_t newClass = GetSizeClass(nsize);
+
+	numAllocs++;
+
+	if ((ptr != NULL) && (oldClass == newClass)) {
+		// same size class (or both system-sized)
+		void* mem = ptr;
+		if (newClass == NO_SIZE_CLASS) {
+			numSysAllocs++;
+			if ((mem = realloc(ptr, nsize)) == NULL) {
+				return NULL;
+			}
+		}
+		usedBytes += nsize;
+		usedBytes -= osize;
+		return mem;
+	}
+
+	void* mem;
+	if (newClass != NO_SIZE_CLASS) {
+		mem = AllocBlock(newClass);
+	} else {
+		numSysAllocs++;
+		mem = malloc(nsize);
+	}
+	if (mem == NULL) {
+		// lua expects the old block to stay valid
+		return NULL;
+	}
+
+	if (ptr != NULL) {
+		memcpy(mem, ptr, (osize < nsize) ? osize : nsize);
+		usedBytes -= osize;
+		if (oldClass != NO_SIZE_CLASS) {
+			FreeBlock(ptr, oldClass);
+		} else {
+			free(ptr);
+		}
+	}
+	usedBytes += nsize;
+
+	return mem;
+}
+
+
+void* LuaMemPool::AllocBlock(size_t sizeClass)
+{
+	FreeNode* block = freeLists[sizeClass];
+
+	if (block == NULL) {
+		// carve a new chunk into blocks of this class
+		char* chunk = (char*)malloc(CHUNK_SIZE);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		chunks.push_back(chunk);
+
+		const size_t blockSize = (sizeClass + 1) * SIZE_CLASS_STEP;
+		const size_t numBlocks = CHUNK_SIZE / blockSize;
+		for (size_t i = 0; i < numBlocks; i++) {
+			FreeNode* fb = (FreeNode*)(chunk + (i * blockSize));
+			fb->next = block;
+			block = fb;
+		}
+	}
+
+	freeLists[sizeClass] = block->next;
+	return block;
+}
+
+
+void LuaMemPool::FreeBlock(void* ptr, size_t sizeClass)
+{
+	FreeNode* block = (FreeNode*)ptr;
+	block->next = freeLists[sizeClass];
+	freeLists[sizeClass] = block;
+}
+
+
+/******************************************************************************/
+/******************************************************************************/
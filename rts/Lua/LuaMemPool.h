@@ -0,0 +1,66 @@
+#ifndef LUA_MEM_POOL_H
+#define LUA_MEM_POOL_H
+// LuaMemPool.h: interface for the LuaMemPool class.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <vector>
+using std::vector;
+
+
+/**
+ * @brief per lua_State allocator
+ *
+ * Small blocks (the bulk of lua's strings, tables and closures) are
+ * served from size-class free-lists carved out of larger chunks, which
+ * are only returned to the system when the owning state is closed.
+ * Anything larger goes straight to malloc/realloc.
+ */
+class LuaMemPool {
+	public:
+		LuaMemPool();
+		~LuaMemPool();
+
+		/// lua_Alloc compatible entry point, ud must be a LuaMemPool*
+		static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+		/// bytes currently handed out to lua
+		size_t GetUsedBytes() const { return usedBytes; }
+		/// bytes held in pool chunks (used or not)
+		size_t GetPoolBytes() const { return chunks.size() * CHUNK_SIZE; }
+		/// number of (re)allocations served since creation
+		size_t GetNumAllocs() const { return numAllocs; }
+		/// number of allocations that fell through to the system allocator
+		size_t GetNumSysAllocs() const { return numSysAllocs; }
+
+	private:
+		void* Realloc(void* ptr, size_t osize, size_t nsize);
+		void* AllocBlock(size_t sizeClass);
+		void FreeBlock(void* ptr, size_t sizeClass);
+
+		static size_t GetSizeClass(size_t size) {
+			return (size <= MAX_POOLED_SIZE) ? ((size - 1) / SIZE_CLASS_STEP) : NO_SIZE_CLASS;
+		}
+
+	private:
+		static const size_t SIZE_CLASS_STEP = 16;
+		static const size_t MAX_POOLED_SIZE = 256;
+		static const size_t NUM_SIZE_CLASSES = MAX_POOLED_SIZE / SIZE_CLASS_STEP;
+		static const size_t NO_SIZE_CLASS = NUM_SIZE_CLASSES;
+		static const size_t CHUNK_SIZE = 16 * 1024;
+
+		struct FreeNode {
+			FreeNode* next;
+		};
+		FreeNode* freeLists[NUM_SIZE_CLASSES];
+
+		vector<char*> chunks;
+
+		size_t usedBytes;
+		size_t numAllocs;
+		size_t numSysAllocs;
+};
+
+
+#endif /* LUA_MEM_POOL_H */
@@ -230,6 +230,174 @@ bool LuaParser::Execute()
 }
 
 
+/******************************************************************************/
+//
+//  Snapshots of the root table
+//
+//  Every value is a type byte followed by its data: numbers as raw
+//  lua_Number, strings as length + bytes, tables as pair count + pairs.
+//  Snapshots are only read back on the machine which wrote them.
+//
+
+static const int maxSnapshotDepth = 64; // also catches tables containing themselves
+
+template<typename T>
+static void PutRaw(string& data, const T& value)
+{
+	data.append((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+static bool GetRaw(const string& data, unsigned& pos, T& value)
+{
+	if (data.size() - pos < sizeof(T)) {
+		return false;
+	}
+	memcpy(&value, data.data() + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+
+bool LuaParser::SaveValue(lua_State* L, int index, string& data, int depth)
+{
+	switch (lua_type(L, index)) {
+		case LUA_TBOOLEAN: {
+			data += 'b';
+			data += (char)lua_toboolean(L, index);
+			return true;
+		}
+		case LUA_TNUMBER: {
+			data += 'n';
+			PutRaw(data, (lua_Number)lua_tonumber(L, index));
+			return true;
+		}
+		case LUA_TSTRING: {
+			size_t len;
+			const char* str = lua_tolstring(L, index, &len);
+			data += 's';
+			PutRaw(data, (unsigned)len);
+			data.append(str, len);
+			return true;
+		}
+		case LUA_TTABLE: {
+			if (depth >= maxSnapshotDepth) {
+				return false;
+			}
+			const int table = (index > 0) ? index : (lua_gettop(L) + index + 1);
+			data += 't';
+			const unsigned countPos = data.size();
+			unsigned count = 0;
+			PutRaw(data, count);
+			for (lua_pushnil(L); lua_next(L, table) != 0; lua_pop(L, 1)) {
+				if (!SaveValue(L, -2, data, depth + 1) || !SaveValue(L, -1, data, depth + 1)) {
+					lua_pop(L, 2);
+					return false;
+				}
+				count++;
+			}
+			memcpy(&data[countPos], &count, sizeof(count));
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool LuaParser::LoadValue(lua_State* L, const string& data, unsigned& pos, int depth)
+{
+	if (pos >= data.size()) {
+		return false;
+	}
+	switch (data[pos++]) {
+		case 'b': {
+			if (pos >= data.size()) {
+				return false;
+			}
+			lua_pushboolean(L, data[pos++]);
+			return true;
+		}
+		case 'n': {
+			lua_Number value;
+			if (!GetRaw(data, pos, value)) {
+				return false;
+			}
+			lua_pushnumber(L, value);
+			return true;
+		}
+		case 's': {
+			unsigned len;
+			if (!GetRaw(data, pos, len) || (data.size() - pos < len)) {
+				return false;
+			}
+			lua_pushlstring(L, data.data() + pos, len);
+			pos += len;
+			return true;
+		}
+		case 't': {
+			unsigned count;
+			if ((depth >= maxSnapshotDepth) || !GetRaw(data, pos, count)) {
+				return false;
+			}
+			if (!lua_checkstack(L, 4)) {
+				return false;
+			}
+			lua_newtable(L);
+			for (unsigned i = 0; i < count; i++) {
+				if (!LoadValue(L, data, pos, depth + 1)) {
+					lua_pop(L, 1);
+					return false;
+				}
+				if (!LoadValue(L, data, pos, depth + 1)) {
+					lua_pop(L, 2);
+					return false;
+				}
+				lua_rawset(L, -3);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool LuaParser::SaveRoot(string& data)
+{
+	if (!valid || (L == NULL) || (rootRef == LUA_NOREF)) {
+		return false;
+	}
+	data.clear();
+	lua_rawgeti(L, LUA_REGISTRYINDEX, rootRef);
+	const bool ok = SaveValue(L, -1, data, 0);
+	lua_settop(L, 0);
+	return ok;
+}
+
+
+bool LuaParser::LoadRoot(const string& data)
+{
+	if (L == NULL) {
+		errorLog = "could not initialize LUA library";
+		return false;
+	}
+	assert(initDepth == 0);
+
+	unsigned pos = 0;
+	if (!LoadValue(L, data, pos, 0) || !lua_istable(L, -1) || (pos != data.size())) {
+		lua_settop(L, 0);
+		return false;
+	}
+
+	initDepth = -1;
+	rootRef = luaL_ref(L, LUA_REGISTRYINDEX);
+	lua_settop(L, 0);
+	valid = true;
+	return true;
+}
+
+
+/******************************************************************************/
+
 void LuaParser::AddTable(LuaTable* tbl)
 {
 	tables.insert(tbl);
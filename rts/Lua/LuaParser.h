@@ -121,6 +121,18 @@ class LuaParser {
 
 		bool Execute();
 
+		/**
+		@brief Binary snapshot of the root table after Execute()
+		Only tables, strings, numbers and booleans can be stored, the
+		snapshot is refused (false) if the root holds anything else.
+		*/
+		bool SaveRoot(string& data);
+		/**
+		@brief Use a snapshot from SaveRoot() instead of calling Execute()
+		@return false if the snapshot is corrupt, Execute() can still be used then
+		*/
+		bool LoadRoot(const string& data);
+
 		bool IsValid() const { return (L != NULL); }
 
 		LuaTable GetRoot();
@@ -164,6 +176,10 @@ class LuaParser {
 		void AddTable(LuaTable* tbl);
 		void RemoveTable(LuaTable* tbl);
 
+		// for SaveRoot / LoadRoot
+		static bool SaveValue(lua_State* L, int index, string& data, int depth);
+		static bool LoadValue(lua_State* L, const string& data, unsigned& pos, int depth);
+
 	private:
 		bool valid;
 		int initDepth;
@@ -177,6 +177,8 @@ bool LuaSyncedRead::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetUnitsInSphere);
 	REGISTER_LUA_CFUNC(GetUnitsInCylinder);
 
+	REGISTER_LUA_CFUNC(GetUnitsFields);
+
 	REGISTER_LUA_CFUNC(GetFeaturesInRectangle);
 
 	REGISTER_LUA_CFUNC(GetUnitNearestAlly);
@@ -2147,6 +2149,271 @@ int LuaSyncedRead::GetUnitNearestEnemy(lua_State* L)
 }
 
 
+/******************************************************************************/
+//
+//  Bulk unit reads
+//
+//  Spring.GetUnitsFields(units, fields [, result]) -> result, count
+//
+//    units:  an array of unitIDs, nil for all visible units, or a
+//            rectangle { xmin = , zmin = , xmax = , zmax = }
+//    fields: an array of field names (see unitFieldNames)
+//    result: the table returned by a previous call; its arrays are
+//            refilled in place (and trimmed) instead of being reallocated,
+//            the arrays of fields not requested this time are removed
+//
+//  result.id is always filled, every requested field gets a flat array
+//  aligned with it. Values the caller may not read are set to false.
+//
+
+enum UnitField {
+	UNIT_FIELD_DEFID,
+	UNIT_FIELD_TEAM,
+	UNIT_FIELD_ALLYTEAM,
+	UNIT_FIELD_HEALTH,
+	UNIT_FIELD_MAXHEALTH,
+	UNIT_FIELD_BUILD,
+	UNIT_FIELD_X,
+	UNIT_FIELD_Y,
+	UNIT_FIELD_Z,
+	UNIT_FIELD_VX,
+	UNIT_FIELD_VY,
+	UNIT_FIELD_VZ,
+	UNIT_FIELD_COUNT
+};
+
+static const char* unitFieldNames[UNIT_FIELD_COUNT] = {
+	"defID", "team", "allyTeam", "health", "maxHealth", "build",
+	"x", "y", "z", "vx", "vy", "vz"
+};
+
+
+static void FillUnitFieldArray(lua_State* L, int table, UnitField field,
+                               const vector<CUnit*>& units)
+{
+	const int count = (int)units.size();
+	for (int i = 0; i < count; i++) {
+		const CUnit* unit = units[i];
+		switch (field) {
+			case UNIT_FIELD_DEFID: {
+				if (IsUnitTyped(unit)) {
+					lua_pushnumber(L, EffectiveUnitDef(unit)->id);
+				} else {
+					lua_pushboolean(L, false);
+				}
+				break;
+			}
+			case UNIT_FIELD_TEAM: {
+				lua_pushnumber(L, unit->team);
+				break;
+			}
+			case UNIT_FIELD_ALLYTEAM: {
+				lua_pushnumber(L, unit->allyteam);
+				break;
+			}
+			case UNIT_FIELD_HEALTH:
+			case UNIT_FIELD_MAXHEALTH: {
+				const UnitDef* ud = unit->unitDef;
+				const bool enemyUnit = IsEnemyUnit(unit);
+				if (!IsUnitInLos(unit) || (ud->hideDamage && enemyUnit)) {
+					lua_pushboolean(L, false);
+					break;
+				}
+				const float value = (field == UNIT_FIELD_HEALTH) ?
+				                    unit->health : unit->maxHealth;
+				if (!enemyUnit || (ud->decoyDef == NULL)) {
+					lua_pushnumber(L, value);
+				} else {
+					lua_pushnumber(L, value * (ud->decoyDef->health / ud->health));
+				}
+				break;
+			}
+			case UNIT_FIELD_BUILD: {
+				if (IsUnitInLos(unit)) {
+					lua_pushnumber(L, unit->buildProgress);
+				} else {
+					lua_pushboolean(L, false);
+				}
+				break;
+			}
+			case UNIT_FIELD_X:
+			case UNIT_FIELD_Y:
+			case UNIT_FIELD_Z: {
+				// same rules as GetUnitPosition()
+				float3 pos;
+				if (IsAllyUnit(unit)) {
+					pos = unit->midPos;
+				} else {
+					pos = helper->GetUnitErrorPos(unit, readAllyTeam);
+				}
+				lua_pushnumber(L, pos[field - UNIT_FIELD_X]);
+				break;
+			}
+			case UNIT_FIELD_VX:
+			case UNIT_FIELD_VY:
+			case UNIT_FIELD_VZ: {
+				if (IsUnitInLos(unit)) {
+					lua_pushnumber(L, unit->speed[field - UNIT_FIELD_VX]);
+				} else {
+					lua_pushboolean(L, false);
+				}
+				break;
+			}
+			default: {
+				lua_pushboolean(L, false);
+			}
+		}
+		lua_rawseti(L, table, i + 1);
+	}
+}
+
+
+static float GetRectField(lua_State* L, const char* name)
+{
+	lua_getfield(L, 1, name);
+	if (!lua_isnumber(L, -1)) {
+		luaL_error(L, "Bad rectangle field \"%s\" in GetUnitsFields()", name);
+	}
+	const float value = lua_tofloat(L, -1);
+	lua_pop(L, 1);
+	return value;
+}
+
+
+static void PushUnitFieldArray(lua_State* L, int resultTable, const char* name,
+                               int oldCount, int newCount)
+{
+	// reuse the array from the previous call if there is one
+	lua_getfield(L, resultTable, name);
+	if (!lua_istable(L, -1)) {
+		lua_pop(L, 1);
+		lua_createtable(L, newCount, 0);
+		lua_pushvalue(L, -1);
+		lua_setfield(L, resultTable, name);
+	}
+	else {
+		// trim the entries left over from a larger previous result
+		const int table = lua_gettop(L);
+		for (int i = newCount + 1; i <= oldCount; i++) {
+			lua_pushnil(L);
+			lua_rawseti(L, table, i);
+		}
+	}
+}
+
+
+int LuaSyncedRead::GetUnitsFields(lua_State* L)
+{
+	// reused across calls, lua handles never run concurrently
+	static vector<CUnit*> units;
+	units.clear();
+
+	// collect the units
+	if (lua_isnoneornil(L, 1)) {
+		list<CUnit*>::const_iterator uit;
+		for (uit = uh->activeUnits.begin(); uit != uh->activeUnits.end(); ++uit) {
+			if (IsUnitVisible(*uit)) {
+				units.push_back(*uit);
+			}
+		}
+	}
+	else if (lua_istable(L, 1)) {
+		lua_getfield(L, 1, "xmin");
+		const bool isRect = lua_isnumber(L, -1);
+		lua_pop(L, 1);
+
+		if (isRect) {
+			const float3 mins(GetRectField(L, "xmin"), 0.0f, GetRectField(L, "zmin"));
+			const float3 maxs(GetRectField(L, "xmax"), 0.0f, GetRectField(L, "zmax"));
+			const vector<CUnit*> rectUnits = qf->GetUnitsExact(mins, maxs);
+			vector<CUnit*>::const_iterator it;
+			for (it = rectUnits.begin(); it != rectUnits.end(); ++it) {
+				if (IsUnitVisible(*it)) {
+					units.push_back(*it);
+				}
+			}
+		}
+		else {
+			const int idCount = lua_objlen(L, 1);
+			units.reserve(idCount);
+			for (int i = 1; i <= idCount; i++) {
+				lua_rawgeti(L, 1, i);
+				CUnit* unit = ParseRawUnit(L, NULL, -1);
+				lua_pop(L, 1);
+				if ((unit != NULL) && IsUnitVisible(unit)) {
+					units.push_back(unit);
+				}
+			}
+		}
+	}
+	else {
+		luaL_error(L, "Incorrect arguments to GetUnitsFields()");
+	}
+
+	// parse the field names
+	bool wanted[UNIT_FIELD_COUNT] = { false };
+	luaL_checktype(L, 2, LUA_TTABLE);
+	const int fieldCount = lua_objlen(L, 2);
+	for (int i = 1; i <= fieldCount; i++) {
+		lua_rawgeti(L, 2, i);
+		const char* name = lua_tostring(L, -1);
+		if (name == NULL) {
+			luaL_error(L, "Bad field name in GetUnitsFields()");
+		}
+		int f;
+		for (f = 0; f < UNIT_FIELD_COUNT; f++) {
+			if (strcmp(name, unitFieldNames[f]) == 0) {
+				wanted[f] = true;
+				break;
+			}
+		}
+		if (f == UNIT_FIELD_COUNT) {
+			luaL_error(L, "Unknown field \"%s\" in GetUnitsFields()", name);
+		}
+		lua_pop(L, 1);
+	}
+
+	// get or create the result table
+	if (lua_istable(L, 3)) {
+		lua_settop(L, 3);
+	} else {
+		lua_settop(L, 2);
+		lua_newtable(L);
+	}
+	const int resultTable = lua_gettop(L);
+
+	lua_getfield(L, resultTable, "n");
+	const int oldCount = lua_isnumber(L, -1) ? lua_toint(L, -1) : 0;
+	lua_pop(L, 1);
+	const int newCount = (int)units.size();
+
+	PushUnitFieldArray(L, resultTable, "id", oldCount, newCount);
+	for (int i = 0; i < newCount; i++) {
+		lua_pushnumber(L, units[i]->id);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_pop(L, 1);
+
+	for (int f = 0; f < UNIT_FIELD_COUNT; f++) {
+		if (!wanted[f]) {
+			// drop the arrays of fields an earlier call asked for
+			lua_pushnil(L);
+			lua_setfield(L, resultTable, unitFieldNames[f]);
+			continue;
+		}
+		PushUnitFieldArray(L, resultTable, unitFieldNames[f], oldCount, newCount);
+		FillUnitFieldArray(L, lua_gettop(L), (UnitField)f, units);
+		lua_pop(L, 1);
+	}
+
+	lua_pushnumber(L, newCount);
+	lua_setfield(L, resultTable, "n");
+
+	lua_pushnumber(L, newCount);
+	return 2;
+}
+
+
 /******************************************************************************/
 
 int LuaSyncedRead::GetFeaturesInRectangle(lua_State* L)
@@ -79,6 +79,8 @@ class LuaSyncedRead {
 		static int GetUnitsInSphere(lua_State* L);
 		static int GetUnitsInCylinder(lua_State* L);
 
+		static int GetUnitsFields(lua_State* L);
+
 		static int GetUnitNearestAlly(lua_State* L);
 		static int GetUnitNearestEnemy(lua_State* L);
 
@@ -148,6 +148,8 @@ bool LuaUnsyncedRead::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetTimer);
 	REGISTER_LUA_CFUNC(DiffTimers);
 
+	REGISTER_LUA_CFUNC(GetLuaMemUsage);
+
 	REGISTER_LUA_CFUNC(GetSoundStreamTime);
 
 	// moved from LuaUI
@@ -1251,6 +1253,23 @@ int LuaUnsyncedRead::DiffTimers(lua_State* L)
 }
 
 
+/******************************************************************************/
+
+int LuaUnsyncedRead::GetLuaMemUsage(lua_State* L)
+{
+	CheckNoArgs(L, __FUNCTION__);
+	const CLuaHandle* lh = CLuaHandle::GetActiveHandle();
+	const LuaMemPool& pool = lh->GetMemPool();
+	lua_pushnumber(L, pool.GetUsedBytes() / 1024.0f);
+	lua_pushnumber(L, pool.GetPoolBytes() / 1024.0f);
+	lua_pushnumber(L, pool.GetNumAllocs());
+	lua_pushnumber(L, pool.GetNumSysAllocs());
+	lua_pushnumber(L, lh->GetGCTime());
+	lua_pushnumber(L, lh->GetGCCycles());
+	return 6;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
 
@@ -79,6 +79,8 @@ class LuaUnsyncedRead {
 		static int GetTimer(lua_State* L);
 		static int DiffTimers(lua_State* L);
 
+		static int GetLuaMemUsage(lua_State* L);
+
 		static int GetSoundStreamTime(lua_State* L);
 
 		// moved from LuaUI
@@ -52,6 +52,19 @@ void CSmfMapFile::ReadHeightmap(float* heightmap, float base, float mod)
 {
 	const int hmx = header.mapx + 1;
 	const int hmy = header.mapy + 1;
+
+	// convert straight from the file if it is in memory anyway
+	const unsigned char* data = ifs.GetData();
+	if (data && header.heightmapPtr >= 0 && header.heightmapPtr + hmx * hmy * 2 <= ifs.FileSize()) {
+		data += header.heightmapPtr;
+		for (int y = 0; y < hmx * hmy; ++y) {
+			unsigned short h;
+			memcpy(&h, data + y * 2, 2); // may be unaligned
+			heightmap[y] = base + swabword(h) * mod;
+		}
+		return;
+	}
+
 	unsigned short* temphm = new unsigned short[hmx * hmy];
 
 	ifs.Seek(header.heightmapPtr);
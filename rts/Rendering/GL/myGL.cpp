@@ -1,7 +1,10 @@
 #include "StdAfx.h"
 #include <ostream>
 #include <fstream>
+#include <vector>
 #include <SDL.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 #include "mmgr.h"
 
 #include "myGL.h"
@@ -249,10 +252,39 @@ void ClearScreen()
 	glColor3f(1,1,1);
 }
 
+// threads which must not touch GL, see DeferLoadMsgs
+static boost::thread_specific_ptr<bool> deferLoadMsgs;
+static boost::mutex deferredMutex;
+static std::vector<std::string> deferredMsgs;
+
+void DeferLoadMsgs()
+{
+	deferLoadMsgs.reset(new bool(true));
+}
+
+void PrintDeferredLoadMsg()
+{
+	std::vector<std::string> msgs;
+	{
+		boost::mutex::scoped_lock lock(deferredMutex);
+		msgs.swap(deferredMsgs);
+	}
+	// all of them go to the log, only the last one is drawn
+	for (unsigned i = 0; i < msgs.size(); ++i) {
+		PrintLoadMsg(msgs[i].c_str(), i + 1 == msgs.size());
+	}
+}
+
 void PrintLoadMsg(const char* text, bool swapbuffers)
 {
 	static char prevText[100];
 
+	if (deferLoadMsgs.get()) {
+		boost::mutex::scoped_lock lock(deferredMutex);
+		deferredMsgs.push_back(text);
+		return;
+	}
+
 	// Stuff that needs to be done regularly while loading.
 	// Totally unrelated to the task the name of this function implies.
 
@@ -55,6 +55,10 @@ void glBuildMipmaps(const GLenum target,GLint internalFormat,const GLsizei width
 void LoadStartPicture(const std::string& sidePref);
 void ClearScreen();
 void PrintLoadMsg(const char* text, bool swapbuffers = true);
+/// PrintLoadMsg on the calling thread only queues the text for PrintDeferredLoadMsg
+void DeferLoadMsgs();
+/// show the messages queued by other threads, main thread only
+void PrintDeferredLoadMsg();
 void UnloadStartPicture();
 
 bool ProgramStringIsNative(GLenum target, const char* filename);
@@ -31,7 +31,9 @@ void S3DModelPiece::DrawStatic() const
 
 S3DModelPiece::~S3DModelPiece()
 {
-	glDeleteLists(displist, 1);
+	// pieces of models which were parsed but never drawn have no list
+	if (displist != 0)
+		glDeleteLists(displist, 1);
 }
 
 
@@ -120,18 +120,9 @@ C3DOParser::C3DOParser()
 }
 
 
-S3DModel* C3DOParser::Load(string name)
+S3DModel* C3DOParser::Parse(const string& name, unsigned char* buf, int size)
 {
-	CFileHandler file(name);
-	if(!file.FileExists()){
-		throw content_error("File not found: "+name);
-	}
-	fileBuf=new unsigned char[file.FileSize()];
-	file.Read(fileBuf, file.FileSize());
-	if (fileBuf == NULL) {
-		delete [] fileBuf;
-		throw content_error("Failed to read file "+name);
-	}
+	fileBuf=buf;
 
 	S3DModel *model = new S3DModel;
 	model->name = name;
@@ -164,11 +155,100 @@ S3DModel* C3DOParser::Load(string name)
 
 	model->relMidPos=rootobj->relMidPos;
 
-	delete[] fileBuf;
+	fileBuf=NULL;
 	return model;
 }
 
 
+void C3DOParser::Finish(S3DModel* model)
+{
+	SetTextures(static_cast<S3DOPiece*>(model->rootobject));
+}
+
+
+void C3DOParser::SetTextures(S3DOPiece* o)
+{
+	for(std::vector<S3DOPrimitive>::iterator ps=o->prims.begin();ps!=o->prims.end();ps++){
+		if(!ps->textureName.empty())
+		{
+			if(teamtex.find(ps->textureName) != teamtex.end())
+				ps->texture=texturehandler3DO->Get3DOTexture(ps->textureName);
+			else
+				ps->texture=texturehandler3DO->Get3DOTexture(ps->textureName + "00");
+
+			if(ps->texture==0)
+				logOutput << "Parser couldnt get texture " << ps->textureName.c_str() << "\n";
+		} else {
+			char t[50];
+			sprintf(t,"ta_color%i",ps->paletteEntry);
+			ps->texture=texturehandler3DO->Get3DOTexture(t);
+		}
+	}
+	for(std::vector<S3DModelPiece*>::iterator ci=o->childs.begin();ci!=o->childs.end();++ci){
+		SetTextures(static_cast<S3DOPiece*>(*ci));
+	}
+}
+
+
+void C3DOParser::WritePiece(CCacheBlob& blob, const S3DModelPiece* o) const
+{
+	const S3DOPiece* piece = static_cast<const S3DOPiece*>(o);
+	blob.Put(piece->radius);
+	blob.Put(piece->relMidPos);
+
+	blob.Put((unsigned int)piece->vertices.size());
+	for(std::vector<S3DOVertex>::const_iterator vi=piece->vertices.begin();vi!=piece->vertices.end();++vi){
+		// vi->prims is only needed by CalcNormals
+		blob.Put(vi->pos);
+		blob.Put(vi->normal);
+	}
+	blob.Put((unsigned int)piece->prims.size());
+	for(std::vector<S3DOPrimitive>::const_iterator ps=piece->prims.begin();ps!=piece->prims.end();++ps){
+		blob.PutVector(ps->vertices);
+		blob.PutVector(ps->normals);
+		blob.Put(ps->normal);
+		blob.Put(ps->numVertex);
+		blob.PutString(ps->textureName);
+		blob.Put(ps->paletteEntry);
+	}
+}
+
+
+S3DModelPiece* C3DOParser::ReadPiece(CCacheBlob& blob) const
+{
+	S3DOPiece* piece = new S3DOPiece;
+	blob.Get(piece->radius);
+	blob.Get(piece->relMidPos);
+
+	unsigned int numVertices = 0;
+	blob.Get(numVertices);
+	for(unsigned int a=0;a<numVertices && !blob.Failed();++a){
+		piece->vertices.push_back(S3DOVertex());
+		S3DOVertex& v = piece->vertices.back();
+		blob.Get(v.pos);
+		blob.Get(v.normal);
+	}
+	unsigned int numPrims = 0;
+	blob.Get(numPrims);
+	for(unsigned int a=0;a<numPrims && !blob.Failed();++a){
+		piece->prims.push_back(S3DOPrimitive());
+		S3DOPrimitive& p = piece->prims.back();
+		blob.GetVector(p.vertices);
+		blob.GetVector(p.normals);
+		blob.Get(p.normal);
+		blob.Get(p.numVertex);
+		blob.GetString(p.textureName);
+		blob.Get(p.paletteEntry);
+		p.texture=0; // SetTextures
+	}
+	if(blob.Failed()){
+		delete piece;
+		return NULL;
+	}
+	return piece;
+}
+
+
 void C3DOParser::GetVertexes(_3DObject* o,S3DOPiece* object)
 {
 	curOffset=o->OffsetToVertexArray;
@@ -223,23 +303,13 @@ void C3DOParser::GetPrimitives(S3DOPiece* obj,int pos,int num,vertex_vector* vv,
 		for(list<int>::iterator vi=orderVert.begin();vi!=orderVert.end();++vi)
 			vertHash=(vertHash+(*vi))*(*vi);
 
+		// looked up by SetTextures, the texture handler is not thread safe
 		sp.texture=0;
+		sp.paletteEntry=p.PaletteEntry;
 		if(p.OffsetToTextureName!=0)
 		{
-			string texture = GetText(p.OffsetToTextureName);
-			StringToLowerInPlace(texture);
-
-			if(teamtex.find(texture) != teamtex.end())
-				sp.texture=texturehandler3DO->Get3DOTexture(texture);
-			else
-				sp.texture=texturehandler3DO->Get3DOTexture(texture + "00");
-
-			if(sp.texture==0)
-				logOutput << "Parser couldnt get texture " << GetText(p.OffsetToTextureName).c_str() << "\n";
-		} else {
-			char t[50];
-			sprintf(t,"ta_color%i",p.PaletteEntry);
-			sp.texture=texturehandler3DO->Get3DOTexture(t);
+			sp.textureName = GetText(p.OffsetToTextureName);
+			StringToLowerInPlace(sp.textureName);
 		}
 		float3 n=-(obj->vertices[sp.vertices[1]].pos-obj->vertices[sp.vertices[0]].pos).cross(obj->vertices[sp.vertices[2]].pos-obj->vertices[sp.vertices[0]].pos);
 		n.Normalize();
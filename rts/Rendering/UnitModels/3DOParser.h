@@ -28,6 +28,8 @@ struct S3DOPrimitive {
 	float3 normal;
 	int numVertex;
 	C3DOTextureHandler::UnitTexture* texture;
+	std::string textureName; // lowercase, empty for palette colors
+	int paletteEntry;
 };
 
 struct S3DOPiece : public S3DModelPiece {
@@ -75,7 +77,15 @@ class C3DOParser : public IModelParser
 public:
 	C3DOParser();
 
-	S3DModel* Load(std::string name);
+	S3DModel* Parse(const std::string& name, unsigned char* buf, int size);
+	void Finish(S3DModel* model);
+	IModelParser* Clone() const { return new C3DOParser(*this); }
+
+	/// saves finding the primitives and smoothing the normals
+	bool UseModelCache() const { return true; }
+	void WritePiece(CCacheBlob& blob, const S3DModelPiece* o) const;
+	S3DModelPiece* ReadPiece(CCacheBlob& blob) const;
+
 	void Draw(S3DModelPiece *o);
 
 private:
@@ -83,6 +93,7 @@ private:
 	float FindRadius(S3DOPiece* object,float3 offset);
 	float FindHeight(S3DOPiece* object,float3 offset);
 	void CalcNormals(S3DOPiece* o);
+	void SetTextures(S3DOPiece* o);
 
 	void GetPrimitives(S3DOPiece* obj,int pos,int num,vertex_vector* vv,int excludePrim);
 	void GetVertexes(_3DObject* o,S3DOPiece* object);
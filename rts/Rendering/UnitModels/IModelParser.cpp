@@ -2,6 +2,7 @@
 #include "Rendering/GL/myGL.h"
 #include <algorithm>
 #include <cctype>
+#include <boost/bind.hpp>
 #include "mmgr.h"
 
 #include "IModelParser.h"
@@ -10,6 +11,8 @@
 #include "s3oParser.h"
 #include "Sim/Units/COB/CobInstance.h"
 #include "Rendering/FartextureHandler.h"
+#include "FileSystem/FileHandler.h"
+#include "WorkerThreads.h"
 #include "Util.h"
 #include "LogOutput.h"
 #include "Exceptions.h"
@@ -17,6 +20,9 @@
 
 C3DModelParser* modelParser = NULL;
 
+/// Preload reads at most this much before parsing what it has read
+static const unsigned int preloadBatchSize = 32 * 1024 * 1024;
+
 
 //////////////////////////////////////////////////////////////////////
 // C3DModelParser
@@ -42,6 +48,12 @@ C3DModelParser::~C3DModelParser(void)
 	}
 	cache.clear();
 
+	for(ci=preloaded.begin();ci!=preloaded.end();++ci){
+		DeleteChilds(ci->second->rootobject);
+		delete ci->second;
+	}
+	preloaded.clear();
+
 	// parsers
 	std::map<std::string,IModelParser*>::iterator pi;
 	for(pi=parsers.begin(); pi!=parsers.end(); ++pi){
@@ -75,12 +87,21 @@ S3DModel* C3DModelParser::Load3DModel(std::string name)
 		return ci->second;
 	}
 
-	std::string fileExt = GetFileExt(name);
-
-	std::map<std::string,IModelParser*>::iterator pi;
-	if ((pi=parsers.find(fileExt)) != parsers.end()) {
-		IModelParser* p = pi->second;
-		S3DModel* model = p->Load(name);
+	IModelParser* p = GetParser(name);
+	if (p != NULL) {
+		S3DModel* model;
+		if((ci=preloaded.find(name))!=preloaded.end()){
+			model = ci->second;
+			preloaded.erase(ci);
+		} else {
+			std::vector<unsigned char> buf;
+			std::string blobName;
+			if (!ReadModelFile(p, name, buf, blobName)) {
+				throw content_error("File not found: "+name);
+			}
+			model = ParseModel(p, name, buf, blobName);
+		}
+		p->Finish(model);
 		CreateLists(p, model->rootobject);
 		fartextureHandler->CreateFarTexture(model);
 		cache[name] = model; // cache model
@@ -91,6 +112,136 @@ S3DModel* C3DModelParser::Load3DModel(std::string name)
 	return NULL;
 }
 
+
+void C3DModelParser::Preload(const std::vector<std::string>& names)
+{
+	GML_STDMUTEX_LOCK(model); // Preload
+
+	const int numThreads = GetWorkerThreadCount();
+
+	preloadJobs.reserve(names.size()); // the buffers are not copied around then
+	std::set<std::string> done;
+	std::vector<std::string>::const_iterator ni = names.begin();
+	while (ni != names.end()) {
+		// read a batch of files, VFS access has to stay on this thread
+		unsigned int batchSize = 0;
+		for (; ni != names.end() && batchSize < preloadBatchSize; ++ni) {
+			const std::string name = StringToLower(*ni);
+			if (!done.insert(name).second || cache.find(name) != cache.end() || preloaded.find(name) != preloaded.end()) {
+				continue;
+			}
+			PreloadJob job;
+			job.name = name;
+			job.parser = GetParser(name);
+			job.model = NULL;
+			if (job.parser == NULL) {
+				continue; // Load3DModel will complain
+			}
+			preloadJobs.push_back(job);
+			if (!ReadModelFile(job.parser, name, preloadJobs.back().buf, preloadJobs.back().blobName)) {
+				preloadJobs.pop_back(); // Load3DModel will throw
+				continue;
+			}
+			batchSize += preloadJobs.back().buf.size();
+		}
+
+		nextPreloadJob = 0;
+		RunWorkers(std::min(numThreads, (int)preloadJobs.size()),
+			boost::bind(&C3DModelParser::PreloadWorker, this, false),
+			boost::bind(&C3DModelParser::PreloadWorker, this, true));
+
+		for (std::vector<PreloadJob>::iterator ji = preloadJobs.begin(); ji != preloadJobs.end(); ++ji) {
+			if (ji->model != NULL) {
+				preloaded[ji->name] = ji->model;
+			} else {
+				logOutput.Print("Failed to preload " + ji->name);
+			}
+		}
+		preloadJobs.clear();
+	}
+}
+
+
+void C3DModelParser::PreloadWorker(bool mainThread)
+{
+	// a copy of each parser for worker threads, the parsers keep state while parsing
+	std::map<IModelParser*, IModelParser*> clones;
+
+	while (true) {
+		PreloadJob* job;
+		{
+			boost::mutex::scoped_lock lock(preloadMutex);
+			if (nextPreloadJob >= preloadJobs.size())
+				break;
+			job = &preloadJobs[nextPreloadJob++];
+		}
+
+		IModelParser* parser = job->parser;
+		if (!mainThread) {
+			IModelParser*& clone = clones[job->parser];
+			if (clone == NULL)
+				clone = job->parser->Clone();
+			parser = clone;
+		}
+		try {
+			job->model = ParseModel(parser, job->name, job->buf, job->blobName);
+		} catch (const std::exception&) {
+			// left to Load3DModel, which will throw again on this thread
+			job->model = NULL;
+		}
+		std::vector<unsigned char>().swap(job->buf);
+	}
+
+	for (std::map<IModelParser*, IModelParser*>::iterator ci = clones.begin(); ci != clones.end(); ++ci) {
+		delete ci->second;
+	}
+}
+
+
+IModelParser* C3DModelParser::GetParser(const std::string& name)
+{
+	std::map<std::string,IModelParser*>::iterator pi = parsers.find(GetFileExt(name));
+	return (pi != parsers.end()) ? pi->second : NULL;
+}
+
+
+bool C3DModelParser::ReadModelFile(const IModelParser* parser, const std::string& name, std::vector<unsigned char>& buf, std::string& blobName)
+{
+	CFileHandler file(name);
+	if (!file.FileExists()) {
+		return false;
+	}
+	buf.resize(file.FileSize());
+	if (!buf.empty()) {
+		file.Read(&buf[0], buf.size());
+	}
+	if (modelCache.IsEnabled() && parser->UseModelCache()) {
+		blobName = modelCache.GetBlobName(name, buf.empty() ? NULL : &buf[0], buf.size());
+	}
+	return true;
+}
+
+
+S3DModel* C3DModelParser::ParseModel(IModelParser* parser, const std::string& name, std::vector<unsigned char>& buf, const std::string& blobName)
+{
+	if (!blobName.empty()) {
+		S3DModel* model = modelCache.Load(blobName, name, parser);
+		if (model != NULL) {
+			return model;
+		}
+	}
+
+	if (buf.empty()) {
+		throw content_error("Empty model file: "+name);
+	}
+	S3DModel* model = parser->Parse(name, &buf[0], buf.size());
+
+	if (!blobName.empty()) {
+		modelCache.Save(blobName, model, parser);
+	}
+	return model;
+}
+
 void C3DModelParser::Update() {
 #if defined(USE_GML) && GML_ENABLE_SIM
 	GML_STDMUTEX_LOCK(model); // Update
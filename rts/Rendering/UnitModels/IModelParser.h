@@ -4,9 +4,11 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <boost/thread/mutex.hpp>
 #include "Matrix44f.h"
 #include "Sim/Units/Unit.h"
 #include "3DModel.h"
+#include "ModelCache.h"
 
 
 class C3DOParser;
@@ -18,7 +20,26 @@ extern C3DModelParser* modelParser;
 class IModelParser
 {
 public:
-	virtual S3DModel* Load(std::string name) = 0;
+	virtual ~IModelParser() {}
+
+	/**
+	@brief Build the model from the contents of its file
+	Must not touch OpenGL, the VFS or the log, C3DModelParser::Preload runs
+	it on worker threads (each with its own Clone() of the parser).
+	@param buf file contents, may be modified
+	*/
+	virtual S3DModel* Parse(const std::string& name, unsigned char* buf, int size) = 0;
+	/// The main thread part of loading (textures), after Parse or the model cache
+	virtual void Finish(S3DModel* model) = 0;
+	virtual IModelParser* Clone() const = 0;
+
+	/// Keep parsed models in CModelCache, for parsers doing more than copying
+	virtual bool UseModelCache() const { return false; }
+	/// Store the parser specific data of a piece for CModelCache
+	virtual void WritePiece(CCacheBlob& blob, const S3DModelPiece* o) const {}
+	/// Create a piece and read what WritePiece stored, NULL if blob is corrupt
+	virtual S3DModelPiece* ReadPiece(CCacheBlob& blob) const { return NULL; }
+
 	virtual void Draw(S3DModelPiece* o) = 0;
 };
 
@@ -31,6 +52,12 @@ public:
 
 	void Update();
 	S3DModel* Load3DModel(std::string name);
+	/**
+	@brief Parse models on all cores ahead of Load3DModel
+	The models are only parsed (or read from the model cache), their textures
+	and display lists are still created when Load3DModel first asks for them.
+	*/
+	void Preload(const std::vector<std::string>& names);
 
 	void AddParser(const std::string ext, IModelParser* parser);
 
@@ -42,6 +69,27 @@ private:
 //FIXME make some static?
 	std::map<std::string,S3DModel*> cache;
 	std::map<std::string,IModelParser*> parsers;
+	/// parsed by Preload, not yet asked for
+	std::map<std::string,S3DModel*> preloaded;
+	CModelCache modelCache;
+
+	struct PreloadJob {
+		std::string name;
+		IModelParser* parser;
+		std::vector<unsigned char> buf;
+		std::string blobName;
+		S3DModel* model;
+	};
+	std::vector<PreloadJob> preloadJobs;
+	unsigned int nextPreloadJob;
+	boost::mutex preloadMutex;
+
+	IModelParser* GetParser(const std::string& name);
+	/// read the file, blob name of the model cache (main thread)
+	bool ReadModelFile(const IModelParser* parser, const std::string& name, std::vector<unsigned char>& buf, std::string& blobName);
+	/// model cache or parser, thread safe for parsers not used elsewhere
+	S3DModel* ParseModel(IModelParser* parser, const std::string& name, std::vector<unsigned char>& buf, const std::string& blobName);
+	void PreloadWorker(bool mainThread);
 
 #if defined(USE_GML) && GML_ENABLE_SIM
 	struct ModelParserPair {
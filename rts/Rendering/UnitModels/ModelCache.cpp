@@ -0,0 +1,163 @@
+#include "StdAfx.h"
+#include <stdio.h>
+#include "mmgr.h"
+
+#include "ModelCache.h"
+#include "IModelParser.h"
+#include "3DModel.h"
+#include "ConfigHandler.h"
+#include "FileSystem/CRC.h"
+#include "FileSystem/FileSystem.h"
+#include "Util.h"
+
+
+/// change when the layout of the cached models changes
+static const unsigned int formatVersion = 2;
+
+/// deeper piece hierarchies are treated as corrupt
+static const int maxPieceDepth = 256;
+
+
+/// key of all model cache files, the blob name already tells the models apart
+static std::string GetCacheKey()
+{
+	char key[64];
+	sprintf(key, "spring model %u", formatVersion);
+	return key;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// CModelCache
+//
+
+static void DeletePieces(S3DModelPiece* o)
+{
+	for (std::vector<S3DModelPiece*>::iterator ci = o->childs.begin(); ci != o->childs.end(); ++ci) {
+		DeletePieces(*ci);
+	}
+	delete o;
+}
+
+
+CModelCache::CModelCache()
+{
+	enabled = !!configHandler.Get("ModelCache", 1);
+	if (enabled) {
+		enabled = filesystem.CreateDirectory("cache/models");
+	}
+}
+
+
+std::string CModelCache::GetBlobName(const std::string& name, const unsigned char* buf, int size) const
+{
+	char blobName[64];
+	sprintf(blobName, "cache/models/%08x%08x.", CRC().Update(buf, size).GetDigest(), size);
+	return filesystem.LocateFile(blobName + GetFileExt(name), FileSystem::WRITE);
+}
+
+
+S3DModel* CModelCache::Load(const std::string& blobName, const std::string& name, const IModelParser* parser) const
+{
+	CCacheBlob blob;
+	if (!LoadCacheFile(blobName, GetCacheKey(), blob.GetData())) {
+		return NULL;
+	}
+
+	S3DModel* model = new S3DModel;
+	model->name = name;
+	blob.Get(model->numobjects);
+	blob.Get(model->radius);
+	blob.Get(model->height);
+	blob.Get(model->maxx); blob.Get(model->maxy); blob.Get(model->maxz);
+	blob.Get(model->minx); blob.Get(model->miny); blob.Get(model->minz);
+	blob.Get(model->relMidPos);
+	blob.Get(model->type);
+	blob.Get(model->textureType);
+	blob.GetString(model->tex1);
+	blob.GetString(model->tex2);
+
+	model->rootobject = blob.Failed() ? NULL : ReadPiece(blob, parser, 0);
+	if (model->rootobject == NULL || !blob.AtEnd()) {
+		if (model->rootobject != NULL) {
+			DeletePieces(model->rootobject);
+		}
+		delete model;
+		return NULL;
+	}
+	return model;
+}
+
+
+void CModelCache::Save(const std::string& blobName, const S3DModel* model, const IModelParser* parser) const
+{
+	CCacheBlob blob;
+	blob.Put(model->numobjects);
+	blob.Put(model->radius);
+	blob.Put(model->height);
+	blob.Put(model->maxx); blob.Put(model->maxy); blob.Put(model->maxz);
+	blob.Put(model->minx); blob.Put(model->miny); blob.Put(model->minz);
+	blob.Put(model->relMidPos);
+	blob.Put(model->type);
+	blob.Put(model->textureType);
+	blob.PutString(model->tex1);
+	blob.PutString(model->tex2);
+	WritePiece(blob, model->rootobject, parser);
+
+	SaveCacheFile(blobName, GetCacheKey(), blob.GetData());
+}
+
+
+void CModelCache::WritePiece(CCacheBlob& blob, const S3DModelPiece* o, const IModelParser* parser) const
+{
+	parser->WritePiece(blob, o);
+
+	blob.PutString(o->name);
+	blob.Put(o->vertexCount);
+	blob.Put(o->offset);
+	blob.Put(o->isEmpty);
+	blob.Put(o->maxx); blob.Put(o->maxy); blob.Put(o->maxz);
+	blob.Put(o->minx); blob.Put(o->miny); blob.Put(o->minz);
+	blob.Put(o->type);
+
+	blob.Put((unsigned int)o->childs.size());
+	for (std::vector<S3DModelPiece*>::const_iterator ci = o->childs.begin(); ci != o->childs.end(); ++ci) {
+		WritePiece(blob, *ci, parser);
+	}
+}
+
+
+S3DModelPiece* CModelCache::ReadPiece(CCacheBlob& blob, const IModelParser* parser, int depth) const
+{
+	if (depth > maxPieceDepth) {
+		return NULL;
+	}
+	S3DModelPiece* o = parser->ReadPiece(blob);
+	if (o == NULL) {
+		return NULL;
+	}
+
+	o->displist = 0;
+	blob.GetString(o->name);
+	blob.Get(o->vertexCount);
+	blob.Get(o->offset);
+	blob.Get(o->isEmpty);
+	blob.Get(o->maxx); blob.Get(o->maxy); blob.Get(o->maxz);
+	blob.Get(o->minx); blob.Get(o->miny); blob.Get(o->minz);
+	blob.Get(o->type);
+
+	unsigned int numChilds = 0;
+	blob.Get(numChilds);
+	for (unsigned int c = 0; c < numChilds && !blob.Failed(); ++c) {
+		S3DModelPiece* child = ReadPiece(blob, parser, depth + 1);
+		if (child == NULL) {
+			break;
+		}
+		o->childs.push_back(child);
+	}
+	if (blob.Failed() || o->childs.size() != numChilds) {
+		DeletePieces(o);
+		return NULL;
+	}
+	return o;
+}
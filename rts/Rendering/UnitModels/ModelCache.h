@@ -0,0 +1,46 @@
+#ifndef MODELCACHE_H
+#define MODELCACHE_H
+
+#include <string>
+#include <vector>
+#include "FileSystem/CacheFile.h"
+
+struct S3DModel;
+struct S3DModelPiece;
+class IModelParser;
+
+
+/**
+@brief Keeps parsed models in cache/models/ between runs
+A model is stored once its parser has processed it (for 3DO files that is
+finding the primitives and smoothing the normals), keyed by CRC and size
+of the model file, so loading it again only copies the data. Only used for
+parsers which want it (IModelParser::UseModelCache). Textures and display
+lists are not cached, they are created by the parser and C3DModelParser as
+usual.
+
+Load() and Save() can be called from worker threads, GetBlobName() and the
+constructor only from the main thread.
+*/
+class CModelCache
+{
+public:
+	CModelCache();
+
+	bool IsEnabled() const { return enabled; }
+
+	/// Name of the cache file for a model file with these contents
+	std::string GetBlobName(const std::string& name, const unsigned char* buf, int size) const;
+
+	/// @return NULL if the cache has no (readable) copy
+	S3DModel* Load(const std::string& blobName, const std::string& name, const IModelParser* parser) const;
+	void Save(const std::string& blobName, const S3DModel* model, const IModelParser* parser) const;
+
+private:
+	void WritePiece(CCacheBlob& blob, const S3DModelPiece* o, const IModelParser* parser) const;
+	S3DModelPiece* ReadPiece(CCacheBlob& blob, const IModelParser* parser, int depth) const;
+
+	bool enabled;
+};
+
+#endif /* MODELCACHE_H */
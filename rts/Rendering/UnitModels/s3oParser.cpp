@@ -22,26 +22,22 @@
 #include "LogOutput.h"
 
 
-S3DModel* CS3OParser::Load(std::string name)
+S3DModel* CS3OParser::Parse(const std::string& name, unsigned char* fileBuf, int size)
 {
-	CFileHandler file(name);
-	if (!file.FileExists()) {
-		throw content_error("File not found: "+name);
+	if (size < (int)sizeof(S3OHeader)) {
+		throw content_error("File too short: "+name);
 	}
-
-	unsigned char* fileBuf = new unsigned char[file.FileSize()];
-	file.Read(fileBuf, file.FileSize());
 	S3OHeader header;
 	memcpy(&header,fileBuf,sizeof(header));
 	header.swap();
 
 	S3DModel *model = new S3DModel;
 	model->type = MODELTYPE_S3O;
+	model->textureType = 0;
 	model->numobjects = 0;
 	model->name = name;
 	model->tex1 = (char*) &fileBuf[header.texture1];
 	model->tex2 = (char*) &fileBuf[header.texture2];
-	texturehandlerS3O->LoadS3OTexture(model);
 
 	SS3OPiece* rootPiece = LoadPiece(fileBuf, header.rootPiece, model);
 	rootPiece->type = MODELTYPE_S3O;
@@ -65,16 +61,21 @@ S3DModel* CS3OParser::Load(std::string name)
 	model->miny = rootPiece->miny;
 	model->minz = rootPiece->minz;
 
-	delete[] fileBuf;
 	return model;
 }
 
+void CS3OParser::Finish(S3DModel* model)
+{
+	texturehandlerS3O->LoadS3OTexture(model);
+}
+
 SS3OPiece* CS3OParser::LoadPiece(unsigned char* buf, int offset, S3DModel* model)
 {
 	model->numobjects++;
 
 	SS3OPiece* piece = new SS3OPiece;
 	piece->type = MODELTYPE_S3O;
+	piece->displist = 0;
 
 	Piece* fp = (Piece*)&buf[offset];
 	fp->swap(); // Does it matter we mess with the original buffer here? Don't hope so.
@@ -41,7 +41,10 @@ enum {S3O_PRIMTYPE_TRIANGLES, S3O_PRIMTYPE_TRIANGLE_STRIP, S3O_PRIMTYPE_QUADS};
 class CS3OParser: public IModelParser
 {
 public:
-	S3DModel* Load(std::string name);
+	S3DModel* Parse(const std::string& name, unsigned char* buf, int size);
+	void Finish(S3DModel* model);
+	IModelParser* Clone() const { return new CS3OParser(*this); }
+
 	void Draw(S3DModelPiece* o);
 
 private:
@@ -63,6 +63,7 @@ CFeature::CFeature():
 	fireTime(0),
 	myFire(0),
 	drawQuad(-1),
+	drawQuadPos(-1),
 	team(0),
 	allyteam(0),
 	noSelect(false),
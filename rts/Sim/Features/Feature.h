@@ -82,6 +82,8 @@ public:
 	bool inUpdateQue;
 	/// which drawQuad we are part of
 	int drawQuad;
+	/// our index in that drawQuad's feature list
+	int drawQuadPos;
 
 	float finalHeight;
 	bool reachedFinalPos;
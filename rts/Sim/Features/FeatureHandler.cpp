@@ -97,8 +97,9 @@ CR_REG_METADATA(CFeatureHandler, (
 
 CR_BIND(CFeatureHandler::DrawQuad, );
 
+// the draw quads are rebuilt in PostLoad, so the feature lists are not saved
 CR_REG_METADATA_SUB(CFeatureHandler,DrawQuad,(
-	CR_MEMBER(features)
+	CR_RESERVED(8)
 ));
 
 
@@ -313,6 +314,7 @@ const FeatureDef* CFeatureHandler::GetFeatureDefByID(int id)
 void CFeatureHandler::LoadFeaturesFromMap(bool onlyCreateDefs)
 {
 	PrintLoadMsg("Initializing map features");
+	SCOPED_TIMER("Feature::LoadFeaturesFromMap");
 
 	int numType = readmap->GetNumFeatureTypes ();
 
@@ -374,6 +376,10 @@ void CFeatureHandler::LoadFeaturesFromMap(bool onlyCreateDefs)
 		MapFeatureInfo* mfi = new MapFeatureInfo[numFeatures];
 		readmap->GetFeatureInfo(mfi);
 
+		// map features get consecutive IDs, size the ID indices only once
+		activeFeatures.reserve(nextFreeID + numFeatures);
+		updateFeatures.reserve(nextFreeID + numFeatures);
+
 		for(int a = 0; a < numFeatures; ++a) {
 			const string name = StringToLower(readmap->GetFeatureType(mfi[a].featureType));
 			std::map<std::string, const FeatureDef*>::iterator def = featureDefs.find(name);
@@ -407,6 +413,7 @@ int CFeatureHandler::AddFeature(CFeature* feature)
 	}
 	activeFeatures.insert(feature);
 	SetFeatureUpdateable(feature);
+	CBuilderCAI::InvalidateAreaQueryCache();
 
 	if (feature->def->drawType == DRAWTYPE_3DO) {
 		int quad = int(feature->pos.z / DRAW_QUAD_SIZE / SQUARE_SIZE) * drawQuadsX +
@@ -509,6 +516,7 @@ void CFeatureHandler::Update()
 				}
 				
 				delete feature;
+				CBuilderCAI::InvalidateAreaQueryCache();
 			}
 		}
 	}
@@ -656,7 +664,7 @@ void CFeatureDrawer::DrawQuad(int x, int y)
 {
 	CFeatureHandler::DrawQuad* dq = &(*drawQuads)[y * drawQuadsX + x];
 
-	for (CFeatureSet::iterator fi = dq->features.begin(); fi != dq->features.end(); ++fi) {
+	for (CFeatureDrawQuadSet::iterator fi = dq->features.begin(); fi != dq->features.end(); ++fi) {
 		CFeature* f = (*fi);
 		const FeatureDef* def = f->def;
 
@@ -68,7 +68,7 @@ private:
 
 	struct DrawQuad {
 		CR_DECLARE_STRUCT(DrawQuad);
-		CFeatureSet features;
+		CFeatureDrawQuadSet features;
 	};
 
 	std::vector<DrawQuad> drawQuads;
@@ -4,9 +4,15 @@
  */
 
 #include "StdAfx.h"
-#include "creg/STL_Map.h"
+#include "creg/creg.h"
 #include "FeatureSet.h"
 
 CR_BIND(CFeatureSet, );
 
-CR_REG_METADATA(CFeatureSet, CR_MEMBER(features));
+CR_REG_METADATA(CFeatureSet, (
+	CR_MEMBER(features),
+	CR_MEMBER(featureIDs),
+	CR_MEMBER(positions),
+	CR_MEMBER(numFeatures),
+	CR_MEMBER(numErased)
+));
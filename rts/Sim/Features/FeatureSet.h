@@ -2,37 +2,47 @@
  *  @brief Defines STL like container wrapper for storing CFeature pointers.
  *  @author Tobi Vollebregt
  *
- *  This file has a strong resemblence to Sim/Units/UnitSet.h, if you find a
- *  bug in this one don't forget to update the other too. Or refactor them both
- *  using one set of template code.
+ *  This file used to have a strong resemblence to Sim/Units/UnitSet.h, but
+ *  the feature set is now backed by a packed vector sorted by ID instead of
+ *  a std::map, because maps carry tens of thousands of features.
  */
 
 #ifndef FEATURESET_H
 #define FEATURESET_H
 
+#include <algorithm>
+#include <climits>
+#include <vector>
 #include "Feature.h"
 
+class CFeatureSet;
+
 class CFeatureSetIterator
 {
 	private:
 
-		typedef std::map<int, CFeature*> container;
-
-		container::iterator iterator;
+		// remembers the ID of the current feature, so it finds its place again
+		// after the set was compacted or got a feature inserted in front of it
+		CFeatureSet* set;
+		mutable int index;
+		int id;
+		mutable unsigned int generation;
 		friend class CFeatureSet;
 		friend class CFeatureSetConstIterator;
 
+		void Sync() const;
+
 	public:
 
-		CFeatureSetIterator() {}
-		explicit CFeatureSetIterator(container::iterator i): iterator(i) {}
+		CFeatureSetIterator(): set(NULL), index(0), id(INT_MAX), generation(0) {}
+		CFeatureSetIterator(CFeatureSet* s, int i);
 
-		const CFeatureSetIterator& operator++() { ++iterator; return *this; }
+		const CFeatureSetIterator& operator++();
 
-		CFeature* operator*()   const { return iterator->second; }
-		CFeature** operator->() const { return &iterator->second; }
+		CFeature* operator*()   const;
+		CFeature** operator->() const;
 
-		bool operator==(const CFeatureSetIterator& other) const { return iterator == other.iterator; }
+		bool operator==(const CFeatureSetIterator& other) const { return id == other.id; }
 		bool operator!=(const CFeatureSetIterator& other) const { return !(*this == other); }
 };
 
@@ -40,30 +50,39 @@ class CFeatureSetConstIterator
 {
 	private:
 
-		typedef std::map<int, CFeature*> container;
-
-		container::const_iterator iterator;
+		const CFeatureSet* set;
+		mutable int index;
+		int id;
+		mutable unsigned int generation;
 		friend class CFeatureSet;
 
+		void Sync() const;
+
 	public:
 
-		CFeatureSetConstIterator() {}
-		CFeatureSetConstIterator(CFeatureSetIterator other): iterator(other.iterator) {}
-		explicit CFeatureSetConstIterator(container::const_iterator i): iterator(i) {}
+		CFeatureSetConstIterator(): set(NULL), index(0), id(INT_MAX), generation(0) {}
+		CFeatureSetConstIterator(CFeatureSetIterator other):
+			set(other.set), index(other.index), id(other.id), generation(other.generation) {}
+		CFeatureSetConstIterator(const CFeatureSet* s, int i);
 
-		const CFeatureSetConstIterator& operator++() { ++iterator; return *this; }
+		const CFeatureSetConstIterator& operator++();
 
-		CFeature* operator*()         const { return iterator->second; }
-		CFeature* const* operator->() const { return &iterator->second; }
+		CFeature* operator*()         const;
+		CFeature* const* operator->() const;
 
-		bool operator==(const CFeatureSetConstIterator& other) const { return iterator == other.iterator; }
+		bool operator==(const CFeatureSetConstIterator& other) const { return id == other.id; }
 		bool operator!=(const CFeatureSetConstIterator& other) const { return !(*this == other); }
 };
 
 
 /** @brief Like a std::set<CFeature*>.
- *  But this class guarantees the order of the features by actually putting them
- *  in a std::map<int, CFeature*> where the int is the feature ID.
+ *  But this class guarantees the order of the features by keeping them in a
+ *  packed vector sorted by feature ID, so iteration runs in ascending ID order
+ *  (as the std::map it replaces did) and costs O(number of features), while
+ *  an ID to position index makes find and erase O(1). Erasing leaves a hole
+ *  that is skipped until the holes outnumber the features and the vector is
+ *  compacted. Erasing or inserting during iteration is safe, like it was with
+ *  the map.
  */
 class CFeatureSet
 {
@@ -71,9 +90,53 @@ class CFeatureSet
 
 	private:
 
-		typedef std::map<int, CFeature*> container;
+		typedef std::vector<CFeature*> container;
 
+		/// sorted by ID, NULL for erased features
 		container features;
+		/// ID of every entry in features, including the erased ones
+		std::vector<int> featureIDs;
+		/// position in features by feature ID, -1 if not in the set
+		std::vector<int> positions;
+		int numFeatures;
+		int numErased;
+		/// changed whenever entries move, tells iterators to look up their place
+		unsigned int generation;
+
+		friend class CFeatureSetIterator;
+		friend class CFeatureSetConstIterator;
+
+		/// @return index of the first entry with an ID not below id
+		int Locate(int id) const {
+			if ((id >= 0) && (id < (int)positions.size()) && (positions[id] >= 0)) {
+				return positions[id];
+			}
+			return std::lower_bound(featureIDs.begin(), featureIDs.end(), id) - featureIDs.begin();
+		}
+		int SkipErased(int index) const {
+			const int size = (int)features.size();
+			while ((index < size) && (features[index] == NULL)) { ++index; }
+			return index;
+		}
+		int IDAt(int index) const {
+			return (index < (int)features.size()) ? featureIDs[index] : INT_MAX;
+		}
+
+		void Compact() {
+			int n = 0;
+			for (int i = 0; i < (int)features.size(); ++i) {
+				if (features[i] != NULL) {
+					features[n] = features[i];
+					featureIDs[n] = featureIDs[i];
+					positions[featureIDs[n]] = n;
+					++n;
+				}
+			}
+			features.resize(n);
+			featureIDs.resize(n);
+			numErased = 0;
+			++generation;
+		}
 
 	public:
 
@@ -81,35 +144,202 @@ class CFeatureSet
 		typedef CFeatureSetIterator iterator;
 		typedef CFeatureSetConstIterator const_iterator;
 
-		size_type size() const { return features.size(); }
+		CFeatureSet(): numFeatures(0), numErased(0), generation(0) {}
+
+		size_type size() const { return numFeatures; }
 		size_type max_size() const { return features.max_size(); }
-		bool empty() const { return features.empty(); }
+		bool empty() const { return (numFeatures == 0); }
 
-		iterator begin() { return iterator(features.begin()); }
-		iterator end()   { return iterator(features.end()); }
+		/// preallocate the index for feature IDs [0, maxID)
+		void reserve(int maxID) { if ((int)positions.size() < maxID) { positions.resize(maxID, -1); } }
 
-		const_iterator begin() const { return const_iterator(features.begin()); }
-		const_iterator end()   const { return const_iterator(features.end()); }
+		iterator begin() { return iterator(this, 0); }
+		iterator end()   { return iterator(this, features.size()); }
+
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end()   const { return const_iterator(this, features.size()); }
 
 		std::pair<iterator, bool> insert(CFeature* feature) {
-			std::pair<container::iterator, bool> ret =
-					features.insert(container::value_type(feature->id, feature));
-			return std::pair<iterator, bool>(iterator(ret.first), ret.second);
+			const int id = feature->id;
+			if (id >= (int)positions.size()) {
+				positions.resize(id + 1, -1);
+			}
+			if (positions[id] >= 0) {
+				return std::pair<iterator, bool>(iterator(this, positions[id]), false);
+			}
+
+			int pos = std::lower_bound(featureIDs.begin(), featureIDs.end(), id) - featureIDs.begin();
+			if (pos == (int)features.size()) {
+				// new IDs are the common case, nothing moves
+				features.push_back(feature);
+				featureIDs.push_back(id);
+			} else {
+				// reused ID: take a neighbouring hole if there is one
+				if ((features[pos] != NULL) && (pos > 0) && (features[pos - 1] == NULL)) {
+					--pos;
+				}
+				if (features[pos] == NULL) {
+					features[pos] = feature;
+					featureIDs[pos] = id;
+					--numErased;
+				} else {
+					features.insert(features.begin() + pos, feature);
+					featureIDs.insert(featureIDs.begin() + pos, id);
+					for (int i = pos + 1; i < (int)features.size(); ++i) {
+						if (features[i] != NULL) {
+							positions[featureIDs[i]] = i;
+						}
+					}
+				}
+				++generation;
+			}
+			positions[id] = pos;
+			numFeatures++;
+			return std::pair<iterator, bool>(iterator(this, pos), true);
 		}
 
-		void erase(iterator i) { features.erase((*i)->id); }
-		void erase(const CFeature* feature) { features.erase(feature->id); }
+		void erase(iterator i) { erase(*i); }
+		void erase(const CFeature* feature) {
+			const int id = feature->id;
+			if ((id < 0) || (id >= (int)positions.size()) || (positions[id] < 0)) {
+				return;
+			}
+			features[positions[id]] = NULL;
+			positions[id] = -1;
+			numFeatures--;
+			numErased++;
+			if ((numErased > 32) && (numErased > numFeatures)) {
+				Compact();
+			}
+		}
 
-		void clear() { features.clear(); }
+		void clear() {
+			features.clear();
+			featureIDs.clear();
+			positions.clear();
+			numFeatures = 0;
+			numErased = 0;
+			++generation;
+		}
 
-		iterator find(const CFeature* feature) { return iterator(features.find(feature->id)); }
-		const_iterator find(const CFeature* feature) const { return const_iterator(features.find(feature->id)); }
+		iterator find(const CFeature* feature) { return find(feature->id); }
+		const_iterator find(const CFeature* feature) const { return find(feature->id); }
 
-		iterator find(int id) { return iterator(features.find(id)); }
-		const_iterator find(int id) const { return const_iterator(features.find(id)); }
+		iterator find(int id) {
+			if ((id < 0) || (id >= (int)positions.size()) || (positions[id] < 0)) {
+				return end();
+			}
+			return iterator(this, positions[id]);
+		}
+		const_iterator find(int id) const {
+			if ((id < 0) || (id >= (int)positions.size()) || (positions[id] < 0)) {
+				return end();
+			}
+			return const_iterator(this, positions[id]);
+		}
 
-		bool operator==(const CFeatureSet& other) const { return features == other.features; }
+		bool operator==(const CFeatureSet& other) const {
+			if (numFeatures != other.numFeatures) { return false; }
+			const_iterator a = begin(), b = other.begin();
+			for (; a != end(); ++a, ++b) {
+				if (*a != *b) { return false; }
+			}
+			return true;
+		}
 		bool operator!=(const CFeatureSet& other) const { return !(*this == other); }
 };
 
+
+inline CFeatureSetIterator::CFeatureSetIterator(CFeatureSet* s, int i):
+	set(s), index(s->SkipErased(i)), id(s->IDAt(index)), generation(s->generation) {}
+
+inline void CFeatureSetIterator::Sync() const {
+	if (generation != set->generation) {
+		index = set->Locate(id);
+		generation = set->generation;
+	}
+}
+
+inline const CFeatureSetIterator& CFeatureSetIterator::operator++() {
+	Sync();
+	// if the current feature was erased index already is past it
+	if (set->IDAt(index) == id) { ++index; }
+	index = set->SkipErased(index);
+	id = set->IDAt(index);
+	return *this;
+}
+
+inline CFeature* CFeatureSetIterator::operator*()   const { Sync(); return set->features[index]; }
+inline CFeature** CFeatureSetIterator::operator->() const { Sync(); return &set->features[index]; }
+
+
+inline CFeatureSetConstIterator::CFeatureSetConstIterator(const CFeatureSet* s, int i):
+	set(s), index(s->SkipErased(i)), id(s->IDAt(index)), generation(s->generation) {}
+
+inline void CFeatureSetConstIterator::Sync() const {
+	if (generation != set->generation) {
+		index = set->Locate(id);
+		generation = set->generation;
+	}
+}
+
+inline const CFeatureSetConstIterator& CFeatureSetConstIterator::operator++() {
+	Sync();
+	if (set->IDAt(index) == id) { ++index; }
+	index = set->SkipErased(index);
+	id = set->IDAt(index);
+	return *this;
+}
+
+inline CFeature* CFeatureSetConstIterator::operator*()         const { Sync(); return set->features[index]; }
+inline CFeature* const* CFeatureSetConstIterator::operator->() const { Sync(); return &set->features[index]; }
+
+
+/** @brief Unordered feature container for the feature draw quads.
+ *  Features remember their position in the quad they are drawn in
+ *  (CFeature::drawQuadPos), so insert and erase are O(1) and iteration
+ *  walks a packed vector.
+ */
+class CFeatureDrawQuadSet
+{
+	private:
+
+		typedef std::vector<CFeature*> container;
+
+		container features;
+
+	public:
+
+		typedef container::iterator iterator;
+		typedef container::const_iterator const_iterator;
+
+		container::size_type size() const { return features.size(); }
+		bool empty() const { return features.empty(); }
+
+		iterator begin() { return features.begin(); }
+		iterator end()   { return features.end(); }
+
+		const_iterator begin() const { return features.begin(); }
+		const_iterator end()   const { return features.end(); }
+
+		void insert(CFeature* feature) {
+			feature->drawQuadPos = features.size();
+			features.push_back(feature);
+		}
+
+		void erase(CFeature* feature) {
+			const int pos = feature->drawQuadPos;
+			if ((pos < 0) || (pos >= (int)features.size()) || (features[pos] != feature)) {
+				return;
+			}
+			CFeature* last = features.back();
+			features[pos] = last;
+			last->drawQuadPos = pos;
+			features.pop_back();
+			feature->drawQuadPos = -1;
+		}
+
+		void clear() { features.clear(); }
+};
+
 #endif // !defined(FEATURESET_H)
@@ -0,0 +1,172 @@
+/**
+@file FeatureSetTest.cpp
+@brief Random operations on CFeatureSet checked against a std::set of IDs
+
+Inserts (new and reused IDs), erases, iterates while erasing and inserting
+like CFeatureHandler::Update does, and saves and loads the set with creg on
+the way. After every step size, order, contents and find() have to match
+the reference. Prints the failed checks and returns non-zero if there were
+any.
+
+usage: FeatureSetTest [steps] [seed]
+*/
+
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "creg/creg.h"
+#include "creg/Serializer.h"
+
+// a CFeature with nothing but its ID, instead of Sim/Features/Feature.h
+#define __FEATURE_H__
+class CFeature
+{
+	CR_DECLARE(CFeature);
+public:
+	CFeature(): id(-1), drawQuadPos(-1) {}
+	int id;
+	int drawQuadPos;
+};
+
+#include "Sim/Features/FeatureSet.h"
+
+CR_BIND(CFeature, );
+CR_REG_METADATA(CFeature, (
+	CR_MEMBER(id),
+	CR_MEMBER(drawQuadPos)
+));
+
+/// root object for creg, like CGameStateCollector for the feature handler
+class CFeatureSetHolder
+{
+	CR_DECLARE(CFeatureSetHolder);
+public:
+	virtual ~CFeatureSetHolder() {}
+	CFeatureSet features;
+};
+
+CR_BIND(CFeatureSetHolder, );
+CR_REG_METADATA(CFeatureSetHolder, (
+	CR_MEMBER(features)
+));
+
+static const int maxID = 3000;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #cond << " (step " << step << ")" << std::endl; \
+		++failures; \
+	}
+
+/// IDs of the set in iteration order
+static std::vector<int> Contents(const CFeatureSet& set)
+{
+	std::vector<int> ids;
+	for (CFeatureSet::const_iterator it = set.begin(); it != set.end(); ++it)
+		ids.push_back((*it)->id);
+	return ids;
+}
+
+/// save holder and load it into a new one, which the caller owns
+static CFeatureSetHolder* SaveLoad(CFeatureSetHolder* holder)
+{
+	// SavePackage skips the header and writes it last, a stringstream can
+	// only seek within the data it already has
+	std::stringstream stream;
+	stream << std::string(64, '\0');
+	stream.seekp(0);
+	creg::COutputStreamSerializer os;
+	os.SavePackage(&stream, holder, holder->GetClass());
+
+	void* root = NULL;
+	creg::Class* rootClass = NULL;
+	creg::CInputStreamSerializer is;
+	is.LoadPackage(&stream, root, rootClass);
+	return (CFeatureSetHolder*)root;
+}
+
+int main(int argc, char* argv[])
+{
+	const int steps = (argc > 1) ? atoi(argv[1]) : 20000;
+	srand((argc > 2) ? atoi(argv[2]) : 1);
+	creg::System::InitializeClasses();
+
+	// the set only looks at IDs, so after loading (which makes copies of
+	// the features) the pool still works for insert and erase
+	std::vector<CFeature> pool(maxID);
+	for (int i = 0; i < maxID; ++i)
+		pool[i].id = i;
+
+	CFeatureSetHolder* holder = new CFeatureSetHolder();
+	std::set<int> reference;
+	int numLoads = 0;
+
+	for (int step = 0; step < steps; ++step)
+	{
+		CFeatureSet& set = holder->features;
+		const int op = rand() % 100;
+		const int id = rand() % maxID;
+		if (op < 50) {
+			// erased IDs come back, like the feature handler's free IDs
+			const bool inserted = set.insert(&pool[id]).second;
+			CHECK(inserted == reference.insert(id).second);
+		} else if (op < 80) {
+			set.erase(&pool[id]);
+			reference.erase(id);
+		} else if (op < 97) {
+			// erase the current feature and insert others on the way
+			std::vector<int> seen;
+			for (CFeatureSet::iterator it = set.begin(); it != set.end(); ) {
+				CFeature* feature = *it;
+				++it;
+				seen.push_back(feature->id);
+				if (rand() % 8 == 0) {
+					reference.erase(feature->id);
+					set.erase(feature);
+				}
+				if (rand() % 8 == 0) {
+					const int newID = rand() % maxID;
+					set.insert(&pool[newID]);
+					reference.insert(newID);
+				}
+			}
+			for (unsigned i = 1; i < seen.size(); ++i) {
+				CHECK(seen[i - 1] < seen[i]);
+			}
+		} else {
+			// the features creg made for the old copy are leaked
+			CFeatureSetHolder* copy = SaveLoad(holder);
+			CHECK(Contents(copy->features) == Contents(set));
+			delete holder;
+			holder = copy;
+			++numLoads;
+		}
+
+		const CFeatureSet& current = holder->features;
+		CHECK(current.size() == reference.size());
+		CHECK(current.empty() == reference.empty());
+		CHECK(Contents(current) == std::vector<int>(reference.begin(), reference.end()));
+		for (int i = 0; i < 8; ++i) {
+			const int q = rand() % maxID;
+			const bool found = (current.find(q) != current.end());
+			CHECK(found == (reference.count(q) > 0));
+			if (found) {
+				CHECK((*current.find(q))->id == q);
+			}
+		}
+		if (failures > 20)
+			break;
+	}
+
+	std::cout << steps << " steps, " << numLoads << " save/loads, "
+		<< holder->features.size() << " features left, "
+		<< failures << " failures" << std::endl;
+	delete holder;
+	return (failures == 0) ? 0 : 1;
+}
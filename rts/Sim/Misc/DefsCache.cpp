@@ -0,0 +1,85 @@
+#include "StdAfx.h"
+#include "DefsCache.h"
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+#include "mmgr.h"
+
+#include "ConfigHandler.h"
+#include "LogOutput.h"
+#include "Game/GameSetup.h"
+#include "Game/GameVersion.h"
+#include "Lua/LuaParser.h"
+#include "FileSystem/ArchiveScanner.h"
+#include "FileSystem/CacheFile.h"
+#include "FileSystem/CRC.h"
+#include "FileSystem/FileSystem.h"
+#include "Util.h"
+
+/// change when LuaParser::SaveRoot writes something else
+static const unsigned int formatVersion = 1;
+
+
+CDefsCache::CDefsCache(const std::string& modArchive, const std::string& mapName): usable(true)
+{
+	std::vector<std::string> archives = archiveScanner->GetArchives(modArchive);
+	const std::vector<std::string> mapArchives = archiveScanner->GetArchivesForMap(mapName);
+	archives.insert(archives.end(), mapArchives.begin(), mapArchives.end());
+	for (std::vector<std::string>::const_iterator it = archives.begin(); it != archives.end(); ++it) {
+		if (StringToLower(filesystem.GetExtension(*it)) == "sdd") {
+			usable = false;
+		}
+	}
+
+	char buf[64];
+	sprintf(buf, "%u\n%u\n%u\n", formatVersion, archiveScanner->GetModChecksum(modArchive), archiveScanner->GetMapChecksum(mapName));
+	key = SpringVersion::GetFull() + "\n" + buf;
+
+	if (gameSetup != NULL) {
+		const std::map<std::string, std::string>& modOpts = gameSetup->modOptions;
+		std::map<std::string, std::string>::const_iterator it;
+		for (it = modOpts.begin(); it != modOpts.end(); ++it) {
+			key += it->first + "=" + it->second + "\n";
+		}
+	}
+
+	sprintf(buf, "cache/defs/%08x.bin", CRC().Update(key.data(), key.size()).GetDigest());
+	filename = buf;
+}
+
+
+bool CDefsCache::IsEnabled() const
+{
+	return usable && !!configHandler.Get("DefsCache", 1);
+}
+
+
+bool CDefsCache::Load(LuaParser& parser) const
+{
+	std::string data;
+	if (!LoadCacheFile(filesystem.LocateFile(filename), key, data)) {
+		return false;
+	}
+	if (!parser.LoadRoot(data)) {
+		logOutput.Print("Ignoring unreadable definitions cache %s", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+void CDefsCache::Save(LuaParser& parser) const
+{
+	std::string data;
+	if (!parser.SaveRoot(data)) {
+		// functions or userdata in the defs, these have to be executed every time
+		logOutput.Print("Definitions can not be cached");
+		return;
+	}
+	if (!filesystem.CreateDirectory("cache/defs")) {
+		return;
+	}
+	SaveCacheFile(filesystem.LocateFile(filename, FileSystem::WRITE), key, data);
+}
@@ -0,0 +1,40 @@
+#ifndef DEFSCACHE_H
+#define DEFSCACHE_H
+
+#include <string>
+
+class LuaParser;
+
+/**
+@brief Keeps the table returned by gamedata/defs.lua between runs
+Running defs.lua (and the thousands of unit, weapon and feature files it
+includes) is the slowest part of loading the definitions. The resulting
+table only depends on the engine, the mod and map archives and the mod
+options, so it is stored in cache/defs/ after the first load and used
+instead of running defs.lua again as long as none of those changed.
+
+Mods or maps in directory archives (.sdd) are never cached, their
+checksums are not kept up to date with the files they contain.
+*/
+class CDefsCache
+{
+public:
+	CDefsCache(const std::string& modArchive, const std::string& mapName);
+
+	/// @return true if the cache held the table, parser is ready to use then
+	bool Load(LuaParser& parser) const;
+	/// Store the table of an executed parser for the next run
+	void Save(LuaParser& parser) const;
+
+	/// DefsCache is set and no archive is a directory
+	bool IsEnabled() const;
+
+private:
+	/// false if a mod or map archive is a directory
+	bool usable;
+	/// engine version, mod and map checksum and mod options
+	std::string key;
+	std::string filename;
+};
+
+#endif
@@ -57,6 +57,8 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, unsigned int
 	BLOCKS_TO_UPDATE(SQUARES_TO_UPDATE / (BLOCK_SIZE * BLOCK_SIZE) + 1),
 	moveMathOptions(mmOpt),
 	pathChecksum(0),
+	cacheName(name),
+	costsFromCache(false),
 	offsetBlockNum(-1),costBlockNum(-1),
 	lastOffsetMessage(-1),lastCostMessage(-1)
 {
@@ -145,34 +147,50 @@ void CPathEstimator::InitEstimator(const std::string& name) {
 	InitBlocks();
 
 	PrintLoadMsg("Reading estimate path costs");
+	costsFromCache = ReadFile(name);
+}
 
-	if (!ReadFile(name)) {
-		char calcMsg[512];
-		sprintf(calcMsg, "Analyzing map accessibility [%d]", BLOCK_SIZE);
-		PrintLoadMsg(calcMsg);
 
-		pathBarrier=new boost::barrier(numThreads);
+/*
+ * no file access in here, so it can run on a loading thread
+ */
+void CPathEstimator::CalcPathCosts() {
+	if (costsFromCache)
+		return;
 
-		// Start threads if applicable
-		for(int i=1; i<numThreads; ++i) {
-			pathFinders[i] = new CPathFinder();
-			threads[i] = new boost::thread(boost::bind(&CPathEstimator::CalcOffsetsAndPathCosts, this, i));
-		}
+	const int numThreads = threads.size();
+	char calcMsg[512];
+	sprintf(calcMsg, "Analyzing map accessibility [%d]", BLOCK_SIZE);
+	PrintLoadMsg(calcMsg);
 
-		// Use the current thread as thread zero
-		CalcOffsetsAndPathCosts(0);
+	pathBarrier=new boost::barrier(numThreads);
 
-		for(int i=1; i<numThreads; ++i) {
-			threads[i]->join();
-			delete threads[i];
-			delete pathFinders[i];
-		}
+	// Start threads if applicable
+	for(int i=1; i<numThreads; ++i) {
+		pathFinders[i] = new CPathFinder();
+		threads[i] = new boost::thread(boost::bind(&CPathEstimator::CalcOffsetsAndPathCosts, this, i));
+	}
 
-		delete pathBarrier;
+	// Use the current thread as thread zero
+	CalcOffsetsAndPathCosts(0);
 
-		PrintLoadMsg("Writing path data file...");
-		WriteFile(name);
+	for(int i=1; i<numThreads; ++i) {
+		threads[i]->join();
+		delete threads[i];
+		delete pathFinders[i];
 	}
+
+	delete pathBarrier;
+}
+
+
+void CPathEstimator::SavePathCosts() {
+	if (costsFromCache)
+		return;
+
+	PrintLoadMsg("Writing path data file...");
+	WriteFile(cacheName);
+	costsFromCache = true;
 }
 
 
@@ -99,6 +99,15 @@ class CPathEstimator: public IPath {
 		/// Return a checksum that can be used to check if every player has the same path data
 		uint32_t GetPathChecksum();
 
+		/*
+		 * The constructor only reads the cache file. If that failed, these
+		 * calculate the costs (no file access, may run on a loading thread)
+		 * and write them to the cache (main thread only). Both do nothing
+		 * when the costs came from the cache.
+		 */
+		void CalcPathCosts();
+		void SavePathCosts();
+
 	private:
 		void InitEstimator(const std::string&);
 		void InitVertices();
@@ -195,6 +204,8 @@ class CPathEstimator: public IPath {
 		CPathCache* pathCache;
 
 		uint32_t pathChecksum; ///< currently crc from the zip
+		std::string cacheName;
+		bool costsFromCache;
 
 		boost::barrier *pathBarrier;
 
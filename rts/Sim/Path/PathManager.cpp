@@ -511,6 +511,18 @@ uint32_t CPathManager::GetPathChecksum()
 	return pe->GetPathChecksum() + pe2->GetPathChecksum();
 }
 
+void CPathManager::CalcPathCosts()
+{
+	pe->CalcPathCosts();
+	pe2->CalcPathCosts();
+}
+
+void CPathManager::SavePathCosts()
+{
+	pe->SavePathCosts();
+	pe2->SavePathCosts();
+}
+
 
 CPathManager::MultiPath::MultiPath(const float3 start, const CPathFinderDef* peDef, const MoveData* moveData) :
 	start(start),
@@ -118,6 +118,11 @@ public:
 
 	uint32_t GetPathChecksum();
 
+	/// Calculate the estimator costs missing from the cache, see CPathEstimator
+	void CalcPathCosts();
+	/// Write the calculated estimator costs to the cache, main thread only
+	void SavePathCosts();
+
 	//Minimum distance between two waypoints.
 	static const unsigned int PATH_RESOLUTION;
 
@@ -64,6 +64,14 @@ CR_REG_METADATA(CBuilderCAI , (
 CUnitSet CBuilderCAI::reclaimers;
 CUnitSet CBuilderCAI::featureReclaimers;
 
+// not adding to members either, only valid within one frame
+std::vector<CBuilderCAI::AreaQuery> CBuilderCAI::unitQueries;
+std::vector<CBuilderCAI::AreaQuery> CBuilderCAI::featureQueries;
+int CBuilderCAI::areaQueryFrame = -1;
+
+// beyond this many distinct searches per frame the cache is just reset
+static const unsigned int MAX_CACHED_AREA_QUERIES = 64;
+
 
 CBuilderCAI::CBuilderCAI()
 : CMobileCAI(),
@@ -895,7 +903,7 @@ void CBuilderCAI::ExecuteFight(Command& c)
 	}
 	float3 curPosOnLine = ClosestPointOnLine(commandPos1, commandPos2, owner->pos);
 	if ((owner->unitDef->canRepair || owner->unitDef->canAssist) &&
-	    FindRepairTargetAndRepair(curPosOnLine, 300*owner->moveState+fac->buildDistance-8,c.options,true)){
+	    FindRepairTargetAndRepair(curPosOnLine, 300*owner->moveState+fac->buildDistance-8,c.options,true,false)){
 		tempOrder = true;
 		inCommand = false;
 		if (lastPC1 != gs->frameNum) {  //avoid infinite loops
@@ -905,7 +913,7 @@ void CBuilderCAI::ExecuteFight(Command& c)
 		return;
 	}
 	if (owner->unitDef->canReclaim &&
-	    FindReclaimableFeatureAndReclaim(curPosOnLine,300,c.options,false, false)) {
+	    FindReclaimableFeatureAndReclaim(curPosOnLine,300,c.options,false, false, false)) {
 		tempOrder = true;
 		inCommand = false;
 		if (lastPC2 != gs->frameNum) {  //avoid infinite loops
@@ -1106,13 +1114,79 @@ bool CBuilderCAI::ReclaimObject(CSolidObject* object){
 //  Area searches
 //
 
+void CBuilderCAI::InvalidateAreaQueryCache()
+{
+	unitQueries.clear();
+	featureQueries.clear();
+}
+
+
+const std::vector<CUnit*>& CBuilderCAI::GetUnitsCached(const float3& pos, float radius)
+{
+	if (areaQueryFrame != gs->frameNum) {
+		InvalidateAreaQueryCache();
+		areaQueryFrame = gs->frameNum;
+	}
+
+	std::vector<AreaQuery>::iterator qi;
+	for (qi = unitQueries.begin(); qi != unitQueries.end(); ++qi) {
+		if ((qi->pos == pos) && (qi->radius == radius)) {
+			return qi->units;
+		}
+	}
+
+	if (unitQueries.size() >= MAX_CACHED_AREA_QUERIES) {
+		unitQueries.clear();
+	}
+
+	unitQueries.push_back(AreaQuery());
+	AreaQuery& q = unitQueries.back();
+	q.pos = pos;
+	q.radius = radius;
+	q.units = qf->GetUnits(pos, radius);
+	return q.units;
+}
+
+
+const std::vector<CFeature*>& CBuilderCAI::GetFeaturesExactCached(const float3& pos, float radius)
+{
+	if (areaQueryFrame != gs->frameNum) {
+		InvalidateAreaQueryCache();
+		areaQueryFrame = gs->frameNum;
+	}
+
+	std::vector<AreaQuery>::iterator qi;
+	for (qi = featureQueries.begin(); qi != featureQueries.end(); ++qi) {
+		if ((qi->pos == pos) && (qi->radius == radius)) {
+			return qi->features;
+		}
+	}
+
+	if (featureQueries.size() >= MAX_CACHED_AREA_QUERIES) {
+		featureQueries.clear();
+	}
+
+	featureQueries.push_back(AreaQuery());
+	AreaQuery& q = featureQueries.back();
+	q.pos = pos;
+	q.radius = radius;
+	q.features = qf->GetFeaturesExact(pos, radius);
+	return q.features;
+}
+
+
 bool CBuilderCAI::FindReclaimableFeatureAndReclaim(const float3& pos,
                                                    float radius,
                                                    unsigned char options,
                                                    bool noResCheck,
-                                                   bool recAnyTeam)
+                                                   bool recAnyTeam,
+                                                   bool areaCommand)
 {
-	const std::vector<CFeature*> features = qf->GetFeaturesExact(pos, radius);
+	std::vector<CFeature*> found;
+	if (!areaCommand) {
+		found = qf->GetFeaturesExact(pos, radius);
+	}
+	const std::vector<CFeature*>& features = areaCommand ? GetFeaturesExactCached(pos, radius) : found;
 	std::vector<CFeature*>::const_iterator fi;
 
 	const CFeature* best = NULL;
@@ -1158,7 +1232,7 @@ bool CBuilderCAI::FindResurrectableFeatureAndResurrect(const float3& pos,
                                                        float radius,
                                                        unsigned char options)
 {
-	const std::vector<CFeature*> features = qf->GetFeaturesExact(pos, radius);
+	const std::vector<CFeature*>& features = GetFeaturesExactCached(pos, radius);
 	std::vector<CFeature*>::const_iterator fi;
 
 	const CFeature* best = NULL;
@@ -1195,7 +1269,7 @@ bool CBuilderCAI::FindResurrectableFeatureAndResurrect(const float3& pos,
 bool CBuilderCAI::FindCaptureTargetAndCapture(const float3& pos, float radius,
                                               unsigned char options)
 {
-	const std::vector<CUnit*> cu = qf->GetUnits(pos, radius);
+	const std::vector<CUnit*>& cu = GetUnitsCached(pos, radius);
 	std::vector<CUnit*>::const_iterator ui;
 
 	const CUnit* best = NULL;
@@ -1235,9 +1309,14 @@ bool CBuilderCAI::FindCaptureTargetAndCapture(const float3& pos, float radius,
 
 bool CBuilderCAI::FindRepairTargetAndRepair(const float3& pos, float radius,
                                             unsigned char options,
-                                            bool attackEnemy)
+                                            bool attackEnemy,
+                                            bool areaCommand)
 {
-	const std::vector<CUnit*> cu = qf->GetUnits(pos, radius);
+	std::vector<CUnit*> found;
+	if (!areaCommand) {
+		found = qf->GetUnits(pos, radius);
+	}
+	const std::vector<CUnit*>& cu = areaCommand ? GetUnitsCached(pos, radius) : found;
 	std::vector<CUnit*>::const_iterator ui;
 
 	const CUnit* best = NULL;
@@ -2,11 +2,13 @@
 #define __BUILDER_CAI_H__
 
 #include <map>
+#include <vector>
 #include "MobileCAI.h"
 #include "Sim/Units/UnitDef.h"
 #include "Sim/Objects/SolidObject.h"
 
 class CUnitSet;
+class CFeature;
 
 class CBuilderCAI :
 	public CMobileCAI
@@ -27,12 +29,14 @@ public:
 	bool FindReclaimableFeatureAndReclaim(const float3& pos, float radius,
 	                                      unsigned char options,
 	                                      bool noResCheck,  // no resources check
-	                                      bool recAnyTeam); // allows self-reclamation
+	                                      bool recAnyTeam,  // allows self-reclamation
+	                                      bool areaCommand = true); // pos is shared, see GetUnitsCached
 	bool FindResurrectableFeatureAndResurrect(const float3& pos, float radius,
 	                                          unsigned char options);
 	void FinishCommand(void);
 	bool FindRepairTargetAndRepair(const float3& pos, float radius,
-	                               unsigned char options, bool attackEnemy);
+	                               unsigned char options, bool attackEnemy,
+	                               bool areaCommand = true);
 	bool FindCaptureTargetAndCapture(const float3& pos, float radius,
 	                                 unsigned char options);
 
@@ -97,7 +101,28 @@ private:
 public:
 	static bool IsFeatureBeingReclaimed(int);
 
+	// called when units or features are added or removed
+	static void InvalidateAreaQueryCache();
+
 private:
+	// area searches issued by builders during the same frame
+	// (eg. many cons sharing one area-reclaim order) reuse the
+	// quadfield results of the first search with equal arguments;
+	// searches around a builder's own position (fight, patrol) do
+	// not go through here since they practically never repeat
+	struct AreaQuery {
+		float3 pos;
+		float radius;
+		std::vector<CUnit*> units;
+		std::vector<CFeature*> features;
+	};
+
+	static const std::vector<CUnit*>& GetUnitsCached(const float3& pos, float radius);
+	static const std::vector<CFeature*>& GetFeaturesExactCached(const float3& pos, float radius);
+
+	static std::vector<AreaQuery> unitQueries;
+	static std::vector<AreaQuery> featureQueries;
+	static int areaQueryFrame;
 };
 
 #endif // __BUILDER_CAI_H__
@@ -213,6 +213,8 @@ int CUnitHandler::AddUnit(CUnit *unit)
 
 	maxUnitRadius = max(unit->radius, maxUnitRadius);
 
+	CBuilderCAI::InvalidateAreaQueryCache();
+
 	GML_STDMUTEX_LOCK(render);
 
 	toBeAdded.insert(unit);
@@ -248,6 +250,7 @@ void CUnitHandler::DeleteUnitNow(CUnit* delUnit)
 			unitsByDefs[delTeam][delType].erase(delUnit);
 
 			delete delUnit;
+			CBuilderCAI::InvalidateAreaQueryCache();
 			break;
 		}
 	}
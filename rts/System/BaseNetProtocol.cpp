@@ -156,11 +156,13 @@ PacketType CBaseNetProtocol::SendDirectControlUpdate(uchar myPlayerNum, uchar st
 }
 
 
-PacketType CBaseNetProtocol::SendAttemptConnect(const std::string name, const std::string version)
+PacketType CBaseNetProtocol::SendAttemptConnect(const std::string name, const std::string version, bool isRelay)
 {
-	uint16_t size = 5 + name.size() + version.size();
+	uint16_t size = 5 + name.size() + version.size() + (isRelay ? 1 : 0);
 	PackPacket* packet = new PackPacket(size , NETMSG_ATTEMPTCONNECT);
 	*packet << size << name << version;
+	if (isRelay)
+		*packet << (uchar)1;
 	return PacketType(packet);
 }
 
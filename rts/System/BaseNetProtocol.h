@@ -10,7 +10,8 @@ namespace netcode
 	class RawPacket;
 }
 
-const unsigned char NETWORK_VERSION = 1;
+/// 2: UDP header with header version, flags and sack (see UDPConnection.h)
+const unsigned char NETWORK_VERSION = 2;
 
 /*
 Comment behind NETMSG enumeration constant gives the extra data belonging to
@@ -52,7 +53,7 @@ enum NETMSG {
 	NETMSG_CPU_USAGE        = 21, // float cpuUsage;
 	NETMSG_DIRECT_CONTROL   = 22, // uchar myPlayerNum;
 	NETMSG_DC_UPDATE        = 23, // uchar myPlayerNum, status; short heading, pitch;
-	NETMSG_ATTEMPTCONNECT   = 25, // ushort msgsize, string playername, string VERSION_STRING_DETAILED
+	NETMSG_ATTEMPTCONNECT   = 25, // ushort msgsize, string playername, string VERSION_STRING_DETAILED, (optional) uchar isRelay
 	NETMSG_SHARE            = 26, // uchar myPlayerNum, shareTeam, bShareUnits; float shareMetal, shareEnergy;
 	NETMSG_SETSHARE         = 27, // uchar myPlayerNum, uchar myTeam; float metalShareFraction, energyShareFraction;
 	NETMSG_SENDPLAYERSTAT   = 28, //
@@ -129,7 +130,7 @@ public:
 	PacketType SendCPUUsage(float cpuUsage);
 	PacketType SendDirectControl(uchar myPlayerNum);
 	PacketType SendDirectControlUpdate(uchar myPlayerNum, uchar status, short heading, short pitch);
-	PacketType SendAttemptConnect(const std::string name, const std::string version);
+	PacketType SendAttemptConnect(const std::string name, const std::string version, bool isRelay = false);
 	PacketType SendShare(uchar myPlayerNum, uchar shareTeam, uchar bShareUnits, float shareMetal, float shareEnergy);
 	PacketType SendSetShare(uchar myPlayerNum, uchar myTeam, float metalShareFraction, float energyShareFraction);
 	PacketType SendSendPlayerStat();
@@ -141,6 +141,7 @@ ConfigHandler::~ConfigHandler()
  */
 string ConfigHandler::GetString(const string name, const string def)
 {
+	boost::recursive_mutex::scoped_lock lock(mutex);
 	std::map<string,string>::iterator pos = data.find(name);
 	if (pos == data.end()) {
 		SetString(name, def);
@@ -171,6 +172,7 @@ string ConfigHandler::GetString(const string name, const string def)
  */
 void ConfigHandler::SetString(const string name, const string value)
 {
+	boost::recursive_mutex::scoped_lock lock(mutex);
 	FILE* file = fopen(filename.c_str(), "r+");
 
 	if (file) {
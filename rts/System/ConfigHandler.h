@@ -14,6 +14,7 @@
 #include <sstream>
 #include <map>
 #include <stdio.h>
+#include <boost/thread/recursive_mutex.hpp>
 
 #ifdef __FreeBSD__
 #include <sys/stat.h>
@@ -25,6 +26,7 @@
  * This is the abstract configuration handler class used
  * for polymorphic configuration.  Platform-specifics should derive
  * from this.
+ * Get, GetString and SetString may be called from any thread.
  */
 class ConfigHandler
 {
@@ -56,6 +58,7 @@ public:
 	template<typename T>
 	T Get(const std::string& name, const T& def)
 	{
+		boost::recursive_mutex::scoped_lock lock(mutex);
 		std::map<std::string, std::string>::iterator pos = data.find(name);
 		if (pos == data.end()) {
 			Set(name, def);
@@ -99,6 +102,9 @@ private:
 	 */
 	std::map<std::string, std::string> data;
 
+	/// guards data and the file, Get may call SetString
+	boost::recursive_mutex mutex;
+
 	/**
 	 * @brief Get the name of the default configuration file
 	 */
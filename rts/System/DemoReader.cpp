@@ -4,6 +4,8 @@
 #include <limits.h>
 #include <stdexcept>
 #include <assert.h>
+#include <algorithm>
+#include <zlib.h>
 #include "mmgr.h"
 
 #include "Game/GameSetup.h"
@@ -15,6 +17,9 @@
 // CDemoReader implementation
 
 CDemoReader::CDemoReader(const std::string& filename, float curTime)
+: curBlock(0)
+, blockPos(0)
+, streamEof(false)
 {
 	std::string firstTry = "demos/" + filename;
 
@@ -32,12 +37,19 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		throw std::runtime_error(std::string("Demofile not found: ")+filename);
 	}
 
-	playbackDemo->Read((void*)&fileHeader, sizeof(fileHeader));
+	// demos recorded before the index was added have a shorter header
+	memset(&fileHeader, 0, sizeof(fileHeader));
+	playbackDemo->Read((void*)&fileHeader, DEMOFILE_HEADER_SIZE_NOINDEX);
+	const int headerSize = std::min((int)swabdword(fileHeader.headerSize), (int)sizeof(fileHeader));
+	if (headerSize > (int)DEMOFILE_HEADER_SIZE_NOINDEX)
+		playbackDemo->Read((char*)&fileHeader + DEMOFILE_HEADER_SIZE_NOINDEX, headerSize - DEMOFILE_HEADER_SIZE_NOINDEX);
 	fileHeader.swab();
 
 	if (memcmp(fileHeader.magic, DEMOFILE_MAGIC, sizeof(fileHeader.magic))
-		|| fileHeader.version != DEMOFILE_VERSION
-		|| fileHeader.headerSize != sizeof(fileHeader)
+		|| (fileHeader.version != DEMOFILE_VERSION && fileHeader.version != DEMOFILE_VERSION_3)
+		|| fileHeader.headerSize < (int)DEMOFILE_HEADER_SIZE_NOINDEX
+		|| (fileHeader.streamCompression != DEMOFILE_COMPRESSION_NONE && fileHeader.streamCompression != DEMOFILE_COMPRESSION_ZLIB)
+		|| (fileHeader.version == DEMOFILE_VERSION_3 && fileHeader.streamCompression != DEMOFILE_COMPRESSION_NONE)
 		// Don't compare spring version in debug mode: we don't want to make
 		// debugging SVN demos impossible (because VERSION_STRING is different
 		// each build.)
@@ -50,25 +62,27 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		throw std::runtime_error(std::string("Demofile corrupt or created by a different version of Spring: ")+filename);
 	}
 
+	playbackDemo->Seek(fileHeader.headerSize);
+
 	if (fileHeader.scriptSize != 0) {
 		char* buf = new char[fileHeader.scriptSize];
 		playbackDemo->Read(buf, fileHeader.scriptSize);
-		setupScript = std::string(buf);
+		setupScript = std::string(buf, fileHeader.scriptSize);
 		delete[] buf;
 	}
 
-	playbackDemo->Read((void*)&chunkHeader, sizeof(chunkHeader));
-	chunkHeader.swab();
-
-	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
-	nextDemoRead = curTime - 0.01f;
+	streamStart = fileHeader.headerSize + fileHeader.scriptSize;
+	if (fileHeader.streamCompression == DEMOFILE_COMPRESSION_NONE)
+		fileHeader.rawStreamSize = fileHeader.demoStreamSize;
+	else
+		ReadBlockTable();
+	ReadIndex();
+	SeekToStreamOffset(0, curTime);
+}
 
-	if (fileHeader.demoStreamSize != 0) {
-		bytesRemaining = fileHeader.demoStreamSize - sizeof(chunkHeader);
-	} else {
-		// Spring crashed while recording the demo: replay until EOF.
-		bytesRemaining = INT_MAX;
-	}
+CDemoReader::~CDemoReader()
+{
+	delete playbackDemo;
 }
 
 netcode::RawPacket* CDemoReader::GetData(float curTime)
@@ -79,10 +93,10 @@ netcode::RawPacket* CDemoReader::GetData(float curTime)
 	// when paused, modGameTime wont increase so no seperate check needed
 	if (nextDemoRead < curTime) {
 		netcode::RawPacket* buf = new netcode::RawPacket(chunkHeader.length);
-		playbackDemo->Read((void*)(buf->data), chunkHeader.length);
+		ReadStream((void*)(buf->data), chunkHeader.length);
 		bytesRemaining -= chunkHeader.length;
 
-		playbackDemo->Read((void*)&chunkHeader, sizeof(chunkHeader));
+		ReadStream((void*)&chunkHeader, sizeof(chunkHeader));
 		chunkHeader.swab();
 		nextDemoRead = chunkHeader.modGameTime + demoTimeOffset;
 		bytesRemaining -= sizeof(chunkHeader);
@@ -95,7 +109,8 @@ netcode::RawPacket* CDemoReader::GetData(float curTime)
 
 bool CDemoReader::ReachedEnd() const
 {
-	if (bytesRemaining <= 0 || playbackDemo->Eof())
+	const bool compressed = (fileHeader.streamCompression != DEMOFILE_COMPRESSION_NONE);
+	if (bytesRemaining <= 0 || (compressed ? streamEof : playbackDemo->Eof()))
 		return true;
 	else
 		return false;
@@ -105,3 +120,184 @@ float CDemoReader::GetNextReadTime() const
 {
 	return chunkHeader.modGameTime;
 }
+
+int CDemoReader::SeekToFrame(int frameNum, float curTime)
+{
+	// last entry with entry.frameNum <= frameNum
+	int lo = 0, hi = index.size();
+	while (lo < hi) {
+		const int mid = (lo + hi) / 2;
+		if (index[mid].frameNum <= frameNum)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0) {
+		SeekToStreamOffset(0, curTime);
+		return 0;
+	}
+	SeekToStreamOffset(index[lo - 1].streamOffset, curTime);
+	return index[lo - 1].frameNum;
+}
+
+int CDemoReader::SeekToTime(float modGameTime, float curTime)
+{
+	int lo = 0, hi = index.size();
+	while (lo < hi) {
+		const int mid = (lo + hi) / 2;
+		if (index[mid].modGameTime <= modGameTime)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0) {
+		SeekToStreamOffset(0, curTime);
+		return 0;
+	}
+	SeekToStreamOffset(index[lo - 1].streamOffset, curTime);
+	return index[lo - 1].frameNum;
+}
+
+/** @brief Load the keyframe index, if there is one.
+The index is only trusted if the demo was closed properly, otherwise the
+chunk offsets are unknown. */
+void CDemoReader::ReadIndex()
+{
+	if (fileHeader.indexSize < (int)sizeof(DemoIndexHeader) || fileHeader.demoStreamSize == 0)
+		return;
+
+	const int indexStart = streamStart + fileHeader.demoStreamSize + fileHeader.playerStatSize + fileHeader.teamStatSize;
+	playbackDemo->Seek(indexStart);
+
+	DemoIndexHeader header;
+	playbackDemo->Read((void*)&header, sizeof(header));
+	header.swab();
+
+	if (header.numEntries <= 0 || sizeof(header) + header.numEntries * sizeof(DemoIndexEntry) > (unsigned)fileHeader.indexSize)
+		return;
+
+	index.resize(header.numEntries);
+	playbackDemo->Read((void*)&index[0], header.numEntries * sizeof(DemoIndexEntry));
+	for (std::vector<DemoIndexEntry>::iterator it = index.begin(); it != index.end(); ++it) {
+		it->swab();
+		if (it->streamOffset < 0 || it->streamOffset >= fileHeader.rawStreamSize) {
+			// corrupt, fall back to reading from the start
+			index.clear();
+			return;
+		}
+	}
+}
+
+/** @brief Find the blocks of a compressed demo stream.
+Walks the block headers instead of trusting demoStreamSize, so demos of
+crashed games (demoStreamSize 0) can be played up to their last whole block. */
+void CDemoReader::ReadBlockTable()
+{
+	const int streamEnd = (fileHeader.demoStreamSize != 0) ? streamStart + fileHeader.demoStreamSize : INT_MAX;
+	int pos = streamStart;
+	int rawOffset = 0;
+
+	while (pos + (int)sizeof(DemoStreamBlockHeader) <= streamEnd) {
+		DemoStreamBlockHeader header;
+		playbackDemo->Seek(pos);
+		if (playbackDemo->Read((void*)&header, sizeof(header)) != sizeof(header))
+			break;
+		header.swab();
+		pos += sizeof(header);
+		if (header.rawSize <= 0 || header.rawSize > DEMOFILE_MAX_BLOCK_SIZE || header.compressedSize <= 0 || header.compressedSize > streamEnd - pos)
+			break;
+
+		StreamBlock block;
+		block.rawOffset = rawOffset;
+		block.rawSize = header.rawSize;
+		block.filePos = pos;
+		block.compressedSize = header.compressedSize;
+		blocks.push_back(block);
+
+		rawOffset += header.rawSize;
+		pos += header.compressedSize;
+	}
+	if (fileHeader.demoStreamSize == 0 && !blocks.empty()) {
+		// the last block may have been cut off by the crash
+		playbackDemo->Seek(blocks.back().filePos + blocks.back().compressedSize - 1);
+		char c;
+		if (playbackDemo->Read(&c, 1) != 1) {
+			rawOffset -= blocks.back().rawSize;
+			blocks.pop_back();
+		}
+	}
+	fileHeader.rawStreamSize = rawOffset;
+}
+
+bool CDemoReader::LoadBlock(unsigned num)
+{
+	if (num >= blocks.size())
+		return false;
+
+	const StreamBlock& block = blocks[num];
+	std::vector<unsigned char> compressed(block.compressedSize);
+	playbackDemo->Seek(block.filePos);
+	if (playbackDemo->Read((void*)&compressed[0], block.compressedSize) != block.compressedSize)
+		return false;
+
+	blockData.resize(block.rawSize);
+	uLongf rawSize = block.rawSize;
+	if (uncompress(&blockData[0], &rawSize, &compressed[0], block.compressedSize) != Z_OK || (int)rawSize != block.rawSize)
+		return false;
+
+	curBlock = num;
+	blockPos = 0;
+	return true;
+}
+
+int CDemoReader::ReadStream(void* buf, int length)
+{
+	if (fileHeader.streamCompression == DEMOFILE_COMPRESSION_NONE)
+		return playbackDemo->Read(buf, length);
+
+	int done = 0;
+	while (done < length) {
+		if (blockPos >= (int)blockData.size() && !LoadBlock(curBlock + 1)) {
+			streamEof = true;
+			break;
+		}
+		const int n = std::min(length - done, (int)blockData.size() - blockPos);
+		memcpy((char*)buf + done, &blockData[blockPos], n);
+		blockPos += n;
+		done += n;
+	}
+	return done;
+}
+
+void CDemoReader::SeekToStreamOffset(int streamOffset, float curTime)
+{
+	if (fileHeader.streamCompression == DEMOFILE_COMPRESSION_NONE) {
+		playbackDemo->Seek(streamStart + streamOffset);
+	} else if (blocks.empty()) {
+		streamEof = true;
+	} else {
+		// last block starting at or before streamOffset
+		unsigned lo = 0, hi = blocks.size();
+		while (hi - lo > 1) {
+			const unsigned mid = (lo + hi) / 2;
+			if (blocks[mid].rawOffset <= streamOffset)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		streamEof = !LoadBlock(lo);
+		blockPos = streamOffset - blocks[lo].rawOffset;
+	}
+	ReadStream((void*)&chunkHeader, sizeof(chunkHeader));
+	chunkHeader.swab();
+
+	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
+	nextDemoRead = curTime - 0.01f;
+
+	if (fileHeader.demoStreamSize != 0 || fileHeader.streamCompression != DEMOFILE_COMPRESSION_NONE) {
+		bytesRemaining = fileHeader.rawStreamSize - streamOffset - sizeof(chunkHeader);
+	} else {
+		// Spring crashed while recording the demo: replay until EOF.
+		bytesRemaining = INT_MAX;
+	}
+}
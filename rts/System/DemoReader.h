@@ -1,6 +1,8 @@
 #ifndef DEMO_READER
 #define DEMO_READER
 
+#include <vector>
+
 #include "Demo.h"
 
 class CFileHandler;
@@ -17,6 +19,7 @@ public:
 	@throw std::runtime_error Demofile not found / header corrupt / outdated
 	*/
 	CDemoReader(const std::string& filename, float curTime);
+	~CDemoReader();
 	
 	/**
 	@brief read from demo file
@@ -36,13 +39,62 @@ public:
 		return setupScript;
 	};
 
+	/// Wether the demo has a keyframe index (demos of crashed games and older ones don't)
+	bool HasIndex() const { return !index.empty(); }
+	const std::vector<DemoIndexEntry>& GetIndex() const { return index; }
+
+	/**
+	@brief jump to the last indexed frame at or before frameNum
+	Without index (or before the first entry) this rewinds to the start of the
+	demo stream. Reading continues from there as if the demo was just opened
+	at curTime.
+	@return the frame started by the next message GetData() returns,
+	0 when rewound to the start of the stream
+	*/
+	int SeekToFrame(int frameNum, float curTime);
+
+	/**
+	@brief jump to the last indexed frame at or before modGameTime
+	@return see SeekToFrame()
+	*/
+	int SeekToTime(float modGameTime, float curTime);
+
 private:
+	struct StreamBlock
+	{
+		int rawOffset;
+		int rawSize;
+		/// file position of the zlib data
+		int filePos;
+		int compressedSize;
+	};
+
+	void ReadIndex();
+	/// find the blocks of a compressed demo stream
+	void ReadBlockTable();
+	/// continue reading with the chunk at streamOffset
+	void SeekToStreamOffset(int streamOffset, float curTime);
+	/// read from the (decompressed) demo stream
+	int ReadStream(void* buf, int length);
+	bool LoadBlock(unsigned num);
+
 	CFileHandler* playbackDemo;
 	float demoTimeOffset;
 	float nextDemoRead;
 	int bytesRemaining;
 	DemoStreamChunkHeader chunkHeader;
 	std::string setupScript;	// the original, unaltered version from script
+	/// file position of the demo stream
+	int streamStart;
+	std::vector<DemoIndexEntry> index;
+
+	/// empty if the demo stream is not compressed
+	std::vector<StreamBlock> blocks;
+	std::vector<unsigned char> blockData;
+	unsigned curBlock;
+	int blockPos;
+	/// tried to read past the last block
+	bool streamEof;
 };
 
 #endif
@@ -4,6 +4,8 @@
 #include <assert.h>
 #include <time.h>
 #include <errno.h>
+#include <zlib.h>
+#include <boost/bind.hpp>
 
 #include "mmgr.h"
 
@@ -14,9 +16,17 @@
 #include "Exceptions.h"
 #include "Util.h"
 #include "GlobalUnsynced.h"
+#include "BaseNetProtocol.h"
+#include "ConfigHandler.h"
 
 #include "LogOutput.h"
 
+namespace {
+/// hand the stream to the writer once this much has been collected ...
+const unsigned blockSize = DEMOFILE_BLOCK_SIZE;
+// ... or at every keyframe index entry, so a crash loses at most that much
+}
+
 #ifdef __GNUC__
 #define __time64_t time_t
 #define _time64(x) time(x)
@@ -24,6 +34,10 @@
 #endif
 
 CDemoRecorder::CDemoRecorder()
+: frameNum(0)
+, quitWriter(false)
+, writerThread(NULL)
+, streamFailed(false)
 {
 	// We want this folder to exist
 	if (!filesystem.CreateDirectory("demos"))
@@ -38,6 +52,7 @@ CDemoRecorder::CDemoRecorder()
 	memset(&fileHeader, 0, sizeof(DemoFileHeader));
 	strcpy(fileHeader.magic, DEMOFILE_MAGIC);
 	fileHeader.version = DEMOFILE_VERSION;
+	fileHeader.streamCompression = configHandler.Get("DemoCompression", 1) ? DEMOFILE_COMPRESSION_ZLIB : DEMOFILE_COMPRESSION_NONE;
 	fileHeader.headerSize = sizeof(DemoFileHeader);
 	strcpy(fileHeader.versionString, SpringVersion::Get().c_str());
 
@@ -53,12 +68,28 @@ CDemoRecorder::CDemoRecorder()
 	fileHeader.winningAllyTeam = -1;
 
 	WriteFileHeader(false);
+
+	block.reserve(blockSize + 4096);
+	writerThread = new boost::thread(boost::bind(&CDemoRecorder::WriterThreadProc, this));
 }
 
 CDemoRecorder::~CDemoRecorder()
 {
+	if (writerThread) {
+		QueueBlock();
+		{
+			boost::mutex::scoped_lock lock(queueMutex);
+			quitWriter = true;
+			queueCondition.notify_all();
+		}
+		writerThread->join();
+		delete writerThread;
+		writerThread = NULL;
+	}
+
 	WritePlayerStats();
 	WriteTeamStats();
+	WriteIndex();
 	WriteFileHeader();
 
 	recordDemo.close();
@@ -81,6 +112,7 @@ void CDemoRecorder::WriteSetupText(const std::string& text)
 	while (text.c_str()[length - 1] == '\0')
 		--length;
 
+	boost::mutex::scoped_lock lock(fileMutex);
 	fileHeader.scriptSize = length;
 	recordDemo.write(text.c_str(), length);
 }
@@ -89,13 +121,92 @@ void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length)
 {
 	DemoStreamChunkHeader chunkHeader;
 
+	if (length > 0 && (buf[0] == NETMSG_NEWFRAME || buf[0] == NETMSG_KEYFRAME)) {
+		++frameNum;
+		if (frameNum % DEMOFILE_INDEX_INTERVAL == 0) {
+			QueueBlock();
+			DemoIndexEntry entry;
+			entry.frameNum = frameNum;
+			entry.modGameTime = gu->modGameTime;
+			entry.streamOffset = fileHeader.rawStreamSize;
+			index.push_back(entry);
+		}
+	}
+
 	chunkHeader.modGameTime = gu->modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
-	recordDemo.write((char*)&chunkHeader, sizeof(chunkHeader));
-	recordDemo.write((char*)buf, length);
-	fileHeader.demoStreamSize += length + sizeof(chunkHeader);
-	recordDemo.flush();
+	block.insert(block.end(), (unsigned char*)&chunkHeader, (unsigned char*)&chunkHeader + sizeof(chunkHeader));
+	block.insert(block.end(), buf, buf + length);
+	fileHeader.rawStreamSize += length + sizeof(chunkHeader);
+
+	if (block.size() >= blockSize)
+		QueueBlock();
+}
+
+void CDemoRecorder::QueueBlock()
+{
+	if (!writerThread)
+		block.clear(); // not recording
+	if (block.empty())
+		return;
+
+	std::vector<unsigned char>* queued = new std::vector<unsigned char>();
+	queued->reserve(blockSize + 4096);
+	queued->swap(block);
+
+	boost::mutex::scoped_lock lock(queueMutex);
+	writeQueue.push_back(queued);
+	queueCondition.notify_all();
+}
+
+void CDemoRecorder::WriterThreadProc()
+{
+	while (true) {
+		std::vector<unsigned char>* next = NULL;
+		{
+			boost::mutex::scoped_lock lock(queueMutex);
+			while (writeQueue.empty() && !quitWriter)
+				queueCondition.wait(lock);
+			if (writeQueue.empty())
+				return; // quitWriter and everything written
+			next = writeQueue.front();
+			writeQueue.pop_front();
+		}
+		WriteBlock(*next);
+		delete next;
+	}
+}
+
+void CDemoRecorder::WriteBlock(const std::vector<unsigned char>& data)
+{
+	if (streamFailed)
+		return; // the stream must not have a gap
+	if (fileHeader.streamCompression == DEMOFILE_COMPRESSION_ZLIB) {
+		uLongf compressedSize = compressBound(data.size());
+		compressBuffer.resize(compressedSize);
+		if (compress2(&compressBuffer[0], &compressedSize, &data[0], data.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+			logOutput.Print("Demo recording: compressing failed, demo is truncated");
+			streamFailed = true;
+			return;
+		}
+
+		DemoStreamBlockHeader header;
+		header.rawSize = data.size();
+		header.compressedSize = compressedSize;
+		header.swab();
+
+		boost::mutex::scoped_lock lock(fileMutex);
+		recordDemo.write((char*)&header, sizeof(header));
+		recordDemo.write((char*)&compressBuffer[0], compressedSize);
+		recordDemo.flush();
+		fileHeader.demoStreamSize += sizeof(header) + compressedSize;
+	} else {
+		boost::mutex::scoped_lock lock(fileMutex);
+		recordDemo.write((char*)&data[0], data.size());
+		recordDemo.flush();
+		fileHeader.demoStreamSize += data.size();
+	}
 }
 
 void CDemoRecorder::SetName(const std::string& mapname)
@@ -197,14 +308,17 @@ Write the DemoFileHeader at the start of the file and restores the original
 position in the file afterwards. */
 void CDemoRecorder::WriteFileHeader(bool updateStreamLength)
 {
+	boost::mutex::scoped_lock lock(fileMutex);
 	int pos = recordDemo.tellp();
 
 	recordDemo.seekp(0);
 
 	DemoFileHeader tmpHeader;
 	memcpy(&tmpHeader, &fileHeader, sizeof(fileHeader));
-	if (!updateStreamLength)
+	if (!updateStreamLength) {
 		tmpHeader.demoStreamSize = 0;
+		tmpHeader.rawStreamSize = 0;
+	}
 	tmpHeader.swab(); // to little endian
 	recordDemo.write((char*)&tmpHeader, sizeof(tmpHeader));
 	recordDemo.seekp(pos);
@@ -254,3 +368,27 @@ void CDemoRecorder::WriteTeamStats()
 
 	fileHeader.teamStatSize = (int)recordDemo.tellp() - pos;
 }
+
+/** @brief Write the keyframe index at the current position in the file. */
+void CDemoRecorder::WriteIndex()
+{
+	if (index.empty())
+		return;
+
+	int pos = recordDemo.tellp();
+
+	DemoIndexHeader header;
+	header.numEntries = index.size();
+	header.frameInterval = DEMOFILE_INDEX_INTERVAL;
+	header.swab();
+	recordDemo.write((char*)&header, sizeof(header));
+
+	for (std::vector<DemoIndexEntry>::iterator it = index.begin(); it != index.end(); ++it) {
+		DemoIndexEntry& entry = *it;
+		entry.swab();
+		recordDemo.write((char*)&entry, sizeof(DemoIndexEntry));
+	}
+	index.clear();
+
+	fileHeader.indexSize = (int)recordDemo.tellp() - pos;
+}
@@ -2,7 +2,11 @@
 #define DEMO_RECORDER
 
 #include <vector>
+#include <deque>
 #include <fstream>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
 #include "Demo.h"
 #include "Game/Player.h"
@@ -10,6 +14,8 @@
 
 /**
 @brief Used to record demos
+The demo stream is collected in blocks, which are compressed (if enabled) and
+written by a background thread, so recording never waits for the disk.
  */
 class CDemoRecorder : public CDemo
 {
@@ -42,11 +48,35 @@ private:
 	void WriteFileHeader(bool updateStreamLength = true);
 	void WritePlayerStats();
 	void WriteTeamStats();
+	void WriteIndex();
+
+	/// hand the current block to the writer thread
+	void QueueBlock();
+	void WriterThreadProc();
+	/// compress (if enabled) and append a block of the demo stream, writer thread only
+	void WriteBlock(const std::vector<unsigned char>& block);
 
 	std::ofstream recordDemo;
+	/// guards recordDemo and fileHeader.demoStreamSize against the writer thread
+	boost::mutex fileMutex;
 	std::string wantedName;
 	std::vector< CPlayer::Statistics > playerStats;
 	std::vector< std::vector<CTeam::Statistics> > teamStats;
+
+	/// frames recorded so far, counted like the server does
+	int frameNum;
+	std::vector<DemoIndexEntry> index;
+
+	/// demo stream not yet handed to the writer thread
+	std::vector<unsigned char> block;
+	std::deque< std::vector<unsigned char>* > writeQueue;
+	volatile bool quitWriter;
+	boost::thread* writerThread;
+	boost::mutex queueMutex;
+	boost::condition queueCondition;
+	std::vector<unsigned char> compressBuffer;
+	/// a block could not be written, the ones after it are dropped too
+	bool streamFailed;
 };
 
 
@@ -30,7 +30,8 @@ SZ_RESULT SzFileSeekImp(void *object, CFileSize pos)
 CArchive7Zip::CArchive7Zip(const std::string& name):
 	CArchiveBuffered(name),
 	curSearchHandle(1),
-	isOpen(false)
+	isOpen(false),
+	archiveName(name)
 {
 	SZ_RESULT res;
 
@@ -133,6 +134,68 @@ ABOpenFile_t* CArchive7Zip::GetEntireFile(const std::string& fName)
 	return of;
 }
 
+void CArchive7Zip::PrefetchFiles(const std::vector<std::string>& fileNames, int numThreads)
+{
+	if (!isOpen)
+		return;
+
+	// group by block, files without data (folder -1) go together
+	std::map<UInt32, std::vector<std::pair<int, std::string> > > blocks;
+	for (std::vector<std::string>::const_iterator it = fileNames.begin(); it != fileNames.end(); ++it) {
+		std::map<std::string, FileData>::const_iterator fd = fileData.find(*it);
+		if (fd != fileData.end())
+			blocks[db.FileIndexToFolderIndexMap[fd->second.fp]].push_back(std::make_pair(fd->second.fp, *it));
+	}
+
+	prefetchBlocks.clear();
+	for (std::map<UInt32, std::vector<std::pair<int, std::string> > >::iterator b = blocks.begin(); b != blocks.end(); ++b) {
+		// in archive order, which is the order they were packed into the block
+		std::sort(b->second.begin(), b->second.end());
+		prefetchBlocks.push_back(std::vector<std::string>());
+		for (unsigned i = 0; i < b->second.size(); ++i)
+			prefetchBlocks.back().push_back(b->second[i].second);
+	}
+
+	numPrefetchJobs = prefetchBlocks.size();
+	RunPrefetchWorkers(numThreads);
+	prefetchBlocks.clear();
+}
+
+void CArchive7Zip::PrefetchWorker()
+{
+	CFileInStream stream;
+	stream.File = fopen(archiveName.c_str(), "rb");
+	if (stream.File == 0)
+		return;
+	stream.InStream.Read = SzFileReadImp;
+	stream.InStream.Seek = SzFileSeekImp;
+
+	unsigned job;
+	while (NextPrefetchJob(job)) {
+		// kept over the files of the block, so it is decompressed only once
+		UInt32 blockIndex = 0xFFFFFFFF;
+		Byte* outBuffer = 0;
+		size_t outBufferSize = 0;
+
+		const std::vector<std::string>& names = prefetchBlocks[job];
+		for (unsigned i = 0; i < names.size(); ++i) {
+			const FileData& fd = fileData.find(names[i])->second;
+			size_t offset;
+			size_t outSizeProcessed;
+			if (SzExtract(&stream.InStream, &db, fd.fp, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp) != SZ_OK)
+				break;
+
+			char* data = (char*)malloc(outSizeProcessed);
+			if (data || outSizeProcessed == 0) {
+				memcpy(data, outBuffer + offset, outSizeProcessed);
+				CacheFile(names[i], data, outSizeProcessed);
+			}
+		}
+		allocImp.Free(outBuffer);
+	}
+	fclose(stream.File);
+}
+
 void CArchive7Zip::SetSlashesForwardToBack(std::string& name)
 {
 	for (unsigned int i = 0; i < name.length(); ++i) {
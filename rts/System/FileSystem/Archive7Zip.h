@@ -36,7 +36,16 @@ protected:
 	ISzAlloc allocTempImp;
 
 	bool isOpen;
+	std::string archiveName;
 	virtual ABOpenFile_t* GetEntireFile(const std::string& fName);
+	/**
+	One job per solid block, so every block is decoded once, by one worker
+	with its own file handle. The database is shared, SzExtract only reads it.
+	*/
+	virtual void PrefetchFiles(const std::vector<std::string>& fileNames, int numThreads);
+	virtual void PrefetchWorker();
+	/// names of the prefetched files, per job
+	std::vector<std::vector<std::string> > prefetchBlocks;
 	void SetSlashesForwardToBack(std::string& name);
 public:
 	CArchive7Zip(const std::string& name);
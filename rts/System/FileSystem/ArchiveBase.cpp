@@ -1,4 +1,5 @@
 #include "ArchiveBase.h"
+#include "FileMapping.h"
 #include "CRC.h"
 
 unsigned int CArchiveBase::GetCrc32(const std::string& fileName)
@@ -9,6 +10,13 @@ unsigned int CArchiveBase::GetCrc32(const std::string& fileName)
 	int maxRead;
 	int total = 0;
 
+	CFileMapping* mapping = MapFile(fileName);
+	if (mapping) {
+		crc.Update(mapping->GetData(), mapping->GetSize());
+		delete mapping;
+		return crc.GetDigest();
+	}
+
 	handle = this->OpenFile(fileName);
 	if (handle == 0) return crc.GetDigest();
 
@@ -21,3 +29,8 @@ unsigned int CArchiveBase::GetCrc32(const std::string& fileName)
 	this->CloseFile(handle);
 	return crc.GetDigest();
 };
+
+CFileMapping* CArchiveBase::MapFile(const std::string& fileName)
+{
+	return NULL;
+}
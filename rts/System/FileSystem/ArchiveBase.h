@@ -5,6 +5,8 @@
 
 #include <string>
 
+class CFileMapping;
+
 class CArchiveBase
 {
 public:
@@ -20,6 +22,12 @@ public:
 	virtual int FileSize(int handle) = 0;
 	virtual int FindFiles(int cur, std::string* name, int* size) = 0;
 	virtual unsigned int GetCrc32 (const std::string& fileName);
+	/**
+	@brief Map a file stored uncompressed in the archive into memory
+	@return NULL if the file does not exist or is not stored in a mappable
+	way, use OpenFile / ReadFile then. The caller deletes the mapping.
+	*/
+	virtual CFileMapping* MapFile(const std::string& fileName);
 };
 
 #endif
@@ -1,8 +1,13 @@
 #include "StdAfx.h"
 #include "ArchiveBuffered.h"
+#include "ArchiveFileCache.h"
 #include <stdexcept>
+#include <set>
+#include <boost/bind.hpp>
 #include <stdlib.h>
 #include <string.h>
+#include "Util.h"
+#include "WorkerThreads.h"
 #include "mmgr.h"
 
 
@@ -18,23 +23,42 @@ inline ABOpenFile_t* CArchiveBuffered::GetOpenFile(int handle)
 
 CArchiveBuffered::CArchiveBuffered(const std::string& name):
 	CArchiveBase(name),
-	curFileHandle(1)
+	curFileHandle(1),
+	cacheKey(CArchiveFileCache::GetArchiveKey(name)),
+	numPrefetchJobs(0),
+	nextPrefetchJob(0)
 {
 }
 
 CArchiveBuffered::~CArchiveBuffered(void)
 {
 	for (std::map<int, ABOpenFile_t*>::iterator i = fileHandles.begin(); i != fileHandles.end(); ++i) {
-		free((i->second)->data);
 		delete i->second;
 	}
 }
 
 int CArchiveBuffered::OpenFile(const std::string& fileName)
 {
-	ABOpenFile_t* fh = GetEntireFile(fileName);
-	if (!fh)
-		return 0;
+	const std::string lcName = StringToLower(fileName);
+	ABOpenFile_t* fh;
+
+	CArchiveFileCache::Buffer cached;
+	int size;
+	if (!cacheKey.empty() && archiveFileCache.Find(cacheKey, lcName, cached, size)) {
+		fh = new ABOpenFile_t;
+		fh->size = size;
+		fh->pos = 0;
+		fh->buffer = cached;
+		fh->data = cached.get();
+	}
+	else {
+		fh = GetEntireFile(fileName);
+		if (!fh)
+			return 0;
+		fh->buffer.reset(fh->data, free);
+		if (!cacheKey.empty())
+			archiveFileCache.Insert(cacheKey, lcName, fh->buffer, fh->size);
+	}
 
 	curFileHandle++;
 	fileHandles[curFileHandle] = fh;
@@ -57,7 +81,6 @@ void CArchiveBuffered::CloseFile(int handle)
 {
 	ABOpenFile_t* of = GetOpenFile(handle);
 
-	free(of->data);
 	delete of;
 	fileHandles.erase(handle);
 }
@@ -87,3 +110,60 @@ int CArchiveBuffered::FileSize(int handle)
 	ABOpenFile_t* of = GetOpenFile(handle);
 	return of->size;
 }
+
+void CArchiveBuffered::Prefetch(const std::vector<std::string>& fileNames, int numThreads)
+{
+	// without a cache there is nowhere to put the files
+	if (cacheKey.empty())
+		return;
+
+	std::set<std::string> seen;
+	std::vector<std::string> todo;
+	for (std::vector<std::string>::const_iterator it = fileNames.begin(); it != fileNames.end(); ++it) {
+		const std::string lcName = StringToLower(*it);
+		if (seen.insert(lcName).second && WillPrefetch(lcName))
+			todo.push_back(lcName);
+	}
+	if (!todo.empty())
+		PrefetchFiles(todo, std::max(numThreads, 1));
+}
+
+bool CArchiveBuffered::WillPrefetch(const std::string& fileName)
+{
+	if (cacheKey.empty() || !CanPrefetch(fileName))
+		return false;
+	CArchiveFileCache::Buffer cached;
+	int size;
+	return !archiveFileCache.Find(cacheKey, fileName, cached, size);
+}
+
+void CArchiveBuffered::PrefetchFiles(const std::vector<std::string>& fileNames, int numThreads)
+{
+	for (std::vector<std::string>::const_iterator it = fileNames.begin(); it != fileNames.end(); ++it) {
+		ABOpenFile_t* of = GetEntireFile(*it);
+		if (of) {
+			CacheFile(*it, of->data, of->size);
+			delete of;
+		}
+	}
+}
+
+void CArchiveBuffered::RunPrefetchWorkers(int numThreads)
+{
+	nextPrefetchJob = 0;
+	RunWorkers(std::min(numThreads, (int)numPrefetchJobs), boost::bind(&CArchiveBuffered::PrefetchWorker, this));
+}
+
+bool CArchiveBuffered::NextPrefetchJob(unsigned& job)
+{
+	boost::mutex::scoped_lock lock(prefetchMutex);
+	if (nextPrefetchJob >= numPrefetchJobs)
+		return false;
+	job = nextPrefetchJob++;
+	return true;
+}
+
+void CArchiveBuffered::CacheFile(const std::string& fileName, char* data, int size)
+{
+	archiveFileCache.Insert(cacheKey, fileName, CArchiveFileCache::Buffer(data, free), size);
+}
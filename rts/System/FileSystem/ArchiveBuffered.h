@@ -3,23 +3,54 @@
 
 #include "ArchiveBase.h"
 #include <map>
+#include <vector>
+#include <boost/shared_array.hpp>
+#include <boost/thread/mutex.hpp>
 
 struct ABOpenFile_t {
 	int size;
 	int pos;
+	/// malloc'ed by GetEntireFile, owned by buffer after OpenFile
 	char* data;
+	/// shared with archiveFileCache and other handles of the same file
+	boost::shared_array<char> buffer;
 };
 
 // Provides a helper implementation for archive types that can only uncompress one file to
-// memory at a time
+// memory at a time. Uncompressed files are kept in archiveFileCache.
 class CArchiveBuffered :
 	public CArchiveBase
 {
 protected:
 	int curFileHandle;
+	/// CArchiveFileCache::GetArchiveKey of this archive
+	std::string cacheKey;
 	std::map<int, ABOpenFile_t*> fileHandles;
 	virtual ABOpenFile_t* GetEntireFile(const std::string& fileName) = 0;
 	ABOpenFile_t* GetOpenFile(int handle);
+
+	/**
+	@brief Decompress files into archiveFileCache
+	fileNames are lower case, exist and are not cached yet. The default
+	decompresses them one after the other with GetEntireFile, archive types
+	which can decompress several files at once set up numPrefetchJobs and
+	call RunPrefetchWorkers.
+	*/
+	virtual void PrefetchFiles(const std::vector<std::string>& fileNames, int numThreads);
+	/// @return false for files PrefetchFiles skips, fileName is lower case
+	virtual bool CanPrefetch(const std::string& fileName) { return true; }
+	/// Runs PrefetchWorker on numThreads threads, this one included
+	void RunPrefetchWorkers(int numThreads);
+	/// Takes jobs from NextPrefetchJob until there are none left
+	virtual void PrefetchWorker() {}
+	/// @return false if all numPrefetchJobs are taken
+	bool NextPrefetchJob(unsigned& job);
+	/// Hand a malloc'ed file to archiveFileCache, thread safe
+	void CacheFile(const std::string& fileName, char* data, int size);
+
+	unsigned numPrefetchJobs;
+	unsigned nextPrefetchJob;
+	boost::mutex prefetchMutex;
 public:
 	CArchiveBuffered(const std::string& name);
 	virtual ~CArchiveBuffered(void);
@@ -30,6 +61,19 @@ public:
 	virtual int Peek(int handle);
 	virtual bool Eof(int handle);
 	virtual int FileSize(int handle);
+
+	/**
+	@brief Decompress files into archiveFileCache before they are opened
+	Missing and already cached files are skipped. Archive types which
+	support it decompress on numThreads threads, each with its own decoder.
+	*/
+	void Prefetch(const std::vector<std::string>& fileNames, int numThreads);
+	/**
+	@brief Prefetch would decompress this file
+	@return false if there is no cache, the file is cached already or the
+	archive type does not prefetch it. fileName is lower case.
+	*/
+	bool WillPrefetch(const std::string& fileName);
 };
 
 #endif
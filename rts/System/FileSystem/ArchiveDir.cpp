@@ -2,6 +2,7 @@
 
 #include "StdAfx.h"
 #include "ArchiveDir.h"
+#include "FileMapping.h"
 #include <assert.h>
 #include <stdexcept>
 #include "FileSystem/FileSystem.h"
@@ -66,10 +67,17 @@ bool CArchiveDir::IsOpen()
 
 int CArchiveDir::OpenFile(const std::string& fileName)
 {
-	CFileHandler* f = new CFileHandler(archiveName + lcNameToOrigName[StringToLower(fileName)]);
+	// an unknown name would open the archive directory itself
+	std::map<std::string, std::string>::const_iterator it = lcNameToOrigName.find(StringToLower(fileName));
+	if (it == lcNameToOrigName.end())
+		return 0;
+
+	CFileHandler* f = new CFileHandler(archiveName + it->second);
 
-	if (!f || !f->FileExists())
+	if (!f || !f->FileExists()) {
+		delete f;
 		return 0;
+	}
 
 	++curFileHandle;
 	fileHandles[curFileHandle] = f;
@@ -132,3 +140,12 @@ int CArchiveDir::FindFiles(int cur, std::string* name, int* size)
 	++searchHandles[cur];
 	return cur;
 }
+
+
+CFileMapping* CArchiveDir::MapFile(const std::string& fileName)
+{
+	std::map<std::string, std::string>::const_iterator it = lcNameToOrigName.find(StringToLower(fileName));
+	if (it == lcNameToOrigName.end())
+		return NULL;
+	return CFileMapping::Map(archiveName + it->second);
+}
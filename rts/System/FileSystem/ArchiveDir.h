@@ -38,6 +38,7 @@ public:
 	virtual bool Eof(int handle);
 	virtual int FileSize(int handle);
 	virtual int FindFiles(int cur, std::string* name, int* size);
+	virtual CFileMapping* MapFile(const std::string& fileName);
 };
 
 #endif
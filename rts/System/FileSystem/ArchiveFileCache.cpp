@@ -0,0 +1,111 @@
+#include "StdAfx.h"
+#include "ArchiveFileCache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sstream>
+#include "mmgr.h"
+
+
+CArchiveFileCache archiveFileCache;
+
+
+CArchiveFileCache::CArchiveFileCache()
+: budget(64 * 1024 * 1024)
+, size(0)
+{
+}
+
+
+void CArchiveFileCache::SetBudget(unsigned bytes)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	budget = bytes;
+	Shrink();
+}
+
+
+unsigned CArchiveFileCache::GetBudget()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return budget;
+}
+
+
+unsigned CArchiveFileCache::GetSize()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return size;
+}
+
+
+void CArchiveFileCache::Clear()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	entries.clear();
+	lru.clear();
+	size = 0;
+}
+
+
+std::string CArchiveFileCache::GetArchiveKey(const std::string& archiveName)
+{
+	struct stat info;
+	if (stat(archiveName.c_str(), &info) != 0)
+		return "";
+
+	std::ostringstream key;
+	key << archiveName << '\n' << info.st_mtime << '\n' << info.st_size << '\n';
+	return key.str();
+}
+
+
+bool CArchiveFileCache::Find(const std::string& archiveKey, const std::string& fileName, Buffer& data, int& fileSize)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	std::map<std::string, Entry>::iterator it = entries.find(archiveKey + fileName);
+	if (it == entries.end())
+		return false;
+
+	lru.splice(lru.begin(), lru, it->second.use);
+	data = it->second.data;
+	fileSize = it->second.size;
+	return true;
+}
+
+
+void CArchiveFileCache::Insert(const std::string& archiveKey, const std::string& fileName, const Buffer& data, int fileSize)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	if (fileSize < 0 || (unsigned)fileSize > budget / 4)
+		return;
+
+	const std::string key = archiveKey + fileName;
+	std::map<std::string, Entry>::iterator it = entries.find(key);
+	if (it != entries.end()) {
+		// another archive object of the same archive was faster
+		lru.splice(lru.begin(), lru, it->second.use);
+		return;
+	}
+
+	lru.push_front(key);
+	Entry& e = entries[key];
+	e.data = data;
+	e.size = fileSize;
+	e.use = lru.begin();
+	size += fileSize;
+	Shrink();
+}
+
+
+void CArchiveFileCache::Shrink()
+{
+	while (size > budget && !lru.empty()) {
+		std::map<std::string, Entry>::iterator it = entries.find(lru.back());
+		size -= it->second.size;
+		entries.erase(it);
+		lru.pop_back();
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef ARCHIVEFILECACHE_H
+#define ARCHIVEFILECACHE_H
+
+#include <map>
+#include <list>
+#include <string>
+#include <boost/shared_array.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+/**
+@brief Decompressed archive files, shared by all archives of the process
+CArchiveBuffered looks files up here before decompressing them, so opening
+the same archive again (archive scanner, VFS, unitsync after a reinit) does
+not inflate the same files again. Files are keyed by path, modification
+time and size of their archive plus their name in it. The least recently
+used files are dropped when the cache grows above its budget. Thread safe.
+*/
+class CArchiveFileCache : boost::noncopyable
+{
+public:
+	typedef boost::shared_array<char> Buffer;
+
+	CArchiveFileCache();
+
+	/// Bytes all cached files may use together, 0 disables the cache
+	void SetBudget(unsigned bytes);
+	unsigned GetBudget();
+	/// Bytes used by the cached files
+	unsigned GetSize();
+	void Clear();
+
+	/**
+	@brief Identifies the current contents of an archive
+	@return empty if the archive does not exist, don't cache anything then
+	*/
+	static std::string GetArchiveKey(const std::string& archiveName);
+
+	/// @return false if the file is not cached
+	bool Find(const std::string& archiveKey, const std::string& fileName, Buffer& data, int& size);
+	/// Files bigger than a quarter of the budget are not cached
+	void Insert(const std::string& archiveKey, const std::string& fileName, const Buffer& data, int size);
+
+private:
+	struct Entry
+	{
+		Buffer data;
+		int size;
+		/// position in lru
+		std::list<std::string>::iterator use;
+	};
+
+	/// drop least recently used files until size fits the budget
+	void Shrink();
+
+	boost::mutex mutex;
+	std::map<std::string, Entry> entries;
+	/// keys of entries, most recently used first
+	std::list<std::string> lru;
+	unsigned budget;
+	unsigned size;
+};
+
+extern CArchiveFileCache archiveFileCache;
+
+#endif
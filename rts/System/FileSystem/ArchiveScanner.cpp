@@ -1,10 +1,11 @@
 #include "StdAfx.h"
 
-#include <list>
 #include <algorithm>
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <boost/bind.hpp>
 
 #include "mmgr.h"
 
@@ -14,12 +15,14 @@
 #include "LogOutput.h"
 #include "ArchiveFactory.h"
 #include "ArchiveBuffered.h"
+#include "CacheFile.h"
 #include "CRC.h"
 #include "FileFilter.h"
 #include "FileHandler.h"
 #include "FileSystem/FileSystem.h"
 #include "Util.h"
 #include "Exceptions.h"
+#include "WorkerThreads.h"
 
 using std::string;
 using std::vector;
@@ -41,7 +44,9 @@ CLogSubsystem LOG_ARCHIVESCANNER("ArchiveScanner");
  * is not slow, but mapping them all every time to make the list is)
  */
 
-#define INTERNAL_VER	7
+#define INTERNAL_VER	9
+
+#define CACHE_MAGIC		"spring archives"
 
 
 CArchiveScanner* archiveScanner = NULL;
@@ -64,7 +69,7 @@ CArchiveScanner::~CArchiveScanner(void)
 string CArchiveScanner::GetFilename()
 {
 	char buf[32];
-	sprintf(buf, "ArchiveCacheV%i.lua", INTERNAL_VER);
+	sprintf(buf, "ArchiveCacheV%i.bin", INTERNAL_VER);
 	return string(buf);
 }
 
@@ -115,7 +120,7 @@ CArchiveScanner::ModData CArchiveScanner::GetModData(const LuaTable& modTable)
 	// (at time of this writing they use name only)
 
 	// NOTE when changing this, this function is used both by the code that
-	// reads ArchiveCacheV#.lua and the code that reads modinfo.lua from the mod.
+	// reads ArchiveCacheV#.bin and the code that reads modinfo.lua from the mod.
 	// so make sure it doesn't keep adding stuff to the name everytime
 	// Spring/unitsync is loaded.
 
@@ -190,6 +195,23 @@ static bool LoadSourceFile(const string& archive,
 
 
 void CArchiveScanner::ScanDirs(const vector<string>& scanDirs, bool doChecksum)
+{
+	this->scanDirs = scanDirs;
+
+	// add the archives
+	for (unsigned int d = 0; d < scanDirs.size(); d++) {
+		logOutput.Print("Scanning: %s\n", scanDirs[d].c_str());
+		Scan(scanDirs[d], doChecksum);
+	}
+}
+
+
+/*
+ * Loads the Lua helpers for parsing modinfo.tdf from springcontent.sdz.
+ * Only done when a modinfo.tdf has to be parsed, with a valid cache
+ * startup doesn't need to search for and open springcontent.sdz.
+ */
+void CArchiveScanner::LoadScanUtils()
 {
 	// pre-scan for the modinfo utils
 	for (unsigned int d = 0; d < scanDirs.size(); d++) {
@@ -210,21 +232,14 @@ void CArchiveScanner::ScanDirs(const vector<string>& scanDirs, bool doChecksum)
 	parse_tdf_code.erase(parse_tdf_code.find_last_of("}") + 1);
 	// NOTE: this is a dangerous game to play,
 	//       better to use a tag in the source file
-
-	// add the archives
-	for (unsigned int d = 0; d < scanDirs.size(); d++) {
-		logOutput.Print("Scanning: %s\n", scanDirs[d].c_str());
-		Scan(scanDirs[d], doChecksum);
-	}
 }
 
 
 void CArchiveScanner::Scan(const string& curPath, bool doChecksum)
 {
-	isDirty = true;
-
 	const int flags = (FileSystem::INCLUDE_DIRS | FileSystem::RECURSE);
 	vector<string> found = filesystem.FindFiles(curPath, "*", flags);
+	vector<ScanJob> jobs;
 
 	for (vector<string>::iterator it = found.begin(); it != found.end(); ++it) {
 		string fullName = *it;
@@ -253,10 +268,20 @@ void CArchiveScanner::Scan(const string& curPath, bool doChecksum)
 
 		// Is this an archive we should look into?
 		if (CArchiveFactory::IsScanArchive(fullName)) {
-			ScanArchive(fullName, doChecksum);
+			ScanJob job;
+			if (PrepareScanJob(fullName, doChecksum, job)) {
+				jobs.push_back(job);
+			}
 		}
 	}
 
+	// Open and checksum the new / changed archives in parallel, then merge
+	// the results in the order the archives were found
+	RunScanJobs(jobs, doChecksum);
+	for (vector<ScanJob>::const_iterator job = jobs.begin(); job != jobs.end(); ++job) {
+		FinishScanJob(*job, doChecksum);
+	}
+
 	// Now we'll have to parse the replaces-stuff found in the mods
 	for (std::map<string, ArchiveInfo>::iterator aii = archiveInfo.begin(); aii != archiveInfo.end(); ++aii) {
 		for (vector<string>::iterator i = aii->second.modData.replaces.begin(); i != aii->second.modData.replaces.end(); ++i) {
@@ -270,11 +295,16 @@ void CArchiveScanner::Scan(const string& curPath, bool doChecksum)
 				archiveInfo[lcname] = tmp;
 				ar = archiveInfo.find(lcname);
 			}
+			if (ar->second.replaced != aii->first) {
+				isDirty = true;
+			}
 
 			// Overwrite the info for this archive with a replaced pointer
 			ar->second.path = "";
 			ar->second.origName = lcname;
 			ar->second.modified = 1;
+			ar->second.size = 0;
+			ar->second.checksum = 0;
 			ar->second.mapData.clear();
 			ar->second.modData.name = "";
 			ar->second.modData.replaces.clear();
@@ -285,7 +315,11 @@ void CArchiveScanner::Scan(const string& curPath, bool doChecksum)
 }
 
 
-void CArchiveScanner::ScanArchive(const string& fullName, bool doChecksum)
+/*
+ * Decides from the cache whether the archive has to be looked into.
+ * Returns false if the cached info can be used as is.
+ */
+bool CArchiveScanner::PrepareScanJob(const string& fullName, bool doChecksum, ScanJob& job)
 {
 	struct stat info;
 
@@ -296,6 +330,14 @@ void CArchiveScanner::ScanArchive(const string& fullName, bool doChecksum)
 	const string lcfn    = StringToLower(fn);
 	const string lcfpath = StringToLower(fpath);
 
+	job.fullName = fullName;
+	job.lcfn = lcfn;
+	job.modified = info.st_mtime;
+	job.size = info.st_size;
+	job.checksumOnly = false;
+	job.opened = false;
+	job.checksum = 0;
+
 	// Determine whether to rely on the cached info or not
 	bool cached = false;
 
@@ -304,7 +346,7 @@ void CArchiveScanner::ScanArchive(const string& fullName, bool doChecksum)
 
 		// This archive may have been obsoleted, do not process it if so
 		if (aii->second.replaced.length() > 0) {
-			return;
+			return false;
 		}
 
 		/*
@@ -313,7 +355,7 @@ void CArchiveScanner::ScanArchive(const string& fullName, bool doChecksum)
 			in all .sdd's always need to be stat()'ed, which really slows
 			down program startup.
 
-			An update can be forced anyway by removing ArchiveCacheV*.lua
+			An update can be forced anyway by removing ArchiveCacheV*.bin
 			or renaming the archive.
 		*/
 
@@ -328,7 +370,7 @@ void CArchiveScanner::ScanArchive(const string& fullName, bool doChecksum)
 			}
 		}*/
 
-		if ((unsigned)info.st_mtime == aii->second.modified && fpath == aii->second.path) {
+		if ((unsigned)info.st_mtime == aii->second.modified && (unsigned)info.st_size == aii->second.size && fpath == aii->second.path) {
 			cached = true;
 			aii->second.updated = true;
 		}
@@ -341,61 +383,165 @@ void CArchiveScanner::ScanArchive(const string& fullName, bool doChecksum)
 		}
 	}
 
-	// Time to parse the info we are interested in
 	if (cached) {
 		// If cached is true, aii will point to the archive
-		if (doChecksum && (aii->second.checksum == 0)) {
-			aii->second.checksum = GetCRC(fullName);
+		job.checksumOnly = true;
+		return (doChecksum && (aii->second.checksum == 0));
+	}
+	return true;
+}
+
+
+void CArchiveScanner::RunScanJobs(vector<ScanJob>& jobs, bool doChecksum)
+{
+	if (jobs.empty()) {
+		return;
+	}
+
+	nextScanJob = 0;
+	scanJobsDone = 0;
+
+	// the current thread also reports the progress
+	RunWorkers(std::min(GetWorkerThreadCount(), (int)jobs.size()),
+		boost::bind(&CArchiveScanner::ScanWorker, this, &jobs, doChecksum, false),
+		boost::bind(&CArchiveScanner::ScanWorker, this, &jobs, doChecksum, true));
+}
+
+
+void CArchiveScanner::ScanWorker(vector<ScanJob>* jobs, bool doChecksum, bool reportProgress)
+{
+	const unsigned int numJobs = jobs->size();
+	unsigned int reported = 0;
+
+	while (true) {
+		unsigned int j;
+		unsigned int done;
+		{
+			boost::mutex::scoped_lock lock(scanMutex);
+			done = scanJobsDone;
+			if (nextScanJob >= numJobs) {
+				break;
+			}
+			j = nextScanJob++;
+		}
+
+		// logOutput is not thread safe, only thread zero prints
+		if (reportProgress && (numJobs >= 20) && (done * 10 / numJobs > reported)) {
+			reported = done * 10 / numJobs;
+			logOutput.Print("Scanned %u of %u archives\n", done, numJobs);
 		}
+
+		try {
+			ScanArchive((*jobs)[j], doChecksum);
+		} catch (const std::exception& e) {
+			// rethrowing on a worker would terminate, report it when merging
+			(*jobs)[j].opened = false;
+			(*jobs)[j].error = e.what();
+		}
+
+		boost::mutex::scoped_lock lock(scanMutex);
+		++scanJobsDone;
 	}
-	else {
-		CArchiveBase* ar = CArchiveFactory::OpenArchive(fullName);
-		if (ar) {
-			ArchiveInfo ai;
-
-			string name;
-			int size;
-			for (int cur = 0; (cur = ar->FindFiles(cur, &name, &size)); /* no-op */) {
-				const string lowerName = StringToLower(name);
-				const string ext = lowerName.substr(lowerName.find_last_of('.') + 1);
-
-				// only accept new format maps
-				if ((ext == "smf") || (ext == "sm3")) {
-					ScanMap(ar, name, ai);
-				}
-				else if (lowerName == "modinfo.lua") {
-					ScanModLua(ar, name, ai);
-				}
-				else if (lowerName == "modinfo.tdf") {
-					ScanModTdf(ar, name, ai);
+}
+
+
+/*
+ * Runs on a worker thread: opens the archive, lists its maps, reads its
+ * modinfo and calculates the checksum. Must not touch archiveInfo.
+ */
+void CArchiveScanner::ScanArchive(ScanJob& job, bool doChecksum)
+{
+	if (job.checksumOnly) {
+		job.checksum = GetCRC(job.fullName);
+		return;
+	}
+
+	CArchiveBase* ar = CArchiveFactory::OpenArchive(job.fullName);
+	if (!ar) {
+		return;
+	}
+	job.opened = true;
+
+	string name;
+	int size;
+	for (int cur = 0; (cur = ar->FindFiles(cur, &name, &size)); /* no-op */) {
+		const string lowerName = StringToLower(name);
+		const string ext = lowerName.substr(lowerName.find_last_of('.') + 1);
+
+		// only accept new format maps
+		if ((ext == "smf") || (ext == "sm3")) {
+			ScanMap(name, job.mapData);
+		}
+		else if ((lowerName == "modinfo.lua") || (lowerName == "modinfo.tdf")) {
+			// parsed by FinishScanJob, Lua states can't be used from other threads
+			const int fh = ar->OpenFile(name);
+			if (fh != 0) {
+				const int fsize = std::max(ar->FileSize(fh), 0);
+				string source(fsize, '\0');
+				if (fsize > 0) {
+					ar->ReadFile(fh, &source[0], fsize);
 				}
+				ar->CloseFile(fh);
+				job.modInfo.push_back(std::make_pair(name, source));
 			}
+		}
+	}
+
+	// Optionally calculate a checksum for the file
+	// To prevent reading all files in all directory (.sdd) archives
+	// every time this function is called, directory archive checksums
+	// are calculated on the fly.
+	if (doChecksum) {
+		job.checksum = GetCRC(ar);
+	}
+
+	delete ar;
+}
 
-			ai.path = fpath;
-			ai.modified = info.st_mtime;
-			ai.origName = fn;
-			ai.updated = true;
-
-			delete ar;
-
-			// Optionally calculate a checksum for the file
-			// To prevent reading all files in all directory (.sdd) archives
-			// every time this function is called, directory archive checksums
-			// are calculated on the fly.
-			if (doChecksum) {
-				ai.checksum = GetCRC(fullName);
-			} else {
-				ai.checksum = 0;
-			}
 
-			archiveInfo[lcfn] = ai;
+void CArchiveScanner::FinishScanJob(const ScanJob& job, bool doChecksum)
+{
+	if (!job.error.empty()) {
+		logOutput.Print("Error scanning %s: %s\n", job.fullName.c_str(), job.error.c_str());
+		return;
+	}
+	if (job.checksumOnly) {
+		std::map<string, ArchiveInfo>::iterator aii = archiveInfo.find(job.lcfn);
+		if (aii != archiveInfo.end()) {
+			aii->second.checksum = job.checksum;
+			isDirty = true;
 		}
+		return;
 	}
+	if (!job.opened) {
+		return;
+	}
+
+	ArchiveInfo ai;
+	ai.mapData = job.mapData;
+
+	for (unsigned int i = 0; i < job.modInfo.size(); ++i) {
+		const string& name = job.modInfo[i].first;
+		if (StringToLower(name) == "modinfo.lua") {
+			ScanModLua(name, job.modInfo[i].second, ai);
+		} else {
+			ScanModTdf(name, job.modInfo[i].second, ai);
+		}
+	}
+
+	ai.path = filesystem.GetDirectory(job.fullName);
+	ai.modified = job.modified;
+	ai.size = job.size;
+	ai.origName = filesystem.GetFilename(job.fullName);
+	ai.updated = true;
+	ai.checksum = doChecksum ? job.checksum : 0;
+
+	archiveInfo[job.lcfn] = ai;
+	isDirty = true;
 }
 
 
-bool CArchiveScanner::ScanMap(CArchiveBase* ar, const string& fileName,
-                              ArchiveInfo& ai)
+bool CArchiveScanner::ScanMap(const string& fileName, vector<MapData>& mapData)
 {
 	MapData md;
 	if ((fileName.find_last_of('\\') == string::npos) &&
@@ -415,27 +561,15 @@ bool CArchiveScanner::ScanMap(CArchiveBase* ar, const string& fileName,
 			md.virtualPath = fileName.substr(0, fileName.find_last_of('\\') + 1);
 		}
 	}
-	ai.mapData.push_back(md);
+	mapData.push_back(md);
 	return true;
 }
 
 
-bool CArchiveScanner::ScanModLua(CArchiveBase* ar, const string& fileName,
+bool CArchiveScanner::ScanModLua(const string& fileName, const string& source,
                                  ArchiveInfo& ai)
 {
-	const int fh = ar->OpenFile(fileName);
-	if (fh == 0) {
-		return false;
-	}
-	const int fsize = ar->FileSize(fh);
-
-	char* buf = new char[fsize];
-	ar->ReadFile(fh, buf, fsize);
-	ar->CloseFile(fh);
-
-	const string cleanbuf(buf, fsize);
-	delete [] buf;
-	LuaParser p(cleanbuf, SPRING_VFS_MOD);
+	LuaParser p(source, SPRING_VFS_MOD);
 	if (!p.Execute()) {
 		logOutput.Print("ERROR in " + fileName + ": " + p.GetErrorLog());
 		return false;
@@ -447,25 +581,18 @@ bool CArchiveScanner::ScanModLua(CArchiveBase* ar, const string& fileName,
 }
 
 
-bool CArchiveScanner::ScanModTdf(CArchiveBase* ar, const string& fileName,
+bool CArchiveScanner::ScanModTdf(const string& fileName, const string& source,
                                  ArchiveInfo& ai)
 {
-	const int fh = ar->OpenFile(fileName);
-	if (fh == 0) {
-		return false;
+	if (parse_tdf_code.empty()) {
+		LoadScanUtils();
 	}
-	const int fsize = ar->FileSize(fh);
 
-	char* buf = new char[fsize];
-	ar->ReadFile(fh, buf, fsize);
-	ar->CloseFile(fh);
-	const string cleanbuf(buf, fsize);
-	delete [] buf;
 	const string luaCode =
 			parse_tdf_code + "\n\n"
 		+ scanutils_code + "\n\n"
 		+ "local tdfModinfo, err = TDFparser.ParseText([[\n"
-		+ cleanbuf + "]])\n\n"
+		+ source + "]])\n\n"
 		+ "if (tdfModinfo == nil) then\n"
 		+ "    error('Error parsing modinfo.tdf: ' .. err)\n"
 		+ "end\n\n"
@@ -509,16 +636,24 @@ IFileFilter* CArchiveScanner::CreateIgnoreFilter(CArchiveBase* ar)
     Returns 0 if file could not be opened. */
 unsigned int CArchiveScanner::GetCRC(const string& arcName)
 {
-	CRC crc;
-	CArchiveBase* ar;
-	std::list<string> files;
-
 	// Try to open an archive
-	ar = CArchiveFactory::OpenArchive(arcName);
+	CArchiveBase* ar = CArchiveFactory::OpenArchive(arcName);
 	if (!ar) {
 		return 0; // It wasn't an archive
 	}
 
+	const unsigned int digest = GetCRC(ar);
+	delete ar;
+	return digest;
+}
+
+
+/** Get CRC of the data in an opened archive. */
+unsigned int CArchiveScanner::GetCRC(CArchiveBase* ar)
+{
+	CRC crc;
+	vector<string> files;
+
 	// Load ignore list.
 	IFileFilter* ignore = CreateIgnoreFilter(ar);
 
@@ -532,10 +667,10 @@ unsigned int CArchiveScanner::GetCRC(const string& arcName)
 		const string lower = StringToLower(name); // case insensitive hash
 		files.push_back(lower);
 	}
-	files.sort();
+	std::sort(files.begin(), files.end());
 
 	// Add all files in sorted order
-	for (std::list<string>::iterator i = files.begin(); i != files.end(); i++ ) {
+	for (vector<string>::iterator i = files.begin(); i != files.end(); i++ ) {
 		const unsigned int nameCRC = CRC().Update(i->data(), i->size()).GetDigest();
 		const unsigned int dataCRC = ar->GetCrc32(*i);
 		crc.Update(nameCRC);
@@ -543,7 +678,6 @@ unsigned int CArchiveScanner::GetCRC(const string& arcName)
 	}
 
 	delete ignore;
-	delete ar;
 
 	unsigned int digest = crc.GetDigest();
 
@@ -557,177 +691,168 @@ unsigned int CArchiveScanner::GetCRC(const string& arcName)
 }
 
 
+/*
+ * The cache is a CCacheBlob of ints and strings (int length + chars, no
+ * terminator):
+ *
+ *   char magic[16]       CACHE_MAGIC
+ *   int version          INTERNAL_VER
+ *   int numArchives
+ *   numArchives times:
+ *     int recordSize     bytes of the rest of the record
+ *     string origName, path, replaced
+ *     int modified, size, checksum
+ *     int numMaps, numMaps times: string name, virtualPath
+ *     int hasModData, if set:
+ *       string name, shortName, version, mutator, game, shortGame, description
+ *       int modType
+ *       int numDependencies, strings
+ *       int numReplaces, strings
+ *
+ * It is read in one go and parsed straight from the buffer; no Lua involved.
+ */
 void CArchiveScanner::ReadCacheData(const string& filename)
 {
-  LuaParser p(filename, SPRING_VFS_RAW, SPRING_VFS_BASE);
+	CCacheBlob r;
+	if (!r.ReadFile(filename)) {
+		return;
+	}
 
-	if (!p.Execute()) {
-		logOutput.Print("ERROR in " + filename + ": " + p.GetErrorLog());
+	char magic[sizeof(CACHE_MAGIC)];
+	if (!r.Read(magic, sizeof(magic)) || (memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0)) {
+		return;
 	}
-	const LuaTable archiveCache = p.GetRoot();
-	const LuaTable archives = archiveCache.SubTable("archives");
 
 	// Do not load old version caches
-	const int ver = archiveCache.GetInt("internalVer", (INTERNAL_VER + 1));
-	if (ver != INTERNAL_VER) {
+	unsigned int version = 0;
+	if (!r.Get(version) || (version != INTERNAL_VER)) {
 		return;
 	}
 
-	for (int i = 1; archives.KeyExists(i); ++i) {
-	  const LuaTable curArchive = archives.SubTable(i);
-		const LuaTable maps = curArchive.SubTable("maps");
-		const LuaTable mod = curArchive.SubTable("modData");
-		ArchiveInfo ai;
-
-		ai.origName = curArchive.GetString("name", "");
-		ai.path     = curArchive.GetString("path", "");
+	std::map<string, ArchiveInfo> cached;
+	unsigned int numArchives = 0;
+	r.Get(numArchives);
+	for (unsigned int a = 0; !r.Failed() && (a < numArchives); ++a) {
+		unsigned int recordSize = 0;
+		r.Get(recordSize);
+		const unsigned int recordStart = r.GetPos();
 
-		// do not use LuaTable.GetInt() for 32-bit integers, the Spring lua
-		// library uses 32-bit floats to represent numbers, which can only
-		// represent 2^24 consecutive integers
-		ai.modified = strtoul(curArchive.GetString("modified", "0").c_str(), 0, 10);
-		ai.checksum = strtoul(curArchive.GetString("checksum", "0").c_str(), 0, 10);
+		ArchiveInfo ai;
+		r.GetString(ai.origName);
+		r.GetString(ai.path);
+		r.GetString(ai.replaced);
+		r.Get(ai.modified);
+		r.Get(ai.size);
+		r.Get(ai.checksum);
 		ai.updated = false;
 
-		for (int m = 1; maps.KeyExists(m); ++m) {
-			const LuaTable curMap = maps.SubTable(m);
-
+		unsigned int numMaps = 0;
+		r.Get(numMaps);
+		for (unsigned int m = 0; !r.Failed() && (m < numMaps); ++m) {
 			MapData md;
-			md.name = curMap.GetString("name", "");
-			md.virtualPath = curMap.GetString("virtualPath", "");
-
+			r.GetString(md.name);
+			r.GetString(md.virtualPath);
 			ai.mapData.push_back(md);
 		}
 
-		ai.modData = GetModData(mod);
-
-		string lcname = StringToLower(ai.origName);
+		ModData& md = ai.modData;
+		md.modType = 0;
+		unsigned int hasModData = 0;
+		r.Get(hasModData);
+		if (hasModData) {
+			r.GetString(md.name);
+			r.GetString(md.shortName);
+			r.GetString(md.version);
+			r.GetString(md.mutator);
+			r.GetString(md.game);
+			r.GetString(md.shortGame);
+			r.GetString(md.description);
+			r.Get(md.modType);
+			r.GetStrings(md.dependencies);
+			r.GetStrings(md.replaces);
+		}
 
-		archiveInfo[lcname] = ai;
+		if (r.Failed() || (r.GetPos() - recordStart != recordSize)) {
+			break;
+		}
+		cached[StringToLower(ai.origName)] = ai;
 	}
 
-	isDirty = false;
-}
-
-
-static inline void SafeStr(FILE* out, const char* prefix, const string& str)
-{
-	if (str.empty()) {
+	if (!r.AtEnd() || (cached.size() != numArchives)) {
+		logOutput.Print("Ignoring damaged archive cache " + filename);
 		return;
 	}
-	if (str.find_first_of("\\\"") == string::npos) {
-		fprintf(out, "%s\"%s\",\n", prefix, str.c_str());
-	} else {
-		fprintf(out, "%s[[%s]],\n", prefix, str.c_str());
-	}
+
+	archiveInfo.swap(cached);
+	isDirty = false;
 }
 
 
 void CArchiveScanner::WriteCacheData(const string& filename)
 {
-	if (!isDirty) {
-		return;
-	}
-
-	FILE* out = fopen(filename.c_str(), "wt");
-	if (!out) {
-		return;
-	}
-
 	// First delete all outdated information
 	for (std::map<string, ArchiveInfo>::iterator i = archiveInfo.begin(); i != archiveInfo.end(); ) {
 		std::map<string, ArchiveInfo>::iterator next = i;
 		next++;
 		if (!i->second.updated) {
 			archiveInfo.erase(i);
+			isDirty = true;
 		}
 		i = next;
 	}
 
-	fprintf(out, "local archiveCache = {\n\n");
-	fprintf(out, "\tinternalver = %i,\n\n", INTERNAL_VER);
-	fprintf(out, "\tarchives = {  -- count = %lu\n", archiveInfo.size());
+	if (!isDirty) {
+		return;
+	}
+
+	CCacheBlob w;
+	w.Write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	w.Put((unsigned int)INTERNAL_VER);
+	w.Put((unsigned int)archiveInfo.size());
 
 	std::map<string, ArchiveInfo>::const_iterator arcIt;
 	for (arcIt = archiveInfo.begin(); arcIt != archiveInfo.end(); ++arcIt) {
 		const ArchiveInfo& arcInfo = arcIt->second;
 
-		fprintf(out, "\t\t{\n");
-		SafeStr(out, "\t\t\tname = ",              arcInfo.origName);
-		SafeStr(out, "\t\t\tpath = ",              arcInfo.path);
-		fprintf(out, "\t\t\tmodified = \"%u\",\n", arcInfo.modified);
-		fprintf(out, "\t\t\tchecksum = \"%u\",\n", arcInfo.checksum);
-		SafeStr(out, "\t\t\treplaced = ",          arcInfo.replaced);
-
-		// map info?
-		const vector<MapData>& mapData = arcInfo.mapData;
-		if (!mapData.empty()) {
-			fprintf(out, "\t\t\tmaps = {\n");
-			vector<MapData>::const_iterator mapIt;
-			for (mapIt = mapData.begin(); mapIt != mapData.end(); ++mapIt) {
-				fprintf(out, "\t\t\t\t{\n");
-				SafeStr(out, "\t\t\t\t\tname = ",        mapIt->name);
-				SafeStr(out, "\t\t\t\t\tvirtualpath = ", mapIt->virtualPath);
-				fprintf(out, "\t\t\t\t},\n");
-			}
-			fprintf(out, "\t\t\t},\n");
+		const unsigned int sizePos = w.GetSize();
+		w.Put((unsigned int)0);
+
+		w.PutString(arcInfo.origName);
+		w.PutString(arcInfo.path);
+		w.PutString(arcInfo.replaced);
+		w.Put(arcInfo.modified);
+		w.Put(arcInfo.size);
+		w.Put(arcInfo.checksum);
+
+		w.Put((unsigned int)arcInfo.mapData.size());
+		vector<MapData>::const_iterator mapIt;
+		for (mapIt = arcInfo.mapData.begin(); mapIt != arcInfo.mapData.end(); ++mapIt) {
+			w.PutString(mapIt->name);
+			w.PutString(mapIt->virtualPath);
 		}
 
-		// mod info?
 		const ModData& modData = arcInfo.modData;
-		if (modData.name != "") {
-			fprintf(out, "\t\t\tmoddata = {\n");
-			SafeStr(out, "\t\t\t\tname = ",         modData.name);
-			SafeStr(out, "\t\t\t\tshortname = ",    modData.shortName);
-			SafeStr(out, "\t\t\t\tversion = ",      modData.version);
-			SafeStr(out, "\t\t\t\tmutator = ",      modData.mutator);
-			SafeStr(out, "\t\t\t\tgame = ",         modData.game);
-			SafeStr(out, "\t\t\t\tshortgame = ",    modData.shortGame);
-			SafeStr(out, "\t\t\t\tdescription = ",  modData.description);
-			fprintf(out, "\t\t\t\tmodtype = %d,\n", modData.modType);
-
-			const vector<string>& modDeps = modData.dependencies;
-			const int depCount = (int)modDeps.size();
-			bool foundCustomDep = false;
-			for (int d = 0; d < depCount; d++) {
-				if (modDeps[d] != "springcontent.sdz") {
-					foundCustomDep = true;
-					break;
-				}
-			}
-			if (foundCustomDep) {
-				fprintf(out, "\t\t\t\tdepend = {\n");
-				for (int d = 0; d < depCount; d++) {
-					if ((d != (depCount - 1)) || (modDeps[d] != "springcontent.sdz")) {
-						SafeStr(out, "\t\t\t\t\t", modDeps[d]);
-					}
-				}
-				fprintf(out, "\t\t\t\t},\n");
-			}
-
-			const vector<string>& modReps = modData.replaces;
-			const int repCount = (int)modReps.size();
-			if (repCount > 0)  {
-				fprintf(out, "\t\t\t\treplace = {\n");
-				for (int r = 0; r < repCount; r++) {
-					SafeStr(out, "\t\t\t\t\t", modReps[r]);
-				}
-				fprintf(out, "\t\t\t\t},\n");
-			}
-
-			fprintf(out, "\t\t\t},\n");
+		w.Put((unsigned int)(modData.name.empty() ? 0 : 1));
+		if (!modData.name.empty()) {
+			w.PutString(modData.name);
+			w.PutString(modData.shortName);
+			w.PutString(modData.version);
+			w.PutString(modData.mutator);
+			w.PutString(modData.game);
+			w.PutString(modData.shortGame);
+			w.PutString(modData.description);
+			w.Put(modData.modType);
+			w.PutStrings(modData.dependencies);
+			w.PutStrings(modData.replaces);
 		}
 
-		fprintf(out, "\t\t},\n");
+		w.PutAt(sizePos, (unsigned int)(w.GetSize() - sizePos - sizeof(unsigned int)));
 	}
 
-	fprintf(out, "\t},\n"); // close 'archives'
-	fprintf(out, "}\n\n"); // close 'archiveCache'
-	fprintf(out, "return archiveCache\n");
-
-	fclose(out);
-
-	isDirty = false;
+	// Spring and unitsync running at the same time never see a half written cache
+	if (w.WriteFile(filename)) {
+		isDirty = false;
+	}
 }
 
 
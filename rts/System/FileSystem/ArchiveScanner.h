@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <boost/thread/mutex.hpp>
 
 class CArchiveBase;
 class IFileFilter;
@@ -14,7 +15,8 @@ class LuaTable;
  * This class searches through a given directory and its subdirectories looking for archive files.
  * When it finds one, it figures out what kind of archive it is (i.e. if it is a map or a mod currently).
  * This information is cached, so that only modified archives are actually opened. The information can
- * then be retreived by the mod and map selectors.
+ * then be retreived by the mod and map selectors. The cache is a binary file (see WriteCacheData), it is
+ * only rewritten if an archive was added, changed or removed.
  *
  * The archive namespace is global, so it is not allowed to have an archive with the same name in more
  * than one folder.
@@ -72,6 +74,7 @@ protected:
 		std::string path;
 		std::string origName;					// Could be useful to have the non-lowercased name around
 		unsigned int modified;
+		unsigned int size;
 		std::vector<MapData> mapData;
 		ModData modData;
 		unsigned int checksum;
@@ -79,24 +82,55 @@ protected:
 		std::string replaced;					// If not empty, use that archive instead
 	};
 
+	/*
+	 * One archive to be opened (and/or checksummed) by a worker thread.
+	 * Everything touching archiveInfo or Lua happens on the calling thread,
+	 * workers only fill in the fields below the line.
+	 */
+	struct ScanJob {
+		std::string fullName;
+		std::string lcfn;
+		unsigned int modified;
+		unsigned int size;
+		bool checksumOnly;						// Archive is cached, only its checksum is missing
+
+		bool opened;
+		std::vector<MapData> mapData;
+		std::vector<std::pair<std::string, std::string> > modInfo;	// name and contents of modinfo.lua / modinfo.tdf
+		unsigned int checksum;
+		std::string error;						// Set if opening the archive threw
+	};
+
 protected:
 	void PreScan(const std::string& curPath);
+	void LoadScanUtils();
 	void Scan(const std::string& curPath, bool checksum = false);
-	void ScanArchive(const std::string& fullName, bool checksum = false);
-	bool ScanMap(CArchiveBase* ar, const std::string& fileName, ArchiveInfo& ai);
-	bool ScanModLua(CArchiveBase* ar, const std::string& fileName, ArchiveInfo& ai);
-	bool ScanModTdf(CArchiveBase* ar, const std::string& fileName, ArchiveInfo& ai);
+	bool PrepareScanJob(const std::string& fullName, bool checksum, ScanJob& job);
+	void RunScanJobs(std::vector<ScanJob>& jobs, bool checksum);
+	void ScanWorker(std::vector<ScanJob>* jobs, bool checksum, bool reportProgress);
+	void ScanArchive(ScanJob& job, bool checksum);
+	void FinishScanJob(const ScanJob& job, bool checksum);
+	bool ScanMap(const std::string& fileName, std::vector<MapData>& mapData);
+	bool ScanModLua(const std::string& fileName, const std::string& source, ArchiveInfo& ai);
+	bool ScanModTdf(const std::string& fileName, const std::string& source, ArchiveInfo& ai);
 
 protected:
 	std::map<std::string, ArchiveInfo> archiveInfo;
 	ModData GetModData(const LuaTable& modTable);
 	IFileFilter* CreateIgnoreFilter(CArchiveBase* ar);
 	unsigned int GetCRC(const std::string& filename);
+	unsigned int GetCRC(CArchiveBase* ar);
 	bool isDirty;
+	std::vector<std::string> scanDirs;
 	std::string parse_tdf_path;
 	std::string parse_tdf_code;
 	std::string scanutils_path;
 	std::string scanutils_code;
+
+	/// Hands out the ScanJobs to the worker threads
+	boost::mutex scanMutex;
+	unsigned int nextScanJob;
+	unsigned int scanJobsDone;
 };
 
 extern CArchiveScanner* archiveScanner;
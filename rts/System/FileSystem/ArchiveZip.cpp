@@ -1,5 +1,8 @@
 #include "StdAfx.h"
 #include "ArchiveZip.h"
+#include "FileMapping.h"
+#include "CRC.h"
+#include "LogOutput.h"
 #include <algorithm>
 #include <stdexcept>
 #include "Util.h"
@@ -8,7 +11,9 @@
 
 CArchiveZip::CArchiveZip(const std::string& name):
 	CArchiveBuffered(name),
-	curSearchHandle(1)
+	archiveName(name),
+	curSearchHandle(1),
+	prefetchNames(NULL)
 {
 #ifdef USEWIN32IOAPI
 	zlib_filefunc_def ffunc;
@@ -41,6 +46,8 @@ CArchiveZip::CArchiveZip(const std::string& name):
 		fd.size = info.uncompressed_size;
 		fd.origName = fname;
 		fd.crc = info.crc;
+		fd.stored = (info.compression_method == 0) && !(info.flag & 1);
+		fd.crcChecked = false;
 		fileData[name] = fd;
 	}
 }
@@ -110,6 +117,90 @@ ABOpenFile_t* CArchiveZip::GetEntireFile(const std::string& fName)
 	return of;
 }
 
+void CArchiveZip::PrefetchFiles(const std::vector<std::string>& fileNames, int numThreads)
+{
+	if (!zip)
+		return;
+
+	prefetchNames = &fileNames;
+	numPrefetchJobs = fileNames.size();
+	RunPrefetchWorkers(numThreads);
+	prefetchNames = NULL;
+}
+
+bool CArchiveZip::CanPrefetch(const std::string& fileName)
+{
+	std::map<std::string, FileData>::const_iterator it = fileData.find(fileName);
+	return (it != fileData.end()) && !it->second.stored;
+}
+
+// Only reads fileData, which does not change once the archive is open
+void CArchiveZip::PrefetchWorker()
+{
+#ifdef USEWIN32IOAPI
+	zlib_filefunc_def ffunc;
+	fill_win32_filefunc(&ffunc);
+	unzFile z = unzOpen2(archiveName.c_str(), &ffunc);
+#else
+	unzFile z = unzOpen(archiveName.c_str());
+#endif
+	if (!z)
+		return;
+
+	unsigned job;
+	while (NextPrefetchJob(job)) {
+		const std::string& name = (*prefetchNames)[job];
+		std::map<std::string, FileData>::const_iterator it = fileData.find(name);
+		if (it == fileData.end() || it->second.stored)
+			continue; // stored files are mapped, not read (see MapFile)
+
+		unz_file_pos fp = it->second.fp;
+		if (unzGoToFilePos(z, &fp) != UNZ_OK || unzOpenCurrentFile(z) != UNZ_OK)
+			continue;
+		const int size = it->second.size;
+		char* data = (char*)malloc(size);
+		const bool ok = data && (unzReadCurrentFile(z, data, size) == size);
+		if (unzCloseCurrentFile(z) == UNZ_OK && ok)
+			CacheFile(name, data, size);
+		else
+			free(data);
+	}
+	unzClose(z);
+}
+
+// Stored entries are mapped straight out of the zip file, the zip stays
+// usable for other files in the meantime. unzip checks the CRC of the files
+// it reads, so the first mapping of each entry is checked here.
+CFileMapping* CArchiveZip::MapFile(const std::string& fName)
+{
+	if (!zip)
+		return NULL;
+
+	std::map<std::string, FileData>::iterator it = fileData.find(StringToLower(fName));
+	if (it == fileData.end() || !it->second.stored || it->second.size <= 0)
+		return NULL;
+
+	if (unzGoToFilePos(zip, &it->second.fp) != UNZ_OK || unzOpenCurrentFile(zip) != UNZ_OK)
+		return NULL;
+	const unsigned offset = unzGetCurrentFileZStreamPos(zip);
+	unzCloseCurrentFile(zip);
+	if (offset == 0)
+		return NULL;
+
+	CFileMapping* mapping = CFileMapping::Map(archiveName, offset, it->second.size);
+	if (mapping && !it->second.crcChecked) {
+		if (CRC().Update(mapping->GetData(), mapping->GetSize()).GetDigest() != it->second.crc) {
+			// read it through unzip from now on, which reports the error
+			logOutput.Print("CRC error in %s: %s\n", archiveName.c_str(), it->second.origName.c_str());
+			it->second.stored = false;
+			delete mapping;
+			return NULL;
+		}
+		it->second.crcChecked = true;
+	}
+	return mapping;
+}
+
 int CArchiveZip::FindFiles(int cur, std::string* name, int* size)
 {
 	if (cur == 0) {
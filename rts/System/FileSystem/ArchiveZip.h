@@ -20,12 +20,23 @@ protected:
 		int size;
 		std::string origName;
 		unsigned int crc;
+		/// stored uncompressed and unencrypted, so it can be mapped
+		bool stored;
+		/// the mapped data matched crc once, no need to check it again
+		bool crcChecked;
 	};
+	std::string archiveName;
 	unzFile zip;
 	std::map<std::string, FileData> fileData;		// using unzLocateFile is quite slow
 	int curSearchHandle;
 	std::map<int, std::map<std::string, FileData>::iterator> searchHandles;
 	virtual ABOpenFile_t* GetEntireFile(const std::string& fileName);
+	/// one job per file, every worker opens the zip on its own
+	virtual void PrefetchFiles(const std::vector<std::string>& fileNames, int numThreads);
+	virtual void PrefetchWorker();
+	/// stored files are mapped, not cached
+	virtual bool CanPrefetch(const std::string& fileName);
+	const std::vector<std::string>* prefetchNames;
 	void SetSlashesForwardToBack(std::string& name);
 	void SetSlashesBackToForward(std::string& name);
 public:
@@ -34,6 +45,7 @@ public:
 	virtual bool IsOpen();
 	virtual int FindFiles(int cur, std::string* name, int* size);
 	virtual unsigned int GetCrc32 (const std::string& fileName);
+	virtual CFileMapping* MapFile(const std::string& fileName);
 };
 
 #endif
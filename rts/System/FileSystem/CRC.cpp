@@ -1,44 +1,285 @@
 #include "CRC.h"
 
-extern "C" {
-#include "lib/7zip/7zCrc.h"
+#include <string.h>
+
+// define CRC_NO_SIMD to always use slicing-by-8
+#if !defined(CRC_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+	#if defined(_MSC_VER) && (_MSC_VER >= 1500)
+		#define CRC_PCLMUL
+		#define CRC_TARGET_PCLMUL
+		#include <intrin.h>
+		#include <emmintrin.h>
+		#include <smmintrin.h>
+		#include <wmmintrin.h>
+	#elif defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+		// compiled for the instruction set of the target attribute, only
+		// called after checking the CPU supports it
+		#define CRC_PCLMUL
+		#define CRC_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+		#include <cpuid.h>
+		#include <emmintrin.h>
+		#include <smmintrin.h>
+		#include <wmmintrin.h>
+	#endif
+#endif
+
+
+/// reversed IEEE 802.3 polynomial, as used by 7zip and zlib
+static const unsigned int crcPoly = 0xEDB88320;
+
+/// PCLMUL is only worth it from this many bytes on
+static const unsigned int pclmulMinSize = 64;
+
+
+namespace {
+
+/** @brief Multiply a and b modulo the CRC polynomial (bit reflected). */
+unsigned int MultModP(unsigned int a, unsigned int b)
+{
+	unsigned int m = 1u << 31;
+	unsigned int p = 0;
+	while (m != 0) {
+		if (a & m) {
+			p ^= b;
+		}
+		m >>= 1;
+		b = (b & 1) ? ((b >> 1) ^ crcPoly) : (b >> 1);
+	}
+	return p;
+}
+
+
+/**
+ * @brief Lookup tables for slicing-by-8
+ * table[0] is the classic byte-wise table, table[k][i] is the CRC of byte i
+ * followed by k zero bytes. Built before main(), so no locking is needed.
+ */
+struct CRCTables
+{
+	CRCTables();
+
+	unsigned int table[8][256];
+	/// x^(2^n) mod P, for Combine()
+	unsigned int x2n[32];
+	bool littleEndian;
+	bool pclmul;
 };
 
+CRCTables::CRCTables()
+{
+	for (unsigned int i = 0; i < 256; ++i) {
+		unsigned int r = i;
+		for (int j = 0; j < 8; ++j) {
+			r = (r & 1) ? ((r >> 1) ^ crcPoly) : (r >> 1);
+		}
+		table[0][i] = r;
+	}
+	for (unsigned int i = 0; i < 256; ++i) {
+		for (int k = 1; k < 8; ++k) {
+			table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+		}
+	}
 
-static bool crcTableInitialized;
+	unsigned int p = 1u << 30; // x^1
+	x2n[0] = p;
+	for (int n = 1; n < 32; ++n) {
+		x2n[n] = p = MultModP(p, p);
+	}
+
+	const unsigned int one = 1;
+	littleEndian = (*(const unsigned char*)&one == 1);
+
+	pclmul = false;
+#if defined(CRC_PCLMUL) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	pclmul = ((info[2] & (1 << 1)) != 0) && ((info[2] & (1 << 19)) != 0);
+#elif defined(CRC_PCLMUL)
+	unsigned int eax, ebx, ecx, edx;
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		pclmul = ((ecx & bit_PCLMUL) != 0) && ((ecx & bit_SSE4_1) != 0);
+	}
+#endif
+}
+
+CRCTables tables;
+
+
+/** @brief x^(8*n) mod P, the operator for appending n zero bytes. */
+unsigned int X8nModP(unsigned int n)
+{
+	unsigned int p = 1u << 31; // x^0
+	for (int k = 3; n != 0; n >>= 1, ++k) {
+		if (n & 1) {
+			p = MultModP(tables.x2n[k & 31], p);
+		}
+	}
+	return p;
+}
+
+unsigned int UpdateBytes(unsigned int crc, const unsigned char* p, unsigned int size)
+{
+	for (; size > 0; --size, ++p) {
+		crc = tables.table[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+unsigned int UpdateSlicing8(unsigned int crc, const unsigned char* p, unsigned int size)
+{
+	if (!tables.littleEndian) {
+		return UpdateBytes(crc, p, size);
+	}
+
+	const unsigned int (&t)[8][256] = tables.table;
+	for (; size >= 8; size -= 8, p += 8) {
+		unsigned int lo, hi;
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc = t[7][ lo        & 0xFF] ^ t[6][(lo >>  8) & 0xFF] ^
+		      t[5][(lo >> 16) & 0xFF] ^ t[4][ lo >> 24        ] ^
+		      t[3][ hi        & 0xFF] ^ t[2][(hi >>  8) & 0xFF] ^
+		      t[1][(hi >> 16) & 0xFF] ^ t[0][ hi >> 24        ];
+	}
+	return UpdateBytes(crc, p, size);
+}
+
+#ifdef CRC_PCLMUL
+/**
+ * @brief Fold 64 bytes at a time with carry-less multiplication
+ * From Gopal et al., "Fast CRC Computation for Generic Polynomials Using
+ * PCLMULQDQ Instruction" (Intel, 2009), with the bit reflected constants
+ * for the IEEE polynomial. size must be a multiple of 16, at least 64.
+ */
+CRC_TARGET_PCLMUL unsigned int UpdatePCLMUL(unsigned int crc, const unsigned char* p, unsigned int size)
+{
+	const __m128i k1k2 = _mm_set_epi32(0x00000001, 0xC6E41596, 0x00000001, 0x54442BD4);
+	const __m128i k3k4 = _mm_set_epi32(0x00000000, 0xCCAA009E, 0x00000001, 0x751997D0);
+	const __m128i k5k0 = _mm_set_epi32(0x00000000, 0x00000000, 0x00000001, 0x63CD6124);
+	const __m128i poly = _mm_set_epi32(0x00000001, 0xF7011641, 0x00000001, 0xDB710641);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	p += 64;
+	size -= 64;
+
+	// four 128 bit lanes in parallel
+	x0 = k1k2;
+	for (; size >= 64; size -= 64, p += 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+	}
+
+	// fold the lanes into one
+	x0 = k3k4;
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	for (; size >= 16; size -= 16, p += 16) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)p)), x5);
+	}
+
+	// 128 -> 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask32);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x2 = _mm_and_si128(x1, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (unsigned int)_mm_extract_epi32(x1, 1);
+}
+#endif
+
+}
 
 
 /** @brief Construct a new CRC object. */
 CRC::CRC()
 {
-	if (!crcTableInitialized) {
-		crcTableInitialized = true;
-		InitCrcTable();
-	}
-	CrcInit(&crc);
+	crc = 0xFFFFFFFF;
 }
 
 
 /** @brief Get the final CRC digest. */
 unsigned int CRC::GetDigest() const
 {
-	// make a temporary copy to get away with the const
-	unsigned int temp = crc;
-	return CrcGetDigest(&temp);
+	return crc ^ 0xFFFFFFFF;
 }
 
 
 /** @brief Update CRC over the data. */
 CRC& CRC::Update(const void* data, unsigned int size)
 {
-	CrcUpdate(&crc, data, size);
+	const unsigned char* p = (const unsigned char*)data;
+#ifdef CRC_PCLMUL
+	if (tables.pclmul && (size >= pclmulMinSize)) {
+		const unsigned int chunk = size & ~15u;
+		crc = UpdatePCLMUL(crc, p, chunk);
+		p += chunk;
+		size -= chunk;
+	}
+#endif
+	crc = UpdateSlicing8(crc, p, size);
 	return *this;
 }
 
 
-/** @brief Update CRC over the 4 bytes of data. */
+/** @brief Update CRC over the 4 bytes of data (little endian, like 7zip). */
 CRC& CRC::Update(unsigned int data)
 {
-	CrcUpdateUInt32(&crc, data);
+	for (int i = 0; i < 4; ++i) {
+		crc = tables.table[0][(crc ^ (data >> (8 * i))) & 0xFF] ^ (crc >> 8);
+	}
 	return *this;
 }
+
+
+unsigned int CRC::Combine(unsigned int digestA, unsigned int digestB, unsigned int lengthB)
+{
+	return MultModP(X8nModP(lengthB), digestA) ^ digestB;
+}
+
+
+const char* CRC::GetImplementation()
+{
+#ifdef CRC_PCLMUL
+	if (tables.pclmul) {
+		return "PCLMULQDQ";
+	}
+#endif
+	return "slicing-by-8";
+}
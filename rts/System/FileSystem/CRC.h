@@ -3,7 +3,12 @@
 
 #include <string>
 
-/** @brief Object representing an updateable CRC-32 checksum. */
+/**
+ * @brief Object representing an updateable CRC-32 checksum.
+ *
+ * Same polynomial and digests as the 7zip CRC (and zlib's crc32), computed
+ * with PCLMULQDQ folding on CPUs supporting it and slicing-by-8 otherwise.
+ */
 class CRC
 {
 public:
@@ -14,6 +19,17 @@ public:
 	CRC& Update(const void* data, unsigned int size);
 	CRC& Update(unsigned int data);
 
+	/**
+	 * @brief Digest of the concatenation A+B from the digests of A and B
+	 * @param lengthB size of B in bytes
+	 *
+	 * Allows to checksum large data in parallel chunks.
+	 */
+	static unsigned int Combine(unsigned int digestA, unsigned int digestB, unsigned int lengthB);
+
+	/** @brief Name of the code path used by Update(), for logging / benchmarks. */
+	static const char* GetImplementation();
+
 private:
 	unsigned int crc;
 };
@@ -0,0 +1,177 @@
+#include "StdAfx.h"
+#include "CacheFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include <boost/thread/mutex.hpp>
+#include "mmgr.h"
+
+#include "CRC.h"
+
+
+bool CCacheBlob::Read(void* buf, unsigned int size)
+{
+	if (failed || size > data.size() - pos) {
+		failed = true;
+		return false;
+	}
+	memcpy(buf, data.data() + pos, size);
+	pos += size;
+	return true;
+}
+
+
+void CCacheBlob::PutString(const std::string& s)
+{
+	Put((unsigned int)s.size());
+	Write(s.data(), s.size());
+}
+
+
+bool CCacheBlob::GetString(std::string& s)
+{
+	unsigned int size = 0;
+	Get(size);
+	if (failed || size > data.size() - pos) {
+		failed = true;
+		return false;
+	}
+	s.assign(data, pos, size);
+	pos += size;
+	return true;
+}
+
+
+void CCacheBlob::PutStrings(const std::vector<std::string>& v)
+{
+	Put((unsigned int)v.size());
+	for (std::vector<std::string>::const_iterator it = v.begin(); it != v.end(); ++it) {
+		PutString(*it);
+	}
+}
+
+
+bool CCacheBlob::GetStrings(std::vector<std::string>& v)
+{
+	unsigned int size = 0;
+	Get(size);
+	for (unsigned int i = 0; !failed && (i < size); ++i) {
+		std::string s;
+		if (GetString(s)) {
+			v.push_back(s);
+		}
+	}
+	return !failed;
+}
+
+
+bool CCacheBlob::ReadFile(const std::string& path)
+{
+	data.clear();
+	pos = 0;
+	failed = false;
+
+	FILE* in = fopen(path.c_str(), "rb");
+	if (!in) {
+		return false;
+	}
+	if (fseek(in, 0, SEEK_END) == 0) {
+		const long size = ftell(in);
+		if (size > 0) {
+			data.resize(size);
+			fseek(in, 0, SEEK_SET);
+			if (fread(&data[0], 1, size, in) != (size_t)size) {
+				failed = true;
+			}
+		}
+	} else {
+		failed = true;
+	}
+	fclose(in);
+
+	if (failed) {
+		data.clear();
+	}
+	return !failed;
+}
+
+
+bool CCacheBlob::WriteFile(const std::string& path) const
+{
+	return ReplaceFile(path, data);
+}
+
+
+static boost::mutex tempCounterMutex;
+static unsigned int tempCounter = 0;
+
+/// path + ".<pid>.<n>.tmp", unique between processes and threads
+static std::string GetTempPath(const std::string& path)
+{
+	unsigned int n;
+	{
+		boost::mutex::scoped_lock lock(tempCounterMutex);
+		n = tempCounter++;
+	}
+	char buf[32];
+#ifdef _WIN32
+	sprintf(buf, ".%d.%u.tmp", _getpid(), n);
+#else
+	sprintf(buf, ".%d.%u.tmp", (int)getpid(), n);
+#endif
+	return path + buf;
+}
+
+
+bool ReplaceFile(const std::string& path, const std::string& data)
+{
+	const std::string tmpPath = GetTempPath(path);
+	FILE* out = fopen(tmpPath.c_str(), "wb");
+	if (!out) {
+		return false;
+	}
+	const bool written = (fwrite(data.data(), 1, data.size(), out) == data.size());
+	if ((fclose(out) != 0) || !written) {
+		remove(tmpPath.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	remove(path.c_str()); // rename does not replace on windows
+#endif
+	if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+		remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+bool SaveCacheFile(const std::string& path, const std::string& key, const std::string& payload)
+{
+	CCacheBlob file;
+	file.PutString(key);
+	file.Put(CRC().Update(payload.data(), payload.size()).GetDigest());
+	file.Write(payload.data(), payload.size());
+	return file.WriteFile(path);
+}
+
+
+bool LoadCacheFile(const std::string& path, const std::string& key, std::string& payload)
+{
+	CCacheBlob file;
+	if (!file.ReadFile(path)) {
+		return false;
+	}
+	std::string fileKey;
+	unsigned int crc;
+	if (!file.GetString(fileKey) || (fileKey != key) || !file.Get(crc)) {
+		return false;
+	}
+	payload.assign(file.GetData(), file.GetPos(), std::string::npos);
+	return (CRC().Update(payload.data(), payload.size()).GetDigest() == crc);
+}
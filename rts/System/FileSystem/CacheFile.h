@@ -0,0 +1,95 @@
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+
+#include <string>
+#include <vector>
+
+/**
+@brief Binary buffer the files in cache/ are written to and read from
+Cache files are only ever read back on the machine which wrote them, so
+values are stored raw. Reading past the end sets a flag instead of
+throwing, check Failed() or AtEnd() once everything is read.
+*/
+class CCacheBlob
+{
+public:
+	CCacheBlob() : pos(0), failed(false) {}
+
+	void Write(const void* buf, unsigned int size) { data.append((const char*)buf, size); }
+	bool Read(void* buf, unsigned int size);
+
+	template<typename T> void Put(const T& value) { Write(&value, sizeof(T)); }
+	template<typename T> bool Get(T& value) { return Read(&value, sizeof(T)); }
+	/// overwrite a value written before at offset pos (see GetSize)
+	template<typename T> void PutAt(unsigned int pos, const T& value)
+	{
+		data.replace(pos, sizeof(T), (const char*)&value, sizeof(T));
+	}
+
+	void PutString(const std::string& s);
+	bool GetString(std::string& s);
+
+	void PutStrings(const std::vector<std::string>& v);
+	bool GetStrings(std::vector<std::string>& v);
+
+	/// only for vectors of plain structs
+	template<typename T> void PutVector(const std::vector<T>& v)
+	{
+		Put((unsigned int)v.size());
+		if (!v.empty())
+			Write(&v[0], v.size() * sizeof(T));
+	}
+	template<typename T> bool GetVector(std::vector<T>& v)
+	{
+		unsigned int size = 0;
+		Get(size);
+		if (failed || size > (data.size() - pos) / sizeof(T)) {
+			failed = true;
+			return false;
+		}
+		v.resize(size);
+		return (size == 0) || Read(&v[0], size * sizeof(T));
+	}
+
+	bool Failed() const { return failed; }
+	/// everything was read and nothing failed
+	bool AtEnd() const { return !failed && pos == data.size(); }
+	/// bytes written so far
+	unsigned int GetSize() const { return data.size(); }
+	/// bytes read so far
+	unsigned int GetPos() const { return pos; }
+	/// to fill the blob before reading from it
+	std::string& GetData() { return data; }
+	const std::string& GetData() const { return data; }
+
+	/// Replace the contents with the file's, false if it can not be read
+	bool ReadFile(const std::string& path);
+	/// ReplaceFile(path, GetData())
+	bool WriteFile(const std::string& path) const;
+
+private:
+	std::string data;
+	unsigned int pos;
+	bool failed;
+};
+
+
+/**
+@brief Write a file through a temporary one
+The file is replaced in one step, so other processes (spring and unitsync
+at the same time) and crashes never leave a half written file behind.
+@return false if the file could not be written, it is unchanged then
+*/
+bool ReplaceFile(const std::string& path, const std::string& data);
+
+/**
+@brief Store payload in a cache file for key
+File layout: key length, key, payload CRC, payload. Cache files are usually
+named after a hash of their key, so the full key in the file tells hash
+collisions apart.
+*/
+bool SaveCacheFile(const std::string& path, const std::string& key, const std::string& payload);
+/// @return false if the file is missing, damaged or belongs to another key
+bool LoadCacheFile(const std::string& path, const std::string& key, std::string& payload);
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "FileHandler.h"
 #include "VFSHandler.h"
+#include "FileMapping.h"
 #include "FileSystem/FileSystem.h"
 
 #include "Util.h"
@@ -20,7 +21,7 @@ using namespace std;
 /******************************************************************************/
 
 CFileHandler::CFileHandler(const char* filename, const char* modes)
-: ifs(NULL), hpiFileBuffer(NULL), hpiOffset(0), filesize(-1)
+: ifs(NULL), hpiFileBuffer(NULL), hpiMapping(NULL), hpiData(NULL), hpiOffset(0), filesize(-1)
 {
 	GML_RECMUTEX_LOCK(file);
 
@@ -29,7 +30,7 @@ CFileHandler::CFileHandler(const char* filename, const char* modes)
 
 
 CFileHandler::CFileHandler(const string& filename, const string& modes)
-: ifs(NULL), hpiFileBuffer(NULL), hpiOffset(0), filesize(-1)
+: ifs(NULL), hpiFileBuffer(NULL), hpiMapping(NULL), hpiData(NULL), hpiOffset(0), filesize(-1)
 {
 	GML_RECMUTEX_LOCK(file);
 
@@ -47,6 +48,7 @@ CFileHandler::~CFileHandler(void)
 	if (hpiFileBuffer) {
 		delete[] hpiFileBuffer;
 	}
+	delete hpiMapping;
 }
 
 
@@ -76,6 +78,14 @@ bool CFileHandler::TryModFS(const string& filename)
 
 	const string file = StringToLower(filename);
 
+	// files stored uncompressed are read straight from the archive
+	hpiMapping = vfsHandler->MapFile(file);
+	if (hpiMapping) {
+		hpiData = hpiMapping->GetData();
+		hpiLength = filesize = hpiMapping->GetSize();
+		return true;
+	}
+
 	hpiLength = vfsHandler->GetFileSize(file);
 	if (hpiLength != -1) {
 		hpiFileBuffer = new unsigned char[hpiLength];
@@ -84,6 +94,7 @@ bool CFileHandler::TryModFS(const string& filename)
 			hpiFileBuffer = NULL;
 		}
 		else {
+			hpiData = hpiFileBuffer;
 			filesize = hpiLength;
 			return true;
 		}
@@ -121,7 +132,7 @@ void CFileHandler::Init(const string& filename, const string& modes)
 
 bool CFileHandler::FileExists() const
 {
-	return (ifs || hpiFileBuffer);
+	return (ifs || hpiData);
 }
 
 
@@ -133,12 +144,12 @@ int CFileHandler::Read(void* buf,int length)
 		ifs->read((char*)buf, length);
 		return ifs->gcount ();
 	}
-	else if (hpiFileBuffer) {
+	else if (hpiData) {
 		if ((length + hpiOffset) > hpiLength) {
 			length = hpiLength - hpiOffset;
 		}
 		if (length > 0) {
-			memcpy(buf, &hpiFileBuffer[hpiOffset], length);
+			memcpy(buf, &hpiData[hpiOffset], length);
 			hpiOffset += length;
 		}
 		return length;
@@ -153,8 +164,10 @@ void CFileHandler::Seek(int length)
 	GML_RECMUTEX_LOCK(file);
 
 	if (ifs) {
+		// seeking back from the end of the file must reset eof
+		ifs->clear();
 		ifs->seekg(length);
-	} else if (hpiFileBuffer){
+	} else if (hpiData){
 		hpiOffset = length;
 	}
 }
@@ -167,9 +180,9 @@ int CFileHandler::Peek() const
 	if (ifs) {
 		return ifs->peek();
 	}
-	else if (hpiFileBuffer){
+	else if (hpiData){
 		if (hpiOffset < hpiLength) {
-			return hpiFileBuffer[hpiOffset];
+			return hpiData[hpiOffset];
 		} else {
 			return EOF;
 		}
@@ -185,7 +198,7 @@ bool CFileHandler::Eof() const
 	if (ifs) {
 		return ifs->eof();
 	}
-	if (hpiFileBuffer) {
+	if (hpiData) {
 		return (hpiOffset >= hpiLength);
 	}
 	return true;
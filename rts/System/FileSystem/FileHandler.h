@@ -7,6 +7,7 @@
 
 #include "VFSModes.h"
 
+class CFileMapping;
 
 class CFileHandler {
 	public:
@@ -27,6 +28,14 @@ class CFileHandler {
 		
 		bool LoadStringData(std::string& data);
 
+		/**
+		@brief Contents of a file from the VFS, without copying them
+		Points into a memory mapping if the file is stored uncompressed in its
+		archive, else into the buffer it was decompressed into. NULL for raw
+		files, Read() those. Valid as long as this CFileHandler exists.
+		*/
+		const unsigned char* GetData() const { return hpiData; }
+
 	public:
 		static bool InReadDir(const std::string& path);
 		static bool InWriteDir(const std::string& path);
@@ -84,6 +93,9 @@ class CFileHandler {
 	private:
 		std::ifstream* ifs;
 		unsigned char* hpiFileBuffer;
+		CFileMapping* hpiMapping;
+		/// hpiFileBuffer or the data of hpiMapping
+		const unsigned char* hpiData;
 		int hpiLength;
 		int hpiOffset;
 		int filesize;
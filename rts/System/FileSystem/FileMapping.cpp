@@ -0,0 +1,89 @@
+#include "StdAfx.h"
+#include "FileMapping.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "mmgr.h"
+
+
+CFileMapping* CFileMapping::Map(const std::string& file, unsigned offset, unsigned length)
+{
+	if (length == 0)
+		return NULL;
+
+#ifdef _WIN32
+	HANDLE fh = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return NULL;
+	DWORD sizeHigh = 0;
+	const DWORD fileSize = GetFileSize(fh, &sizeHigh);
+	if (sizeHigh != 0 || fileSize < offset || fileSize - offset < length) {
+		CloseHandle(fh);
+		return NULL;
+	}
+	HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(fh); // the mapping object keeps the file open
+	if (mh == NULL)
+		return NULL;
+
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const unsigned start = offset - (offset % si.dwAllocationGranularity);
+	void* view = MapViewOfFile(mh, FILE_MAP_READ, 0, start, (offset - start) + length);
+	CloseHandle(mh); // and the view keeps the mapping object
+	if (view == NULL)
+		return NULL;
+#else
+	const int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)offset || st.st_size - (off_t)offset < (off_t)length) {
+		close(fd);
+		return NULL;
+	}
+	const unsigned pageSize = sysconf(_SC_PAGESIZE);
+	const unsigned start = offset - (offset % pageSize);
+	void* view = mmap(NULL, (offset - start) + length, PROT_READ, MAP_PRIVATE, fd, start);
+	close(fd); // the mapping stays valid
+	if (view == MAP_FAILED)
+		return NULL;
+#endif
+
+	return new CFileMapping(view, (offset - start) + length, (const unsigned char*)view + (offset - start), length);
+}
+
+
+CFileMapping* CFileMapping::Map(const std::string& file)
+{
+	struct stat st;
+	if (stat(file.c_str(), &st) != 0)
+		return NULL;
+	return Map(file, 0, st.st_size);
+}
+
+
+CFileMapping::CFileMapping(void* view, unsigned viewSize, const unsigned char* data, unsigned size)
+: view(view)
+, viewSize(viewSize)
+, data(data)
+, size(size)
+{
+}
+
+
+CFileMapping::~CFileMapping()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(view);
+#else
+	munmap(view, viewSize);
+#endif
+}
@@ -0,0 +1,40 @@
+#ifndef FILEMAPPING_H
+#define FILEMAPPING_H
+
+#include <string>
+#include <boost/noncopyable.hpp>
+
+/**
+@brief Read-only memory mapping of a part of a file
+Used to read files which are stored uncompressed (plain files in directory
+archives, stored entries of zip archives) without copying them into memory.
+The mapping stays valid until the object is deleted, even if the archive it
+came from is closed in between.
+*/
+class CFileMapping : boost::noncopyable
+{
+public:
+	/**
+	@brief Map length bytes of file starting at offset
+	@return NULL if the file cannot be opened / mapped or is too short
+	*/
+	static CFileMapping* Map(const std::string& file, unsigned offset, unsigned length);
+	/// Map the whole file, NULL for empty files
+	static CFileMapping* Map(const std::string& file);
+	~CFileMapping();
+
+	const unsigned char* GetData() const { return data; }
+	unsigned GetSize() const { return size; }
+
+private:
+	CFileMapping(void* view, unsigned viewSize, const unsigned char* data, unsigned size);
+
+	/// page aligned start of the mapping, data lies somewhere in it
+	void* view;
+	unsigned viewSize;
+
+	const unsigned char* data;
+	unsigned size;
+};
+
+#endif
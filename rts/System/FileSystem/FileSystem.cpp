@@ -34,6 +34,7 @@
 
 #include "FileSystem/ArchiveScanner.h"
 #include "FileSystem/VFSHandler.h"
+#include "FileSystem/ArchiveFileCache.h"
 #include "ConfigHandler.h"
 #include "LogOutput.h"
 #include "Util.h"
@@ -349,6 +350,9 @@ void FileSystemHandler::InitVFS() const
 	const DataDir* writedir = locater.GetWriteDir();
 	const std::vector<DataDir>& datadirs = locater.GetDataDirs();
 
+	// megabytes of decompressed archive files kept around for reuse
+	archiveFileCache.SetBudget(configHandler.Get("ArchiveFileCacheSize", 64) * 1024 * 1024);
+
 	archiveScanner = new CArchiveScanner();
 
 	archiveScanner->ReadCacheData(writedir->path + archiveScanner->GetFilename());
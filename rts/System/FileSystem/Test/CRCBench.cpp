@@ -0,0 +1,88 @@
+/**
+@file CRCBench.cpp
+@brief Throughput of CRC versus the byte-wise 7zip CRC
+
+Hashes buffers of several sizes repeatedly with both and prints MB/s, then
+hashes one big buffer in parallel chunks joined with CRC::Combine().
+
+usage: CRCBench [megabytes] [threads]
+*/
+
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "FileSystem/CRC.h"
+extern "C" {
+#include "7zCrc.h"
+}
+
+static double GetTime()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static void HashChunk(const unsigned char* data, unsigned size, unsigned* digest)
+{
+	*digest = CRC().Update(data, size).GetDigest();
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned megabytes = (argc > 1) ? atoi(argv[1]) : 256;
+	const unsigned numThreads = (argc > 2) ? atoi(argv[2]) : 4;
+	const unsigned total = megabytes << 20;
+
+	InitCrcTable();
+	std::vector<unsigned char> buf(total);
+	for (unsigned i = 0; i < total; ++i)
+		buf[i] = (i * 2654435761u) >> 24;
+
+	std::cout << "CRC uses " << CRC::GetImplementation() << std::endl;
+	const unsigned sizes[] = {16, 64, 256, 4096, 65536, 1 << 20};
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		const unsigned size = sizes[s];
+		const unsigned rounds = total / size;
+		volatile unsigned sink = 0; // keep the loops from being optimized away
+
+		double start = GetTime();
+		for (unsigned r = 0; r < rounds; ++r)
+			sink ^= CrcCalculateDigest(&buf[r * size], size);
+		const double ref = GetTime() - start;
+
+		start = GetTime();
+		for (unsigned r = 0; r < rounds; ++r)
+			sink ^= CRC().Update(&buf[r * size], size).GetDigest();
+		const double now = GetTime() - start;
+
+		printf("%8u bytes: 7zip %7.0f MB/s, CRC %7.0f MB/s (%.1fx)\n", size,
+			megabytes / ref, megabytes / now, ref / now);
+	}
+
+	// whole buffer in chunks, one thread each
+	const double start = GetTime();
+	const unsigned chunk = total / numThreads;
+	std::vector<unsigned> digests(numThreads);
+	std::vector<boost::thread*> threads;
+	for (unsigned t = 0; t < numThreads; ++t) {
+		const unsigned size = (t == numThreads - 1) ? total - t * chunk : chunk;
+		threads.push_back(new boost::thread(boost::bind(&HashChunk, &buf[t * chunk], size, &digests[t])));
+	}
+	unsigned digest = 0;
+	for (unsigned t = 0; t < numThreads; ++t) {
+		threads[t]->join();
+		delete threads[t];
+		const unsigned size = (t == numThreads - 1) ? total - t * chunk : chunk;
+		digest = (t == 0) ? digests[0] : CRC::Combine(digest, digests[t], size);
+	}
+	const double parallel = GetTime() - start;
+	const bool same = (digest == CrcCalculateDigest(&buf[0], total));
+	printf("%u MB in %u chunks: %.0f MB/s, digest %s\n", megabytes, numThreads, megabytes / parallel, same ? "identical" : "DIFFERS");
+	return same ? 0 : 1;
+}
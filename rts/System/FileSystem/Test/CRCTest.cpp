@@ -0,0 +1,105 @@
+/**
+@file CRCTest.cpp
+@brief Compares CRC against the byte-wise 7zip CRC it replaced
+
+Known test vectors, random buffers of every length up to a few KB at every
+alignment, data split over several Update() calls, Update(unsigned int) and
+CRC::Combine(). Build with -DCRC_NO_SIMD to test the slicing-by-8 path on
+CPUs with PCLMULQDQ. Returns non-zero if any digest differs.
+
+usage: CRCTest
+*/
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FileSystem/CRC.h"
+extern "C" {
+#include "7zCrc.h"
+}
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #cond << std::endl; \
+		if (++failures > 20) exit(1); \
+	}
+
+static unsigned Reference(const unsigned char* data, unsigned size)
+{
+	return CrcCalculateDigest(data, size);
+}
+
+static unsigned Digest(const unsigned char* data, unsigned size)
+{
+	return CRC().Update(data, size).GetDigest();
+}
+
+int main(int argc, char* argv[])
+{
+	InitCrcTable();
+	std::cout << "using " << CRC::GetImplementation() << std::endl;
+
+	// test vectors
+	CHECK(CRC().GetDigest() == 0);
+	CHECK(Digest((const unsigned char*)"a", 1) == 0xE8B7BE43);
+	CHECK(Digest((const unsigned char*)"123456789", 9) == 0xCBF43926);
+	CHECK(Digest((const unsigned char*)"The quick brown fox jumps over the lazy dog", 43) == 0x414FA339);
+
+	std::vector<unsigned char> buf(1 << 20);
+	srand(1234);
+	for (unsigned i = 0; i < buf.size(); ++i)
+		buf[i] = rand() & 0xFF;
+
+	// every length and alignment of small buffers
+	for (unsigned offset = 0; offset < 16; ++offset) {
+		for (unsigned size = 0; size <= 2048; ++size)
+			CHECK(Digest(&buf[offset], size) == Reference(&buf[offset], size));
+	}
+	// big ones
+	CHECK(Digest(&buf[0], buf.size()) == Reference(&buf[0], buf.size()));
+	CHECK(Digest(&buf[3], buf.size() - 3) == Reference(&buf[3], buf.size() - 3));
+
+	// split over several Update() calls
+	for (int i = 0; i < 1000; ++i) {
+		const unsigned size = rand() % 100000;
+		CRC crc;
+		unsigned pos = 0;
+		while (pos < size) {
+			const unsigned n = std::min(size - pos, (unsigned)(rand() % 300));
+			crc.Update(&buf[pos], n);
+			pos += n;
+		}
+		CHECK(crc.GetDigest() == Reference(&buf[0], size));
+	}
+
+	// Update(unsigned int) is little endian, like CrcUpdateUInt32
+	for (int i = 0; i < 1000; ++i) {
+		const unsigned v = rand() * 65599u + rand();
+		UInt32 ref;
+		CrcInit(&ref);
+		CrcUpdate(&ref, &buf[0], i);
+		CrcUpdateUInt32(&ref, v);
+		CHECK(CRC().Update(&buf[0], i).Update(v).GetDigest() == CrcGetDigest(&ref));
+	}
+
+	// Combine()
+	for (int i = 0; i < 1000; ++i) {
+		const unsigned size = rand() % 200000;
+		const unsigned split = size ? rand() % (size + 1) : 0;
+		const unsigned a = Digest(&buf[0], split);
+		const unsigned b = Digest(&buf[split], size - split);
+		CHECK(CRC::Combine(a, b, size - split) == Reference(&buf[0], size));
+	}
+	CHECK(CRC::Combine(Digest(&buf[0], 100), 0, 0) == Reference(&buf[0], 100));
+	CHECK(CRC::Combine(0, Digest(&buf[0], 100), 100) == Reference(&buf[0], 100));
+
+	if (failures)
+		std::cout << failures << " checks failed" << std::endl;
+	else
+		std::cout << "all checks passed" << std::endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+/**
+@file FileCacheTest.cpp
+@brief Checks and times archiveFileCache
+
+Writes dir/cachetest.sdz with numFiles deflated files, then reads all of
+them through a fresh CArchiveZip twice: the first time they are inflated,
+the second time they must come from the cache. Also checks that a changed
+archive is not served from the cache and that the budget is kept.
+
+usage: FileCacheTest <dir> [numFiles]
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "TestArchives.h"
+#include "FileSystem/ArchiveZip.h"
+#include "FileSystem/ArchiveFileCache.h"
+
+static const unsigned fileSize = 256 * 1024;
+
+static std::string FileName(unsigned i)
+{
+	char buf[64];
+	sprintf(buf, "Bitmaps/File%u.dat", i);
+	return buf;
+}
+
+static void WriteZip(const std::string& path, unsigned numFiles, unsigned seed)
+{
+	std::vector<ArchiveFile> files(numFiles);
+	for (unsigned i = 0; i < numFiles; ++i) {
+		files[i].name = FileName(i);
+		files[i].data = FileContents(seed + i, fileSize);
+	}
+	WriteZip(path, files);
+}
+
+/// read every file through a new archive object, @return seconds taken
+static double ReadAll(const std::string& path, unsigned numFiles, unsigned seed)
+{
+	const double start = GetTime();
+	CArchiveZip zip(path);
+	CHECK(zip.IsOpen());
+	std::string buf(fileSize, ' ');
+	for (unsigned i = 0; i < numFiles; ++i) {
+		const int fh = zip.OpenFile(FileName(i));
+		CHECK(fh != 0);
+		if (!fh)
+			continue;
+		CHECK(zip.FileSize(fh) == (int)fileSize);
+		CHECK(zip.ReadFile(fh, &buf[0], fileSize) == (int)fileSize);
+		zip.CloseFile(fh);
+	}
+	const double time = GetTime() - start;
+
+	// check outside of the timing
+	for (unsigned i = 0; i < numFiles; i += 7) {
+		const int fh = zip.OpenFile(FileName(i));
+		zip.ReadFile(fh, &buf[0], fileSize);
+		zip.CloseFile(fh);
+		CHECK(buf == FileContents(seed + i, fileSize));
+	}
+	return time;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " <dir> [numFiles]" << std::endl;
+		return 1;
+	}
+	const std::string path = std::string(argv[1]) + "/cachetest.sdz";
+	const unsigned numFiles = (argc > 2) ? atoi(argv[2]) : 64;
+
+	remove(path.c_str());
+	WriteZip(path, numFiles, 0);
+	archiveFileCache.SetBudget(numFiles * fileSize * 2);
+	archiveFileCache.Clear();
+
+	const double inflated = ReadAll(path, numFiles, 0);
+	const unsigned cachedSize = archiveFileCache.GetSize();
+	CHECK(cachedSize == numFiles * fileSize);
+	const double cached = ReadAll(path, numFiles, 0);
+	CHECK(archiveFileCache.GetSize() == cachedSize);
+
+	// same name, new contents (and size) must not hit the old entries
+	sleep(1);
+	remove(path.c_str());
+	WriteZip(path, numFiles, 1000);
+	ReadAll(path, numFiles, 1000);
+	CHECK(archiveFileCache.GetSize() <= numFiles * fileSize * 2);
+
+	// a smaller budget drops the least recently used files
+	archiveFileCache.SetBudget(numFiles * fileSize / 2);
+	CHECK(archiveFileCache.GetSize() <= numFiles * fileSize / 2);
+	ReadAll(path, numFiles, 1000);
+	CHECK(archiveFileCache.GetSize() <= numFiles * fileSize / 2);
+
+	// files bigger than a quarter of the budget are not cached at all
+	archiveFileCache.Clear();
+	archiveFileCache.SetBudget(fileSize * 2);
+	ReadAll(path, numFiles, 1000);
+	CHECK(archiveFileCache.GetSize() == 0);
+
+	archiveFileCache.SetBudget(0);
+	ReadAll(path, numFiles, 1000);
+	CHECK(archiveFileCache.GetSize() == 0);
+
+	printf("%u files of %u KB: inflated %.1f ms, cached %.1f ms\n", numFiles, fileSize / 1024, inflated * 1000, cached * 1000);
+	if (Failures())
+		std::cout << Failures() << " checks failed" << std::endl;
+	else
+		std::cout << "all checks passed" << std::endl;
+	return Failures() ? 1 : 0;
+}
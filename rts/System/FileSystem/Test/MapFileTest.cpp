@@ -0,0 +1,183 @@
+/**
+@file MapFileTest.cpp
+@brief Checks and times memory mapped reads through the VFS
+
+Writes dir/maptest.sdz with a stored and a deflated entry and dir/maptest.sdd
+with the same files, then checks that CArchiveBase::MapFile maps exactly the
+stored ones with the right contents, that a stored entry with a damaged
+byte is neither mapped nor read, that CFileHandler reads the same from
+mapped and buffered files, and compares the time to load the big file
+through CFileHandler with and without mapping.
+
+usage: MapFileTest <dir> [megabytes]
+*/
+
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "TestArchives.h"
+#include "FileSystem/ArchiveZip.h"
+#include "FileSystem/ArchiveDir.h"
+#include "FileSystem/FileMapping.h"
+#include "FileSystem/FileHandler.h"
+#include "FileSystem/VFSHandler.h"
+#include "FileSystem/FileSystem.h"
+#include "FileSystem/CRC.h"
+#include "ConfigHandler.h"
+
+static void WriteFile(const std::string& path, const std::string& data)
+{
+	FILE* f = fopen(path.c_str(), "wb");
+	fwrite(data.data(), 1, data.size(), f);
+	fclose(f);
+}
+
+static std::string ReadWholeFile(const std::string& path)
+{
+	std::string data;
+	FILE* f = fopen(path.c_str(), "rb");
+	char buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.append(buf, n);
+	fclose(f);
+	return data;
+}
+
+static bool Equals(CFileMapping* m, const std::string& data)
+{
+	return m && m->GetSize() == data.size() && memcmp(m->GetData(), data.data(), data.size()) == 0;
+}
+
+/// the big file is stored, the small one deflated
+static void CheckArchive(CArchiveBase* ar, const std::string& big, const std::string& small, bool smallMappable)
+{
+	CFileMapping* m = ar->MapFile("maps/Big.smt");
+	CHECK(Equals(m, big));
+	delete m;
+
+	m = ar->MapFile("maps/small.txt");
+	CHECK(smallMappable ? Equals(m, small) : (m == NULL));
+	delete m;
+
+	CHECK(ar->MapFile("maps/missing.txt") == NULL);
+	CHECK(ar->GetCrc32("maps/big.smt") == CRC().Update(big.data(), big.size()).GetDigest());
+
+	// mapping must not disturb reading other files
+	const int fh = ar->OpenFile("maps/small.txt");
+	CHECK(fh != 0);
+	if (fh) {
+		std::string read(small.size(), ' ');
+		CHECK(ar->ReadFile(fh, &read[0], read.size()) == (int)small.size() && read == small);
+		ar->CloseFile(fh);
+	}
+}
+
+static void CheckFileHandler(const std::string& name, const std::string& data, bool mapped)
+{
+	CFileHandler f(name, SPRING_VFS_MOD);
+	CHECK(f.FileExists() && f.FileSize() == (int)data.size());
+	CHECK(f.GetData() && memcmp(f.GetData(), data.data(), data.size()) == 0);
+
+	std::string read(100, ' ');
+	f.Seek(data.size() - 50);
+	CHECK(f.Read(&read[0], 100) == 50 && read.compare(0, 50, data, data.size() - 50, 50) == 0);
+	CHECK(f.Eof() && f.Peek() == EOF);
+	f.Seek(1);
+	CHECK(f.Peek() == (unsigned char)data[1]);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " <dir> [megabytes]" << std::endl;
+		return 1;
+	}
+	const std::string dir = argv[1];
+	const unsigned megabytes = (argc > 2) ? atoi(argv[2]) : 64;
+
+	const std::string big = FileContents(1, megabytes << 20);
+	const std::string small = std::string("tiny text\n") + FileContents(2, 1000);
+
+	const std::string zipName = dir + "/maptest.sdz";
+	zipFile zf = zipOpen(zipName.c_str(), APPEND_STATUS_CREATE);
+	AddToZip(zf, "maps/small.txt", small, Z_DEFLATED);
+	AddToZip(zf, "maps/big.smt", big, 0);
+	zipClose(zf, NULL);
+
+	const std::string dirName = dir + "/maptest.sdd";
+	mkdir(dirName.c_str(), 0755);
+	mkdir((dirName + "/maps").c_str(), 0755);
+	WriteFile(dirName + "/maps/big.smt", big);
+	WriteFile(dirName + "/maps/small.txt", small);
+
+	setenv("SPRING_DATADIR", dir.c_str(), 1);
+	ConfigHandler::Instantiate(dir + "/maptestrc");
+	FileSystemHandler::Initialize(false);
+
+	CArchiveZip* zip = new CArchiveZip(zipName);
+	CHECK(zip->IsOpen());
+	CheckArchive(zip, big, small, false);
+	delete zip;
+
+	// the CRC check of the first mapping has to catch this
+	std::string damaged = ReadWholeFile(zipName);
+	const std::string::size_type pos = damaged.find(big.substr(big.size() / 2, 64));
+	CHECK(pos != std::string::npos);
+	if (pos != std::string::npos) {
+		damaged[pos] ^= 1;
+		const std::string damagedName = dir + "/maptest-damaged.sdz";
+		WriteFile(damagedName, damaged);
+		zip = new CArchiveZip(damagedName);
+		CHECK(zip->IsOpen());
+		CHECK(zip->MapFile("maps/big.smt") == NULL);
+		CHECK(zip->MapFile("maps/big.smt") == NULL);
+		CHECK(zip->OpenFile("maps/big.smt") == 0);
+		delete zip;
+	}
+
+	CArchiveDir* sdd = new CArchiveDir(dirName);
+	CheckArchive(sdd, big, small, true);
+	delete sdd;
+
+	vfsHandler = new CVFSHandler();
+	CHECK(vfsHandler->AddArchive(zipName, false));
+	CheckFileHandler("maps/big.smt", big, true);
+	CheckFileHandler("maps/small.txt", small, false);
+
+	// what loading the big file cost before: a buffer for all of it, the
+	// archive copies into it, the caller copies out of it
+	std::string dest(big.size(), ' ');
+	double start = GetTime();
+	{
+		const int size = vfsHandler->GetFileSize("maps/big.smt");
+		unsigned char* buf = new unsigned char[size];
+		vfsHandler->LoadFile("maps/big.smt", buf);
+		memcpy(&dest[0], buf, size);
+		delete[] buf;
+	}
+	const double buffered = GetTime() - start;
+	CHECK(dest == big);
+
+	dest.assign(big.size(), ' ');
+	start = GetTime();
+	{
+		CFileHandler f("maps/big.smt", SPRING_VFS_MOD);
+		f.Read(&dest[0], f.FileSize());
+	}
+	const double mapped = GetTime() - start;
+	CHECK(dest == big);
+	delete vfsHandler;
+	vfsHandler = NULL;
+
+	printf("%u MB stored file: buffered %.1f ms, mapped %.1f ms\n", megabytes, buffered * 1000, mapped * 1000);
+	if (Failures())
+		std::cout << Failures() << " checks failed" << std::endl;
+	else
+		std::cout << "all checks passed" << std::endl;
+	return Failures() ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+/**
+@file PrefetchBench.cpp
+@brief Time CVFSHandler::Prefetch on a generated mod
+
+Writes dir/prefetch.sdz (deflated) and dir/prefetch.sd7 (one solid block)
+with numFiles files of 1 to 64 KB under units/, scripts/ and objects3d/,
+then loads all of them through CFileHandler: once without prefetching and
+once after Prefetch per thread count (HardwareThreadCount). The contents are
+checked each time. Returns non-zero if anything read back differs.
+Loading the .sd7 without prefetching decodes the whole block for every
+file, so that run grows with the square of numFiles.
+
+usage: PrefetchBench <dir> [numFiles] [threads ...]
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TestArchives.h"
+#include "FileSystem/ArchiveFileCache.h"
+#include "FileSystem/FileHandler.h"
+#include "FileSystem/VFSHandler.h"
+#include "FileSystem/FileSystem.h"
+#include "ConfigHandler.h"
+
+static std::vector<ArchiveFile> ModContents(unsigned numFiles)
+{
+	static const char* dirs[] = {"units", "scripts", "objects3d"};
+	std::vector<ArchiveFile> files(numFiles);
+	unsigned x = 12345;
+	for (unsigned f = 0; f < numFiles; ++f) {
+		char name[64];
+		sprintf(name, "%s/file%u.dat", dirs[f % 3], f);
+		files[f].name = name;
+		const unsigned size = 1024 + (f * 7919) % (63 * 1024);
+		files[f].data.resize(size);
+		for (unsigned i = 0; i < size; ++i) {
+			x = x * 1103515245 + 12345;
+			files[f].data[i] = 'a' + ((x >> 16) % 16);
+		}
+	}
+	return files;
+}
+
+/// @return false if a file differs
+static bool LoadAll(const std::vector<ArchiveFile>& files)
+{
+	bool same = true;
+	std::string data;
+	for (unsigned f = 0; f < files.size(); ++f) {
+		CFileHandler fh(files[f].name, SPRING_VFS_MOD);
+		data.clear();
+		if (!fh.LoadStringData(data) || data != files[f].data)
+			same = false;
+	}
+	return same;
+}
+
+static bool Bench(const std::string& archive, const std::vector<ArchiveFile>& files, const std::vector<int>& threadCounts)
+{
+	vfsHandler = new CVFSHandler();
+	vfsHandler->AddArchive(archive, false);
+	std::cout << archive << std::endl;
+
+	archiveFileCache.Clear();
+	double start = GetTime();
+	bool same = LoadAll(files);
+	printf("\tno prefetch: %.1f ms\n", (GetTime() - start) * 1000);
+
+	std::vector<std::string> dirs;
+	dirs.push_back("units/");
+	dirs.push_back("scripts/");
+	dirs.push_back("objects3d/");
+	for (unsigned t = 0; t < threadCounts.size(); ++t) {
+		configHandler.Set("HardwareThreadCount", threadCounts[t]);
+		archiveFileCache.Clear();
+		start = GetTime();
+		vfsHandler->Prefetch(dirs);
+		const double prefetch = GetTime() - start;
+		same = LoadAll(files) && same;
+		printf("\t%d threads: prefetch %.1f ms, total %.1f ms\n", threadCounts[t], prefetch * 1000, (GetTime() - start) * 1000);
+	}
+
+	delete vfsHandler;
+	vfsHandler = NULL;
+	return same;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " <dir> [numFiles] [threads ...]" << std::endl;
+		return 1;
+	}
+	const std::string dir = argv[1];
+	const unsigned numFiles = (argc > 2) ? atoi(argv[2]) : 1000;
+	std::vector<int> threadCounts;
+	for (int i = 3; i < argc; ++i)
+		threadCounts.push_back(atoi(argv[i]));
+	if (threadCounts.empty()) {
+		threadCounts.push_back(1);
+		threadCounts.push_back(2);
+		threadCounts.push_back(4);
+		threadCounts.push_back(8);
+	}
+
+	InitCrcTable();
+	const std::vector<ArchiveFile> files = ModContents(numFiles);
+	remove((dir + "/prefetch.sdz").c_str());
+	WriteZip(dir + "/prefetch.sdz", files);
+	Write7z(dir + "/prefetch.sd7", files);
+
+	setenv("SPRING_DATADIR", dir.c_str(), 1);
+	ConfigHandler::Instantiate(dir + "/prefetchrc");
+	FileSystemHandler::Initialize(false);
+	// all of the mod fits
+	archiveFileCache.SetBudget(numFiles * 64 * 1024 * 2);
+
+	bool same = Bench(dir + "/prefetch.sdz", files, threadCounts);
+	same = Bench(dir + "/prefetch.sd7", files, threadCounts) && same;
+
+	std::cout << (same ? "all files read back correctly" : "FILES DIFFER") << std::endl;
+	return same ? 0 : 1;
+}
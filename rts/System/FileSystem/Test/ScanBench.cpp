@@ -0,0 +1,178 @@
+/**
+@file ScanBench.cpp
+@brief Time CArchiveScanner::ScanDirs over generated archives
+
+Fills dir/maps with numArchives archives (a third each .sdz, .sd7 and .sdd)
+of filesPerArchive pseudo random files, every tenth with a modinfo.lua, plus
+a springcontent.sdz in dir/base for the modinfo.tdf helpers. The directory
+is then scanned from scratch, checksums included, once per thread count
+(HardwareThreadCount), and the checksums of all runs are compared. Last the
+startup with a valid cache (read cache, scan, write cache) is timed.
+
+usage: ScanBench <dir> [numArchives] [filesPerArchive] [threads ...]
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "TestArchives.h"
+#include "FileSystem/ArchiveScanner.h"
+#include "FileSystem/FileSystem.h"
+#include "ConfigHandler.h"
+
+static const unsigned fileSize = 32 * 1024;
+
+static std::vector<ArchiveFile> ArchiveContents(unsigned archive, unsigned numFiles)
+{
+	std::vector<ArchiveFile> files;
+	char buf[64];
+	for (unsigned f = 0; f < numFiles; ++f) {
+		ArchiveFile file;
+		if (f == 0)
+			sprintf(buf, "maps/Bench%u.smf", archive);
+		else
+			sprintf(buf, "bitmaps/file%u.dat", f);
+		file.name = buf;
+		file.data = FileContents(archive * 1000 + f, fileSize);
+		files.push_back(file);
+	}
+	if (archive % 10 == 0) {
+		ArchiveFile modinfo;
+		modinfo.name = "modinfo.lua";
+		sprintf(buf, "return { name = 'Bench %u', version = 'v1', modtype = 1 }\n", archive);
+		modinfo.data = buf;
+		files.push_back(modinfo);
+	}
+	return files;
+}
+
+static std::string ArchiveName(unsigned archive)
+{
+	char name[64];
+	sprintf(name, "bench%u.%s", archive, (archive % 3 == 0) ? "sdz" : ((archive % 3 == 1) ? "sd7" : "sdd"));
+	return name;
+}
+
+static std::vector<unsigned> Checksums(CArchiveScanner* scanner, unsigned numArchives)
+{
+	std::vector<unsigned> checksums;
+	for (unsigned a = 0; a < numArchives; ++a)
+		checksums.push_back(scanner->GetArchiveChecksum(ArchiveName(a)));
+	return checksums;
+}
+
+static void WriteDir(const std::string& path, const std::vector<ArchiveFile>& files)
+{
+	mkdir(path.c_str(), 0755);
+	mkdir((path + "/maps").c_str(), 0755);
+	mkdir((path + "/bitmaps").c_str(), 0755);
+	for (unsigned i = 0; i < files.size(); ++i) {
+		std::ofstream out((path + "/" + files[i].name).c_str(), std::ios::binary);
+		out << files[i].data;
+	}
+}
+
+static void Generate(const std::string& dir, unsigned numArchives, unsigned numFiles)
+{
+	mkdir(dir.c_str(), 0755);
+	mkdir((dir + "/maps").c_str(), 0755);
+	mkdir((dir + "/base").c_str(), 0755);
+
+	std::vector<ArchiveFile> content(2);
+	content[0].name = "gamedata/parse_tdf.lua";
+	content[0].data = "local TDFparser = {}\nreturn TDFparser\n";
+	content[1].name = "gamedata/scanutils.lua";
+	content[1].data = "function MakeArray(t, prefix) return {} end\n";
+	WriteZip(dir + "/base/springcontent.sdz", content);
+
+	for (unsigned a = 0; a < numArchives; ++a) {
+		const std::vector<ArchiveFile> files = ArchiveContents(a, numFiles);
+		const std::string path = dir + "/maps/" + ArchiveName(a);
+		switch (a % 3) {
+			case 0: WriteZip(path, files); break;
+			case 1: Write7z(path, files); break;
+			case 2: WriteDir(path, files); break;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " <dir> [numArchives] [filesPerArchive] [threads ...]" << std::endl;
+		return 1;
+	}
+	const std::string dir = argv[1];
+	const unsigned numArchives = (argc > 2) ? atoi(argv[2]) : 300;
+	const unsigned numFiles = (argc > 3) ? atoi(argv[3]) : 16;
+	std::vector<int> threadCounts;
+	for (int i = 4; i < argc; ++i)
+		threadCounts.push_back(atoi(argv[i]));
+	if (threadCounts.empty()) {
+		threadCounts.push_back(1);
+		threadCounts.push_back(2);
+		threadCounts.push_back(4);
+		threadCounts.push_back(8);
+	}
+
+	InitCrcTable();
+	std::cout << "generating " << numArchives << " archives of " << numFiles << " files" << std::endl;
+	Generate(dir, numArchives, numFiles);
+
+	setenv("SPRING_DATADIR", dir.c_str(), 1);
+	ConfigHandler::Instantiate(dir + "/benchrc");
+	FileSystemHandler::Initialize(false);
+
+	std::vector<std::string> scanDirs;
+	scanDirs.push_back(dir + "/base");
+	scanDirs.push_back(dir + "/maps");
+
+	const std::string cacheFile = dir + "/bench.cache";
+	std::vector<unsigned> reference;
+	bool same = true;
+	for (unsigned t = 0; t < threadCounts.size(); ++t) {
+		configHandler.Set("HardwareThreadCount", threadCounts[t]);
+
+		// a fresh scanner without cache opens and checksums everything
+		CArchiveScanner* scanner = new CArchiveScanner();
+		const double start = GetTime();
+		scanner->ScanDirs(scanDirs, true);
+		const unsigned time = (GetTime() - start) * 1000;
+
+		const std::vector<unsigned> checksums = Checksums(scanner, numArchives);
+		const unsigned maps = scanner->GetMaps().size();
+		const unsigned mods = scanner->GetAllMods().size();
+		if (t == threadCounts.size() - 1)
+			scanner->WriteCacheData(cacheFile);
+		delete scanner;
+
+		if (t == 0)
+			reference = checksums;
+		else if (checksums != reference)
+			same = false;
+
+		std::cout << threadCounts[t] << " threads: " << time << " ms, " << maps << " maps, " << mods << " mods" << std::endl;
+	}
+
+	{
+		CArchiveScanner* scanner = new CArchiveScanner();
+		const double start = GetTime();
+		scanner->ReadCacheData(cacheFile);
+		scanner->ScanDirs(scanDirs, true);
+		scanner->WriteCacheData(cacheFile);
+		const unsigned time = (GetTime() - start) * 1000;
+
+		if (Checksums(scanner, numArchives) != reference)
+			same = false;
+		std::cout << "with cache: " << time << " ms, " << scanner->GetMaps().size() << " maps, " << scanner->GetAllMods().size() << " mods" << std::endl;
+		delete scanner;
+	}
+	std::cout << (same ? "checksums identical for all runs" : "CHECKSUMS DIFFER") << std::endl;
+	return same ? 0 : 1;
+}
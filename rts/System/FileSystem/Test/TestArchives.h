@@ -0,0 +1,174 @@
+/**
+@file TestArchives.h
+@brief Writers for the archives the file system tests run on, and the
+checks and timing the tests share
+
+.sdz are written with minizip, .sd7 by hand: one solid block with the Copy
+coder, which is all CArchive7Zip needs and needs no LZMA encoder.
+*/
+
+#ifndef TESTARCHIVES_H
+#define TESTARCHIVES_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <sys/time.h>
+
+#include "zip.h"
+extern "C" {
+#include "7zCrc.h"
+}
+
+struct ArchiveFile
+{
+	std::string name;
+	std::string data;
+};
+
+/// number of failed CHECKs so far
+inline int& Failures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(cond) \
+	if (!(cond)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #cond << std::endl; \
+		++Failures(); \
+	}
+
+/// wall clock in seconds
+inline double GetTime()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/// compressible, but not trivially
+inline std::string FileContents(unsigned seed, unsigned size)
+{
+	std::string data(size, ' ');
+	unsigned x = seed * 2654435761u + 1;
+	for (unsigned i = 0; i < size; ++i) {
+		x = x * 1103515245 + 12345;
+		data[i] = 'a' + ((x >> 16) % 16);
+	}
+	return data;
+}
+
+/// @param method Z_DEFLATED or 0 to store the file
+inline void AddToZip(zipFile zf, const std::string& name, const std::string& data, int method)
+{
+	zip_fileinfo zi;
+	memset(&zi, 0, sizeof(zi));
+	zipOpenNewFileInZip(zf, name.c_str(), &zi, NULL, 0, NULL, 0, NULL, method, Z_DEFAULT_COMPRESSION);
+	zipWriteInFileInZip(zf, data.data(), data.size());
+	zipCloseFileInZip(zf);
+}
+
+inline void WriteZip(const std::string& path, const std::vector<ArchiveFile>& files)
+{
+	zipFile zf = zipOpen(path.c_str(), APPEND_STATUS_CREATE);
+	for (unsigned i = 0; i < files.size(); ++i)
+		AddToZip(zf, files[i].name, files[i].data, Z_DEFLATED);
+	zipClose(zf, NULL);
+}
+
+inline void Put7zNumber(std::string& out, unsigned long long value)
+{
+	unsigned char first = 0, mask = 0x80;
+	int i;
+	for (i = 0; i < 8; i++) {
+		if (value < (1ULL << (7 * (i + 1)))) {
+			first |= (unsigned char)(value >> (8 * i));
+			break;
+		}
+		first |= mask;
+		mask >>= 1;
+	}
+	out += (char)first;
+	for (; i > 0; i--) {
+		out += (char)(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+inline void Put7zUInt(std::string& out, unsigned long long value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i, value >>= 8)
+		out += (char)(value & 0xFF);
+}
+
+inline void Write7z(const std::string& path, const std::vector<ArchiveFile>& files)
+{
+	std::string packed;
+	for (unsigned i = 0; i < files.size(); ++i)
+		packed += files[i].data;
+
+	std::string h;
+	h += (char)0x01; // kHeader
+	h += (char)0x04; // kMainStreamsInfo
+	h += (char)0x06; // kPackInfo
+	Put7zNumber(h, 0);
+	Put7zNumber(h, 1);
+	h += (char)0x09; // kSize
+	Put7zNumber(h, packed.size());
+	h += (char)0x00;
+	h += (char)0x07; // kUnPackInfo
+	h += (char)0x0B; // kFolder
+	Put7zNumber(h, 1);
+	h += (char)0x00; // not external
+	Put7zNumber(h, 1); // coders
+	h += (char)0x01; // simple coder, 1 byte id
+	h += (char)0x00; // Copy
+	h += (char)0x0C; // kCodersUnPackSize
+	Put7zNumber(h, packed.size());
+	h += (char)0x00;
+	h += (char)0x08; // kSubStreamsInfo
+	h += (char)0x0D; // kNumUnPackStream
+	Put7zNumber(h, files.size());
+	h += (char)0x09; // kSize
+	for (unsigned i = 0; i + 1 < files.size(); ++i)
+		Put7zNumber(h, files[i].data.size());
+	h += (char)0x0A; // kCRC
+	h += (char)0x01; // all defined
+	for (unsigned i = 0; i < files.size(); ++i)
+		Put7zUInt(h, CrcCalculateDigest(files[i].data.data(), files[i].data.size()), 4);
+	h += (char)0x00;
+	h += (char)0x00;
+	h += (char)0x05; // kFilesInfo
+	Put7zNumber(h, files.size());
+	std::string names;
+	names += (char)0x00; // not external
+	for (unsigned i = 0; i < files.size(); ++i) {
+		for (unsigned c = 0; c <= files[i].name.size(); ++c) {
+			names += files[i].name.c_str()[c];
+			names += (char)0x00;
+		}
+	}
+	h += (char)0x11; // kName
+	Put7zNumber(h, names.size());
+	h += names;
+	h += (char)0x00;
+	h += (char)0x00;
+
+	std::string start;
+	Put7zUInt(start, packed.size(), 8);
+	Put7zUInt(start, h.size(), 8);
+	Put7zUInt(start, CrcCalculateDigest(h.data(), h.size()), 4);
+
+	std::ofstream out(path.c_str(), std::ios::binary);
+	out.write("7z\xBC\xAF\x27\x1C", 6);
+	out.put(0);
+	out.put(2);
+	std::string startCrc;
+	Put7zUInt(startCrc, CrcCalculateDigest(start.data(), start.size()), 4);
+	out << startCrc << start << packed << h;
+}
+
+#endif
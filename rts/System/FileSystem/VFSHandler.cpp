@@ -6,8 +6,12 @@
 #include "VFSHandler.h"
 #include "ArchiveFactory.h"
 #include "ArchiveBase.h"
+#include "ArchiveBuffered.h"
+#include "ArchiveFileCache.h"
+#include "FileMapping.h"
 #include "ArchiveDir.h" // for FileData::dynamic
 #include "LogOutput.h"
+#include "WorkerThreads.h"
 #include "FileSystem/FileSystem.h"
 #include "Util.h"
 
@@ -107,6 +111,70 @@ int CVFSHandler::LoadFile(const std::string& rawName, void* buffer)
 }
 
 
+CFileMapping* CVFSHandler::MapFile(const std::string& rawName)
+{
+	logOutput.Print(LOG_VFS, "MapFile(rawName = \"%s\")", rawName.c_str());
+
+	std::string name = StringToLower(rawName);
+	filesystem.ForwardSlashes(name);
+
+	std::map<std::string, FileData>::iterator fi = files.find(name);
+	if (fi == files.end()) {
+		logOutput.Print(LOG_VFS, "MapFile: File '%s' does not exist in VFS.", rawName.c_str());
+		return NULL;
+	}
+	return fi->second.ar->MapFile(name);
+}
+
+
+void CVFSHandler::Prefetch(const std::vector<std::string>& rawNames)
+{
+	logOutput.Print(LOG_VFS, "Prefetch(%u names)", (unsigned)rawNames.size());
+
+	const int numThreads = GetWorkerThreadCount();
+
+	// more than the cache holds would only push out what was prefetched first
+	const unsigned maxBytes = archiveFileCache.GetBudget() / 2;
+	unsigned bytes = 0;
+	bool full = false;
+	std::map<CArchiveBuffered*, std::vector<std::string> > perArchive;
+
+	for (std::vector<std::string>::const_iterator ni = rawNames.begin(); ni != rawNames.end() && !full; ++ni) {
+		std::string name = StringToLower(*ni);
+		filesystem.ForwardSlashes(name);
+
+		std::map<std::string, FileData>::const_iterator first = files.find(name);
+		std::map<std::string, FileData>::const_iterator last = first;
+		if (first != files.end()) {
+			++last;
+		} else if (!name.empty() && name[name.length() - 1] == '/') {
+			std::string nameEnd = name;
+			nameEnd[nameEnd.length() - 1] = '/' + 1;
+			first = files.lower_bound(name);
+			last = files.lower_bound(nameEnd);
+		}
+
+		// only count what is going to be decompressed, the rest costs no cache
+		for (; first != last; ++first) {
+			if (first->second.dynamic)
+				continue;
+			CArchiveBuffered* ar = dynamic_cast<CArchiveBuffered*>(first->second.ar);
+			if (!ar || !ar->WillPrefetch(first->first))
+				continue;
+			if (bytes + first->second.size > maxBytes) {
+				full = true;
+				break;
+			}
+			bytes += first->second.size;
+			perArchive[ar].push_back(first->first);
+		}
+	}
+
+	for (std::map<CArchiveBuffered*, std::vector<std::string> >::iterator ai = perArchive.begin(); ai != perArchive.end(); ++ai)
+		ai->first->Prefetch(ai->second, numThreads);
+}
+
+
 int CVFSHandler::GetFileSize(const std::string& rawName)
 {
 	logOutput.Print(LOG_VFS, "GetFileSize(rawName = \"%s\")", rawName.c_str());
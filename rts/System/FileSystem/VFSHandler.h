@@ -6,6 +6,7 @@
 #include <vector>
 
 class CArchiveBase;
+class CFileMapping;
 
 class CVFSHandler
 {
@@ -23,6 +24,21 @@ public:
 
 	int LoadFile(const std::string& name, void* buffer);
 	int GetFileSize(const std::string& name);
+	/**
+	@brief Map a file into memory instead of loading it
+	Works for files stored uncompressed in their archive (directories, stored
+	zip entries), NULL otherwise; fall back to LoadFile then.
+	The caller deletes the mapping.
+	*/
+	CFileMapping* MapFile(const std::string& name);
+
+	/**
+	@brief Decompress files in parallel before they are loaded
+	Names ending in '/' stand for everything below that directory. The
+	files go into archiveFileCache, up to half of its budget, and are then
+	opened without decompressing. Uses HardwareThreadCount threads.
+	*/
+	void Prefetch(const std::vector<std::string>& names);
 
 	std::vector<std::string> GetFilesInDir(const std::string& dir);
 	std::vector<std::string> GetDirsInDir(const std::string& dir);
@@ -1,5 +1,7 @@
 #include <string.h>
+#include <vector>
 #include <stdexcept>
+#include <boost/thread/mutex.hpp>
 #include "mmgr.h"
 
 #include "RawPacket.h"
@@ -7,28 +9,154 @@
 namespace netcode
 {
 
+namespace
+{
+
+/**
+@brief size-class free-lists for packet buffers
+Most protocol messages and datagrams are a few dozen bytes, so they are carved
+from 64k chunks, which are kept until the process ends. Packets are created and
+destroyed by both the game and the server thread, hence the lock.
+*/
+class PacketPool
+{
+public:
+	PacketPool()
+	{
+		for (unsigned i = 0; i < NUM_SIZE_CLASSES; ++i)
+			freeLists[i] = NULL;
+		RawPacket::Stats zero = {0, 0, 0};
+		stats = zero;
+	}
+
+	unsigned char* Alloc(const unsigned length, const unsigned copied)
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex);
+		++stats.numPackets;
+		stats.bytesCopied += copied;
+		if (length > MAX_POOLED_SIZE)
+		{
+			++stats.numSysAllocs;
+			return new unsigned char[length];
+		}
+		const unsigned sizeClass = (length - 1) / SIZE_CLASS_STEP;
+		if (!freeLists[sizeClass])
+			AddChunk(sizeClass);
+		FreeNode* node = freeLists[sizeClass];
+		freeLists[sizeClass] = node->next;
+		return (unsigned char*)node;
+	}
+
+	void Free(unsigned char* data, const unsigned length)
+	{
+		if (length > MAX_POOLED_SIZE)
+		{
+			delete[] data;
+			return;
+		}
+		boost::mutex::scoped_lock scoped_lock(mutex);
+		const unsigned sizeClass = (length - 1) / SIZE_CLASS_STEP;
+		FreeNode* node = (FreeNode*)data;
+		node->next = freeLists[sizeClass];
+		freeLists[sizeClass] = node;
+	}
+
+	RawPacket::Stats stats;
+	boost::mutex mutex;
+
+private:
+	void AddChunk(const unsigned sizeClass)
+	{
+		++stats.numSysAllocs;
+		const unsigned blockSize = (sizeClass + 1) * SIZE_CLASS_STEP;
+		unsigned char* chunk = new unsigned char[CHUNK_SIZE];
+		chunks.push_back(chunk);
+		for (unsigned pos = 0; pos + blockSize <= CHUNK_SIZE; pos += blockSize)
+		{
+			FreeNode* node = (FreeNode*)(chunk + pos);
+			node->next = freeLists[sizeClass];
+			freeLists[sizeClass] = node;
+		}
+	}
+
+	static const unsigned SIZE_CLASS_STEP = 32;
+	static const unsigned MAX_POOLED_SIZE = 512;
+	static const unsigned NUM_SIZE_CLASSES = MAX_POOLED_SIZE / SIZE_CLASS_STEP;
+	static const unsigned CHUNK_SIZE = 64 * 1024;
+
+	struct FreeNode {
+		FreeNode* next;
+	};
+	FreeNode* freeLists[NUM_SIZE_CLASSES];
+	std::vector<unsigned char*> chunks;
+};
+
+PacketPool& GetPool()
+{
+	// never destroyed, packets may outlive static destruction
+	static PacketPool* pool = new PacketPool();
+	return *pool;
+}
+
+}
+
 RawPacket::RawPacket(const unsigned char* const tdata, const unsigned newLength) : length(newLength)
 {
 	if (length > 0)
 	{
-		data = new unsigned char[length];
+		data = AllocData(length, length);
 		memcpy(data, tdata, length);
 	}
 	else
 	{
+		data = NULL;
 	}
 }
 
 RawPacket::RawPacket(const unsigned newLength) : length(newLength)
 {
 	if (length > 0)
-		data = new unsigned char[length];
+		data = AllocData(length, 0);
+	else
+		data = NULL;
 }
 
 RawPacket::~RawPacket()
 {
 	if (length > 0)
-		delete[] data;
+		FreeData(data, length);
+}
+
+unsigned char* RawPacket::AllocData(const unsigned length, const unsigned copied)
+{
+	return GetPool().Alloc(length, copied);
+}
+
+void RawPacket::FreeData(unsigned char* data, const unsigned length)
+{
+	GetPool().Free(data, length);
+}
+
+RawPacket::Stats RawPacket::GetStats()
+{
+	PacketPool& pool = GetPool();
+	boost::mutex::scoped_lock scoped_lock(pool.mutex);
+	return pool.stats;
+}
+
+void RawPacket::ResetStats()
+{
+	PacketPool& pool = GetPool();
+	boost::mutex::scoped_lock scoped_lock(pool.mutex);
+	RawPacket::Stats zero = {0, 0, 0};
+	pool.stats = zero;
+}
+
+void RawPacket::AddBytesCopied(const unsigned bytes)
+{
+	PacketPool& pool = GetPool();
+	boost::mutex::scoped_lock scoped_lock(pool.mutex);
+	pool.stats.bytesCopied += bytes;
 }
 
 } // namespace netcode
@@ -8,6 +8,8 @@ namespace netcode
 
 /**
 @brief simple structure to hold some data
+The data of small packets comes from a slab pool shared by all packets, so
+building a protocol message does not hit the system allocator.
 */
 class RawPacket : public boost::noncopyable
 {
@@ -32,8 +34,25 @@ public:
 	
 	unsigned char* data;
 	const unsigned length;
+
+	/// traffic counters, for measuring how much the packet pipeline allocates and copies
+	struct Stats
+	{
+		/// packets created
+		unsigned long numPackets;
+		/// packet buffers which had to come from the system allocator
+		unsigned long numSysAllocs;
+		/// payload bytes copied (into new packets and into datagrams)
+		unsigned long bytesCopied;
+	};
+	static Stats GetStats();
+	static void ResetStats();
+	/// account for bytes copied outside of RawPacket
+	static void AddBytesCopied(const unsigned bytes);
+
 private:
-	
+	static unsigned char* AllocData(const unsigned length, const unsigned copied);
+	static void FreeData(unsigned char* data, const unsigned length);
 };
 
 } // namespace netcode
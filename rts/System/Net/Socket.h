@@ -48,6 +48,9 @@ public:
 
 	void Bind(unsigned short port /** in host byte order */) const;
 
+	/// the native socket handle (for poll()/epoll() loops which watch more than one socket)
+	int GetFD() const { return (int)mySocket; }
+
 	/**
 	@brief Resolves a host
 	@param address The host's address, can be an IP-Address or an Hostname
@@ -0,0 +1,129 @@
+#include "StreamCompression.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include "mmgr.h"
+
+#include "Exception.h"
+
+namespace netcode
+{
+
+namespace
+{
+
+/**
+Preset dictionary for both directions. zlib favours the end of the dictionary,
+so the most frequent content (frame and command message headers, float and
+int patterns) comes last. Changing this breaks compatibility between builds,
+like any other protocol change.
+*/
+const unsigned char dictionary[] =
+	// system and chat texts
+	"Player  left the game (normal quit) timeout kicked "
+	"Connection attempt rejected Sync error for  in frame  correct is "
+	"Speed set to  by  Pausing Game paused Game unpaused "
+	// LuaMsg and command strings
+	"LuaRules LuaUI LuaGaia gadget widget "
+	"\x32\x00\x00\x00\x00\x00\x00"
+	// NETMSG_PLAYERINFO, NETMSG_CPU_USAGE
+	"\x26\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+	"\x15\x00\x00\x00\x00"
+	// NETMSG_COMMAND / NETMSG_AICOMMAND with a few float params
+	"\x0b\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+	"\x0e\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+	"\x00\x00\x80\x3f\x00\x00\x00\x00\x00\x00\x80\xbf"
+	// NETMSG_KEYFRAME, NETMSG_SYNCREQUEST and NETMSG_NEWFRAME runs
+	"\x01\x00\x00\x00\x00\x20\x00\x00\x00\x00"
+	"\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02";
+
+}
+
+StreamCompressor::StreamCompressor()
+{
+	stream = new z_stream;
+	memset(stream, 0, sizeof(z_stream));
+	if (deflateInit(stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+		throw network_error("Failed to initialise stream compression");
+	deflateSetDictionary(stream, dictionary, sizeof(dictionary) - 1);
+}
+
+StreamCompressor::~StreamCompressor()
+{
+	deflateEnd(stream);
+	delete stream;
+}
+
+void StreamCompressor::Compress(const unsigned char* data, const unsigned length, std::vector<unsigned char>& out)
+{
+	stream->next_in = const_cast<unsigned char*>(data);
+	stream->avail_in = length;
+
+	do
+	{
+		const unsigned oldSize = out.size();
+		const unsigned room = deflateBound(stream, stream->avail_in) + 16;
+		out.resize(oldSize + room);
+		stream->next_out = &out[oldSize];
+		stream->avail_out = room;
+		deflate(stream, Z_SYNC_FLUSH);
+		out.resize(oldSize + room - stream->avail_out);
+	} while (stream->avail_out == 0);
+}
+
+StreamDecompressor::StreamDecompressor()
+{
+	stream = new z_stream;
+	memset(stream, 0, sizeof(z_stream));
+	if (inflateInit(stream) != Z_OK)
+		throw network_error("Failed to initialise stream decompression");
+}
+
+StreamDecompressor::~StreamDecompressor()
+{
+	inflateEnd(stream);
+	delete stream;
+}
+
+void StreamDecompressor::Decompress(const unsigned char* data, const unsigned length, std::vector<unsigned char>& out, const unsigned maxLength)
+{
+	stream->next_in = const_cast<unsigned char*>(data);
+	stream->avail_in = length;
+	const unsigned oldSize = out.size();
+
+	unsigned char buffer[4096];
+	while (stream->avail_in > 0)
+	{
+		stream->next_out = buffer;
+		stream->avail_out = sizeof(buffer);
+		int ret = inflate(stream, Z_SYNC_FLUSH);
+		if (ret == Z_NEED_DICT)
+		{
+			inflateSetDictionary(stream, dictionary, sizeof(dictionary) - 1);
+			ret = inflate(stream, Z_SYNC_FLUSH);
+		}
+		if (ret != Z_OK && ret != Z_BUF_ERROR)
+			throw network_error("Corrupt compressed stream");
+		out.insert(out.end(), buffer, buffer + (sizeof(buffer) - stream->avail_out));
+		if (out.size() - oldSize > maxLength)
+			throw network_error("Compressed stream inflates too much");
+		if (ret == Z_BUF_ERROR && stream->avail_out == sizeof(buffer))
+			break; // no progress possible
+	}
+	// flush pending output of the last call
+	for (;;)
+	{
+		stream->next_out = buffer;
+		stream->avail_out = sizeof(buffer);
+		const int ret = inflate(stream, Z_SYNC_FLUSH);
+		const unsigned produced = sizeof(buffer) - stream->avail_out;
+		out.insert(out.end(), buffer, buffer + produced);
+		if (out.size() - oldSize > maxLength)
+			throw network_error("Compressed stream inflates too much");
+		if (produced == 0 || (ret != Z_OK && ret != Z_BUF_ERROR))
+			break;
+	}
+}
+
+} // namespace netcode
@@ -0,0 +1,55 @@
+#ifndef STREAMCOMPRESSION_H
+#define STREAMCOMPRESSION_H
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+typedef struct z_stream_s z_stream;
+
+namespace netcode
+{
+
+/**
+@brief deflate side of a compressed connection stream
+One instance per connection direction: the compression state carries over from
+one batch to the next, so repeated messages (NEWFRAME, commands, LuaMsg
+prefixes) shrink to a few bits. The stream is primed with a dictionary of
+typical Spring protocol content so even the first batches compress.
+*/
+class StreamCompressor : boost::noncopyable
+{
+public:
+	StreamCompressor();
+	~StreamCompressor();
+
+	/**
+	@brief compress a batch and append it to out
+	The output is flushed, the peer can decode the whole batch from it.
+	*/
+	void Compress(const unsigned char* data, const unsigned length, std::vector<unsigned char>& out);
+
+private:
+	z_stream* stream;
+};
+
+/// inflate side, must see the compressed batches in the order they were made
+class StreamDecompressor : boost::noncopyable
+{
+public:
+	StreamDecompressor();
+	~StreamDecompressor();
+
+	/**
+	@brief decompress a (part of a) batch and append it to out
+	@param maxLength most bytes this part may inflate to
+	@throw network_error when the stream is corrupt or inflates to more than maxLength
+	*/
+	void Decompress(const unsigned char* data, const unsigned length, std::vector<unsigned char>& out, const unsigned maxLength);
+
+private:
+	z_stream* stream;
+};
+
+} // namespace netcode
+
+#endif
@@ -0,0 +1,27 @@
+/**
+@file LogOutputStub.cpp
+@brief logOutput for the tests, which link the netcode without the engine
+
+Prints to stdout instead of infolog.txt.
+*/
+
+#include <stdio.h>
+#include "LogOutput.h"
+
+CLogOutput logOutput;
+
+CLogOutput::CLogOutput()
+{
+}
+
+CLogOutput::~CLogOutput()
+{
+}
+
+void CLogOutput::Print(const char* fmt, ...)
+{
+	va_list argp;
+	va_start(argp, fmt);
+	vprintf(fmt, argp);
+	va_end(argp);
+}
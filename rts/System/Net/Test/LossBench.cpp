@@ -0,0 +1,168 @@
+/**
+@file LossBench.cpp
+@brief Goodput and latency of UDPConnection over a lossy loopback link
+
+The client socket drops a deterministic share of the datagrams in both
+directions (LossySocket), the server sends one message per frame and the
+client answers every frame, like in a game. For each loss rate the delivered
+messages, their latency and the resend count are reported. Without loss
+every message has to arrive and nothing may be resent, else the exit code
+is 1.
+
+usage: LossBench [seconds] [lossPercent ...]
+*/
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL_timer.h>
+#include <boost/shared_ptr.hpp>
+
+#include "UDPListener.h"
+#include "UDPConnection.h"
+#include "UDPSocket.h"
+#include "PackPacket.h"
+#include "ProtocolDef.h"
+
+using namespace netcode;
+
+static const unsigned char MSG_DATA = 12;
+static const unsigned messageLength = 64;
+static const unsigned frameTime = 10;
+
+/// drops datagrams on their way in and out, the same ones for every run
+class LossySocket : public UDPSocket
+{
+public:
+	LossySocket() : UDPSocket(0), lossPercent(0), lossRand(1) {}
+
+	void SetLoss(unsigned percent) { lossPercent = percent; }
+
+	unsigned RecvBatch()
+	{
+		const unsigned numRecv = UDPSocket::RecvBatch();
+		unsigned kept = 0;
+		for (unsigned i = 0; i < numRecv; ++i)
+		{
+			if (Drop())
+				continue;
+			if (kept != i)
+			{
+				memcpy(&recvBuffer[kept * maxDatagramSize], &recvBuffer[i * maxDatagramSize], recvLengths[i]);
+				recvLengths[kept] = recvLengths[i];
+				recvAddrs[kept] = recvAddrs[i];
+			}
+			++kept;
+		}
+		return kept;
+	}
+
+	using UDPSocket::QueueSendTo;
+	void QueueSendTo(const unsigned char* const header, const unsigned headerLength, const unsigned char* const buf, const unsigned dataLength, const sockaddr_in* const destination)
+	{
+		if (!Drop())
+			UDPSocket::QueueSendTo(header, headerLength, buf, dataLength, destination);
+	}
+
+private:
+	bool Drop()
+	{
+		// LCG from the C standard
+		lossRand = lossRand * 1103515245 + 12345;
+		return ((lossRand >> 16) % 100) < lossPercent;
+	}
+
+	unsigned lossPercent;
+	unsigned lossRand;
+};
+
+static bool Run(int port, unsigned loss, unsigned seconds)
+{
+	UDPListener server(port);
+	LossySocket* lossy = new LossySocket();
+	boost::shared_ptr<UDPSocket> sock(lossy);
+	boost::shared_ptr<UDPConnection> client(new UDPConnection(sock, "127.0.0.1", port));
+	client->SendData(boost::shared_ptr<const RawPacket>(new PackPacket(messageLength, MSG_DATA)));
+	client->Flush(true);
+
+	boost::shared_ptr<UDPConnection> link;
+	while (!link)
+	{
+		server.Update();
+		if (server.HasIncomingConnections())
+		{
+			link = server.AcceptConnection();
+			link->GetData();
+		}
+	}
+	lossy->SetLoss(loss);
+	unsigned sent = 0, delivered = 0;
+	unsigned long latencySum = 0;
+	unsigned maxLatency = 0;
+	const unsigned startTime = SDL_GetTicks();
+	const unsigned endTime = startTime + seconds * 1000;
+	unsigned nextFrame = startTime;
+	// keep running a bit after the last send so late resends can arrive
+	while (SDL_GetTicks() < endTime + 2000)
+	{
+		const unsigned now = SDL_GetTicks();
+		if (now >= nextFrame && now < endTime)
+		{
+			PackPacket* msg = new PackPacket(messageLength, MSG_DATA);
+			*msg << now;
+			link->SendData(boost::shared_ptr<const RawPacket>(msg));
+			link->Flush(true);
+			client->SendData(boost::shared_ptr<const RawPacket>(new PackPacket(messageLength, MSG_DATA)));
+			client->Flush(true);
+			++sent;
+			nextFrame += frameTime;
+		}
+
+		server.Update();
+		while (link->GetData()) {}
+		client->Update();
+		boost::shared_ptr<const RawPacket> packet;
+		while ((packet = client->GetData()))
+		{
+			const unsigned latency = SDL_GetTicks() - *(unsigned*)(packet->data + 1);
+			latencySum += latency;
+			maxLatency = std::max(maxLatency, latency);
+			++delivered;
+		}
+		SDL_Delay(1);
+	}
+
+	std::cout << loss << "% loss: " << delivered << "/" << sent << " delivered, goodput "
+		<< (delivered * messageLength) / seconds << " B/s, latency avg "
+		<< (delivered ? latencySum / delivered : 0) << " ms max " << maxLatency << " ms, "
+		<< link->GetResentPackets() << " resent, RTT " << link->GetRTT() << " ms RTO " << link->GetRTO() << " ms" << std::endl;
+
+	if (loss == 0 && (delivered != sent || link->GetResentPackets() != 0 || client->GetResentPackets() != 0))
+	{
+		std::cout << "FAILED: lost or resent packets without loss (" << client->GetResentPackets() << " resent by the client)" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned seconds = (argc > 1) ? atoi(argv[1]) : 5;
+	std::vector<unsigned> losses;
+	for (int i = 2; i < argc; ++i)
+		losses.push_back(atoi(argv[i]));
+	if (losses.empty())
+	{
+		losses.push_back(0);
+		losses.push_back(1);
+		losses.push_back(5);
+		losses.push_back(10);
+	}
+
+	ProtocolDef::instance()->AddType(MSG_DATA, messageLength);
+	bool ok = true;
+	for (unsigned i = 0; i < losses.size(); ++i)
+		ok = Run(5030 + i, losses[i], seconds) && ok;
+	return ok ? 0 : 1;
+}
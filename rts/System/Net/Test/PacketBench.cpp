@@ -0,0 +1,96 @@
+/**
+@file PacketBench.cpp
+@brief Packet allocations and bytes copied per server frame
+
+A UDPListener broadcasts a NEWFRAME-sized and a command-sized message to N
+loopback clients every frame, like CGameServer::Broadcast does, and reports
+the RawPacket counters per frame.
+
+usage: PacketBench [numClients] [numFrames] [compress]
+*/
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <boost/shared_ptr.hpp>
+
+#include "UDPListener.h"
+#include "UDPConnection.h"
+#include "UDPSocket.h"
+#include "PackPacket.h"
+#include "ProtocolDef.h"
+
+using namespace netcode;
+
+static const int serverPort = 5020;
+static const unsigned char MSG_FRAME = 2;
+static const unsigned char MSG_COMMAND = 11;
+static const unsigned commandLength = 40;
+
+int main(int argc, char* argv[])
+{
+	const unsigned numClients = (argc > 1) ? atoi(argv[1]) : 16;
+	const unsigned numFrames = (argc > 2) ? atoi(argv[2]) : 1000;
+	const bool compress = (argc > 3) && atoi(argv[3]);
+
+	ProtocolDef::instance()->AddType(MSG_FRAME, 1);
+	ProtocolDef::instance()->AddType(MSG_COMMAND, commandLength);
+
+	UDPListener server(serverPort);
+	server.SetCompression(compress);
+	std::vector< boost::shared_ptr<UDPConnection> > clients;
+	std::vector< boost::shared_ptr<UDPConnection> > links;
+	for (unsigned i = 0; i < numClients; ++i)
+	{
+		boost::shared_ptr<UDPSocket> sock(new UDPSocket(0));
+		boost::shared_ptr<UDPConnection> client(new UDPConnection(sock, "127.0.0.1", serverPort));
+		client->SetCompression(compress);
+		client->SendData(boost::shared_ptr<const RawPacket>(new PackPacket(1, MSG_FRAME)));
+		client->Flush(true);
+		clients.push_back(client);
+	}
+	while (links.size() < numClients)
+	{
+		server.Update();
+		while (server.HasIncomingConnections())
+		{
+			links.push_back(server.AcceptConnection());
+			links.back()->GetData();
+		}
+	}
+	std::cout << numClients << " clients connected" << std::endl;
+
+	unsigned long received = 0;
+	RawPacket::ResetStats();
+	for (unsigned frame = 0; frame < numFrames; ++frame)
+	{
+		// serialized once, referenced by every link's send queue
+		boost::shared_ptr<const RawPacket> newFrame(new PackPacket(1, MSG_FRAME));
+		PackPacket* command = new PackPacket(commandLength, MSG_COMMAND);
+		for (unsigned b = 1; b < commandLength; ++b)
+			*command << (unsigned char)frame;
+		boost::shared_ptr<const RawPacket> commandPacket(command);
+
+		for (unsigned i = 0; i < links.size(); ++i)
+		{
+			links[i]->SendData(newFrame);
+			links[i]->SendData(commandPacket);
+			links[i]->Flush(true);
+		}
+		server.Update(); // acks
+		for (unsigned i = 0; i < clients.size(); ++i)
+		{
+			clients[i]->Update();
+			while (clients[i]->GetData())
+				++received;
+		}
+	}
+	const RawPacket::Stats stats = RawPacket::GetStats();
+
+	std::cout << numFrames << " frames, " << received << " messages received" << std::endl;
+	std::cout << "per frame: " << (double)stats.numPackets / numFrames << " packet allocations, "
+		<< (double)stats.numSysAllocs / numFrames << " system allocations, "
+		<< (double)stats.bytesCopied / numFrames << " bytes copied" << std::endl;
+	std::cout << links[0]->Statistics();
+	return 0;
+}
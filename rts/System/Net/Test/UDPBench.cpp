@@ -0,0 +1,86 @@
+/**
+@file UDPBench.cpp
+@brief Loopback throughput of UDPSocket, one datagram per syscall vs. batched
+
+usage: UDPBench [numDatagrams] [datagramSize]
+*/
+
+#include <iostream>
+#include <stdlib.h>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "UDPSocket.h"
+
+using netcode::UDPSocket;
+
+static const int senderPort = 5010;
+static const int receiverPort = 5011;
+
+static double Now()
+{
+	using namespace boost::posix_time;
+	static const ptime start = microsec_clock::universal_time();
+	return (microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+/// send numDatagrams, return how many arrived (the socket buffer may overflow)
+static unsigned Run(bool batched, unsigned numDatagrams, unsigned size)
+{
+	UDPSocket sender(senderPort);
+	UDPSocket receiver(receiverPort);
+	const sockaddr_in dest = sender.ResolveHost("127.0.0.1", receiverPort);
+
+	unsigned char* payload = new unsigned char[size];
+	for (unsigned i = 0; i < size; ++i)
+		payload[i] = (unsigned char)i;
+	unsigned char buffer[4096];
+	sockaddr_in from;
+
+	unsigned received = 0;
+	const double startTime = Now();
+	for (unsigned sent = 0; sent < numDatagrams; )
+	{
+		// send a burst which fits into the socket buffers, then drain them
+		const unsigned burst = std::min(numDatagrams - sent, 256u);
+		for (unsigned i = 0; i < burst; ++i)
+		{
+			if (batched)
+				sender.QueueSendTo(payload, size, &dest);
+			else
+				sender.SendTo(payload, size, &dest);
+		}
+		if (batched)
+			sender.SendBatch();
+		sent += burst;
+
+		if (batched)
+		{
+			unsigned num;
+			while ((num = receiver.RecvBatch()) > 0)
+				received += num;
+		}
+		else
+		{
+			while (receiver.RecvFrom(buffer, 4096, &from) > 0)
+				++received;
+		}
+	}
+	const double seconds = Now() - startTime;
+
+	std::cout << (batched ? "batched:    " : "one by one: ") << received << "/" << numDatagrams
+		<< " datagrams of " << size << " bytes in " << seconds << "s, "
+		<< (unsigned)(received / seconds) << " datagrams/s" << std::endl;
+	delete[] payload;
+	return received;
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned numDatagrams = (argc > 1) ? atoi(argv[1]) : 200000;
+	const unsigned size = (argc > 2) ? atoi(argv[2]) : 100;
+
+	Run(false, numDatagrams, size);
+	Run(true, numDatagrams, size);
+	return 0;
+}
@@ -5,6 +5,8 @@
 #include <boost/ptr_container/ptr_map.hpp>
 #include <boost/shared_ptr.hpp>
 #include <deque>
+#include <algorithm>
+#include <cmath>
 
 #ifdef _WIN32
  #include "Platform/Win/win32.h"
@@ -19,14 +21,31 @@
 
 #include "ProtocolDef.h"
 #include "Exception.h"
+#include "LogOutput.h"
 #include <boost/cstdint.hpp>
 
 namespace netcode {
 
 
-const unsigned UDPConnection::hsize = 9;
+const unsigned UDPConnection::hsize = 14;
 const unsigned UDPMaxPacketSize = 4096;
 
+/// retransmission timeout bounds and the value used until the first RTT sample (ms)
+const unsigned minRTO = 100;
+const unsigned maxRTO = 3000;
+const unsigned initialRTO = 500;
+/// never resend more than this many packets at once, the rest follows in the next Update()
+const unsigned maxResendBurst = 8;
+/// acks for new data go out at most this late, even if we have nothing to send (ms)
+const unsigned maxAckDelay = 40;
+/// packet number of datagrams which only carry the header (acks), they are not acked themselves
+const int ackOnlyNum = -1;
+/// batches smaller than this are not worth the deflate flush overhead
+const unsigned minCompressLength = 24;
+/// longest message the protocol can describe (short length), batches are
+/// compressed in pieces of this size so no datagram may inflate to more
+const unsigned maxInflatedLength = 32767;
+
 UDPConnection::UDPConnection(boost::shared_ptr<UDPSocket> NetSocket, const sockaddr_in& MyAddr) : mySocket(NetSocket)
 {
 	sharedSocket = true;
@@ -88,16 +107,15 @@ void UDPConnection::Update()
 {
 	if (!sharedSocket)
 	{
-		unsigned recv = 0;
-		unsigned char buffer[UDPMaxPacketSize];
-		sockaddr_in fromAddr;
-		while ((recv = mySocket->RecvFrom(buffer, UDPMaxPacketSize, &fromAddr)) >= hsize)
+		unsigned numRecv;
+		while ((numRecv = mySocket->RecvBatch()) > 0)
 		{
-			RawPacket* data = new RawPacket(buffer, recv);
-			if (CheckAddress(fromAddr))
-				ProcessRawPacket(data);
-			else
-				; // silently drop
+			for (unsigned n = 0; n < numRecv; ++n)
+			{
+				if (IsValidHeader(mySocket->GetBatchData(n), mySocket->GetBatchLength(n)) && CheckAddress(mySocket->GetBatchSender(n)))
+					ProcessRawPacket(new RawPacket(mySocket->GetBatchData(n), mySocket->GetBatchLength(n)));
+				// else silently drop
+			}
 		}
 	}
 	
@@ -105,10 +123,14 @@ void UDPConnection::Update()
 	bool force = false;	// should we force to send a packet?
 
 	if((dataRecv == 0) && lastSendTime < curTime-1000 && !unackedPackets.empty()){		//server hasnt responded so try to send the connection attempt again
-		SendRawPacket(unackedPackets[0].data,unackedPackets[0].length,0);
+		SendRawPacket(unackedPackets[0].data,unackedPackets[0].length,0,unackedInfo[0].compressed);
 		lastSendTime = curTime;
 		force = true;
 	}
+	else if (dataRecv != 0)
+	{
+		ResendTimedOut(curTime);
+	}
 
 	if (lastSendTime<curTime-5000 && !(dataRecv == 0)) { //we havent sent anything for a while so send something to prevent timeout
 		force = true;
@@ -116,12 +138,23 @@ void UDPConnection::Update()
 	else if(lastSendTime<curTime-200 && !waitingPackets.empty()){	//we have at least one missing incomming packet lying around so send a packet to ensure the other side get a nak
 		force = true;
 	}
+	else if (ackPending) { // the other side resends, so it didn't see our ack
+		force = true;
+	}
+	else if (ackDue && ackDueTime <= curTime) { // we got data, but have nothing to send the ack with
+		force = true;
+	}
 
 	Flush(force);
 }
 
 void UDPConnection::ProcessRawPacket(RawPacket* packet)
 {
+	if (broken)
+	{
+		delete packet;
+		return;
+	}
 	lastReceiveTime=SDL_GetTicks();
 	dataRecv += packet->length;
 	recvOverhead += hsize;
@@ -130,38 +163,77 @@ void UDPConnection::ProcessRawPacket(RawPacket* packet)
 	int packetNum = *(int*)packet->data;
 	int ack = *(int*)(packet->data+4);
 	unsigned char nak = packet->data[8];
+	const unsigned char flags = packet->data[9];
+	unsigned sack = *(unsigned*)(packet->data+10);
+	if (flags & FLAG_ACCEPTS_COMPRESSED)
+		peerAcceptsCompressed = true;
 
 	AckPackets(ack);
 
 	if (nak > 0)	// we have lost $nak packets
 	{
-		int nak_abs = nak + firstUnacked - 1;
-		if (nak_abs >= currentNum)
+		// the other side has ack+nak+1 and the ones flagged in sack, anything
+		// unacked below the highest of them was lost (or is still underway)
+		// (nak is capped at 255, then ack+nak+1 may be missing too)
+		int highestRecv = (nak < 255) ? (ack + nak + 1) : ack;
+		for (int bit = 0; bit < 32; ++bit)
+		{
+			if (sack & (1u << bit))
+			{
+				SackPacket(ack + 2 + bit);
+				highestRecv = std::max(highestRecv, ack + 2 + bit);
+			}
+		}
+		if (nak < 255)
+			SackPacket(ack + nak + 1);
+
+		if (highestRecv >= currentNum)
 		{
 			// we got a nak for packets which never got sent
 			//TODO give error message
 		}
-		else if (nak_abs != lastNak || lastNakTime < lastReceiveTime-100)
+		else
 		{
-			// resend all packets from firstUnacked till nak_abs
-			lastNak=nak_abs;
-			lastNakTime=lastReceiveTime;
-			for (int b = firstUnacked; b <= nak_abs; ++b)
+			// fast retransmit, but resend each hole at most once per RTT
+			const unsigned resendInterval = std::max((unsigned)srtt, 10u);
+			unsigned burst = 0;
+			for (int b = firstUnacked; b < highestRecv && burst < maxResendBurst; ++b)
 			{
-				SendRawPacket(unackedPackets[b-firstUnacked].data,unackedPackets[b-firstUnacked].length,b);
-				++resentPackets;
+				const SentPacketInfo& info = unackedInfo[b-firstUnacked];
+				if (!info.sacked && info.lastSendTime + resendInterval <= lastReceiveTime)
+				{
+					ResendPacket(b, lastReceiveTime);
+					++burst;
+				}
 			}
 		}
 	}
 
+	if (packetNum == ackOnlyNum)
+	{
+		delete packet;
+		return;
+	}
+
 	if (lastInOrder >= packetNum || waitingPackets.find(packetNum) != waitingPackets.end())
 	{
 		++droppedPackets;
+		ackPending = true;
 		delete packet;
 		return;
 	}
 
-	waitingPackets.insert(packetNum, new RawPacket(packet->data + hsize, packet->length - hsize));
+	if (!ackDue)
+	{
+		ackDue = true;
+		ackDueTime = lastReceiveTime + maxAckDelay;
+	}
+
+	// keep the flags byte in front of the payload
+	RawPacket* payload = new RawPacket(packet->length - hsize + 1);
+	payload->data[0] = flags;
+	memcpy(payload->data + 1, packet->data + hsize, packet->length - hsize);
+	waitingPackets.insert(packetNum, payload);
 	delete packet;
 	packet = NULL;
 
@@ -180,7 +252,32 @@ void UDPConnection::ProcessRawPacket(RawPacket* packet)
 		}
 
 		lastInOrder++;
-		std::copy(wpi->second->data, wpi->second->data+wpi->second->length, std::back_inserter(buf));
+		const RawPacket& payload = *wpi->second;
+		const unsigned oldSize = buf.size();
+		if (payload.data[0] & FLAG_COMPRESSED)
+		{
+			// we only told the other side we can inflate if we compress ourselves
+			if (!compressOutgoing)
+			{
+				Break("got compressed data without asking for it");
+				return;
+			}
+			if (!decompressor)
+				decompressor.reset(new StreamDecompressor());
+			try
+			{
+				decompressor->Decompress(payload.data+1, payload.length-1, buf, maxInflatedLength);
+			}
+			catch (network_error& e)
+			{
+				Break(e.what());
+				return;
+			}
+		}
+		else
+			std::copy(payload.data+1, payload.data+payload.length, std::back_inserter(buf));
+		wireBytesRecv += payload.length-1;
+		rawBytesRecv += buf.size() - oldSize;
 		waitingPackets.erase(wpi);
 
 		for (unsigned pos = 0; pos < buf.size();)
@@ -220,7 +317,11 @@ void UDPConnection::ProcessRawPacket(RawPacket* packet)
 				}
 
 				// if this isn't true we'll loop infinitely while filling up memory
-				assert(msglength != 0);
+				if (msglength == 0)
+				{
+					Break(str(boost::format("message %1% with length 0") %(unsigned)(unsigned char)msgid));
+					return;
+				}
 
 				// got the complete message in the buffer?
 				if (buf.size() >= pos + msglength)
@@ -252,44 +353,114 @@ void UDPConnection::Flush(const bool forced)
 	unsigned outgoingLength = 0;
 	for (packetList::const_iterator it = outgoingData.begin(); it != outgoingData.end(); ++it)
 		outgoingLength += (*it)->length;
+	outgoingLength -= outgoingOffset;
 
-	if (forced || (!outgoingData.empty() && (lastSendTime < (curTime - 200 + outgoingLength * 10))))
+	if (forced && outgoingData.empty())
+	{
+		// only tell the other side what we got
+		lastSendTime = curTime;
+		SendRawPacket(NULL, 0, ackOnlyNum, false);
+	}
+	else if (forced || (!outgoingData.empty() && (lastSendTime < (curTime - 200 + outgoingLength * 10))))
 	{
 		lastSendTime=SDL_GetTicks();
 
-		boost::uint8_t buffer[UDPMaxPacketSize];
-		unsigned pos = 0;
 		// Manually fragment packets to respect configured UDP_MTU.
 		// This is an attempt to fix the bug where players drop out of the game if
 		// someone in the game gives a large order.
 
+		const bool compressed = compressOutgoing && peerAcceptsCompressed && outgoingLength >= minCompressLength;
 		do
 		{
-			if (!outgoingData.empty())
+			// bytes of the datagrams of this piece of the batch
+			unsigned pieceLength = outgoingLength;
+			std::vector<unsigned char> zbuf;
+			if (compressed)
 			{
-				packetList::iterator it = outgoingData.begin();
-				unsigned numBytes = std::min(mtu-pos, (*it)->length);
-				memcpy(buffer+pos, (*it)->data, numBytes);
-				pos+= numBytes;
-				if (numBytes == (*it)->length) // full packet copied
-					outgoingData.pop_front();
-				else // partially transfered
-					(*it).reset(new RawPacket((*it)->data + numBytes, (*it)->length - numBytes));
-			} // iterator "it" is now invalid
-			if ((forced || pos > 0) && (pos == mtu || outgoingData.empty()))
+				// every piece is flushed on its own, so none of its datagrams
+				// inflates to more than maxInflatedLength at the other end
+				std::vector<unsigned char> raw;
+				raw.reserve(std::min(outgoingLength, maxInflatedLength));
+				while (!outgoingData.empty() && raw.size() < maxInflatedLength)
+				{
+					const RawPacket& front = *outgoingData.front();
+					const unsigned chunk = std::min(maxInflatedLength - (unsigned)raw.size(), front.length - outgoingOffset);
+					raw.insert(raw.end(), front.data + outgoingOffset, front.data + outgoingOffset + chunk);
+					outgoingOffset += chunk;
+					if (outgoingOffset == front.length)
+					{
+						outgoingData.pop_front();
+						outgoingOffset = 0;
+					}
+				}
+				if (!compressor)
+					compressor.reset(new StreamCompressor());
+				compressor->Compress(&raw[0], raw.size(), zbuf);
+				RawPacket::AddBytesCopied(raw.size());
+				rawBytesSent += raw.size();
+				wireBytesSent += zbuf.size();
+				outgoingLength -= raw.size();
+				pieceLength = zbuf.size();
+			}
+			else
 			{
-				if (pos == mtu)
-					++fragmentedFlushes;
-				SendRawPacket(buffer, pos, currentNum++);
-				unackedPackets.push_back(new RawPacket(buffer, pos));
-				pos = 0;
+				rawBytesSent += outgoingLength;
+				wireBytesSent += outgoingLength;
+				outgoingLength = 0;
 			}
-		} while (!outgoingData.empty());
+
+			unsigned zpos = 0;
+			do
+			{
+				// assemble the payload right in the packet we keep for resending;
+				// messages are shared with other connections (Broadcast), so the
+				// front one is only sliced by outgoingOffset, never copied
+				const unsigned numBytes = std::min(mtu, pieceLength);
+				RawPacket* packet = new RawPacket(numBytes);
+				if (compressed)
+				{
+					memcpy(packet->data, &zbuf[zpos], numBytes);
+					zpos += numBytes;
+				}
+				else
+				{
+					unsigned pos = 0;
+					while (!outgoingData.empty())
+					{
+						const RawPacket& front = *outgoingData.front();
+						const unsigned chunk = std::min(numBytes - pos, front.length - outgoingOffset);
+						if (chunk > 0)
+							memcpy(packet->data + pos, front.data + outgoingOffset, chunk);
+						pos += chunk;
+						outgoingOffset += chunk;
+						if (outgoingOffset == front.length)
+						{
+							outgoingData.pop_front();
+							outgoingOffset = 0;
+						}
+						else
+							break; // datagram is full
+					}
+				}
+				pieceLength -= numBytes;
+
+				if (numBytes == mtu)
+					++fragmentedFlushes;
+				SendRawPacket(packet->data, numBytes, currentNum++, compressed);
+				unackedPackets.push_back(packet);
+				SentPacketInfo info = {lastSendTime, lastSendTime, 1, false, compressed};
+				unackedInfo.push_back(info);
+			} while (pieceLength > 0);
+		} while (outgoingLength > 0);
 	}
+	// resends from ProcessRawPacket() and the fragments above go out in one syscall
+	mySocket->SendBatch();
 }
 
 bool UDPConnection::CheckTimeout() const
 {
+	if (broken)
+		return true;
 	const unsigned curTime = SDL_GetTicks();
 	const unsigned timeout = ((dataRecv == 0) ? 45000 : 30000);
 	if((lastReceiveTime+timeout) < curTime)
@@ -308,6 +479,8 @@ std::string UDPConnection::Statistics() const
 	msg += str( boost::format("Relative protocol overhead: %1% up, %2% down\n") %((float)sentOverhead / (float)dataSent) %((float)recvOverhead / (float)dataRecv) );
 	msg += str( boost::format("%1% incoming packets had been dropped, %2% outgoing packets had to be resent\n") %droppedPackets %resentPackets);
 	msg += str( boost::format("%1% packets were splitted due to MTU\n") %fragmentedFlushes);
+	msg += str( boost::format("Payload: %1% bytes sent as %2% bytes on the wire, %3% bytes received as %4% bytes (%5%)\n") %rawBytesSent %wireBytesSent %rawBytesRecv %wireBytesRecv %(compressOutgoing ? (peerAcceptsCompressed ? "compressing" : "peer can't inflate") : "not compressing"));
+	msg += str( boost::format("Round trip time: %1% ms (deviation %2% ms), retransmission timeout %3% ms\n") %srtt %rttvar %rto);
 	return msg;
 }
 
@@ -347,13 +520,23 @@ void UDPConnection::Init()
 	waitingPackets.clear();
 	firstUnacked=0;
 	currentNum=0;
-	lastNak=-1;
-	lastNakTime=0;
+	ackPending = false;
+	ackDue = false;
+	ackDueTime = 0;
+	srtt = 0.0f;
+	rttvar = 0.0f;
+	rto = initialRTO;
+	compressOutgoing = false;
+	peerAcceptsCompressed = false;
+	broken = false;
+	rawBytesSent = wireBytesSent = 0;
+	rawBytesRecv = wireBytesRecv = 0;
 	lastSendTime=0;
 	sentOverhead = 0;
 	recvOverhead = 0;
 	fragmentedFlushes = 0;
 	fragmentBuffer = 0;
+	outgoingOffset = 0;
 	resentPackets = 0;
 	sentPackets = recvPackets = 0;
 	droppedPackets = 0;
@@ -362,17 +545,100 @@ void UDPConnection::Init()
 
 void UDPConnection::AckPackets(const int nextAck)
 {
+	const unsigned curTime = SDL_GetTicks();
 	while (nextAck >= firstUnacked && !unackedPackets.empty()){
+		const SentPacketInfo& info = unackedInfo.front();
+		// Karn: resent packets give ambiguous samples, and sacked ones were sampled already
+		if (nextAck == firstUnacked && info.numSends == 1 && !info.sacked)
+			AddRTTSample(curTime - info.firstSendTime);
 		unackedPackets.pop_front();
+		unackedInfo.pop_front();
 		firstUnacked++;
 	}
 }
 
-void UDPConnection::SendRawPacket(const unsigned char* data, const unsigned length, const int packetNum)
+void UDPConnection::SackPacket(const int num)
+{
+	if (num < firstUnacked || num >= firstUnacked + (int)unackedInfo.size())
+		return;
+	SentPacketInfo& info = unackedInfo[num - firstUnacked];
+	if (!info.sacked)
+	{
+		info.sacked = true;
+		if (info.numSends == 1)
+			AddRTTSample(SDL_GetTicks() - info.firstSendTime);
+	}
+}
+
+void UDPConnection::ResendPacket(const int num, const unsigned curTime)
+{
+	const unsigned idx = num - firstUnacked;
+	SendRawPacket(unackedPackets[idx].data, unackedPackets[idx].length, num, unackedInfo[idx].compressed);
+	unackedInfo[idx].lastSendTime = curTime;
+	unackedInfo[idx].numSends++;
+	++resentPackets;
+}
+
+void UDPConnection::ResendTimedOut(const unsigned curTime)
+{
+	unsigned burst = 0;
+	for (unsigned idx = 0; idx < unackedInfo.size() && burst < maxResendBurst; ++idx)
+	{
+		const SentPacketInfo& info = unackedInfo[idx];
+		if (info.sacked)
+			continue;
+		// exponential backoff for packets which got lost again
+		const unsigned timeout = std::min(rto << std::min(info.numSends - 1, 3u), maxRTO);
+		if (info.lastSendTime + timeout <= curTime)
+		{
+			ResendPacket(firstUnacked + idx, curTime);
+			++burst;
+		}
+	}
+}
+
+void UDPConnection::AddRTTSample(const unsigned rtt)
+{
+	if (srtt == 0.0f && rttvar == 0.0f)
+	{
+		srtt = rtt;
+		rttvar = rtt * 0.5f;
+	}
+	else
+	{
+		rttvar = 0.75f * rttvar + 0.25f * std::fabs(srtt - rtt);
+		srtt = 0.875f * srtt + 0.125f * rtt;
+	}
+	rto = std::max(minRTO, std::min(maxRTO, (unsigned)(srtt + 4.0f * rttvar)));
+}
+
+bool UDPConnection::IsValidHeader(const unsigned char* data, const unsigned length)
+{
+	return (length >= hsize) && ((data[9] & HEADER_VERSION_MASK) == HEADER_VERSION);
+}
+
+void UDPConnection::SetCompression(bool enable)
 {
-	unsigned char* tempbuf = new unsigned char[hsize+length];
+	compressOutgoing = enable;
+}
+
+void UDPConnection::Break(const std::string& reason)
+{
+	const NetAddress peer = GetPeerName();
+	logOutput.Print("Network error: dropping connection to %u.%u.%u.%u:%u (%s)\n",
+			peer.host >> 24, (peer.host >> 16) & 0xff, (peer.host >> 8) & 0xff, peer.host & 0xff, peer.port, reason.c_str());
+	broken = true;
+	waitingPackets.clear();
+	delete fragmentBuffer;
+	fragmentBuffer = NULL;
+}
+
+void UDPConnection::SendRawPacket(const unsigned char* data, const unsigned length, const int packetNum, const bool compressed)
+{
+	unsigned char tempbuf[hsize];
 	*(int*)tempbuf = packetNum;
 	*(int*)(tempbuf+4) = lastInOrder;
+	unsigned sack = 0;
 	if(!waitingPackets.empty() && waitingPackets.find(lastInOrder+1)==waitingPackets.end()){
 		int nak = (waitingPackets.begin()->first - 1) - lastInOrder;
 		assert(nak >= 0);
@@ -380,14 +646,26 @@ void UDPConnection::SendRawPacket(const unsigned char* data, const unsigned leng
 			*(unsigned char*)(tempbuf+8) = (unsigned char)nak;
 		else
 			*(unsigned char*)(tempbuf+8) = 255;
+
+		for (packetMap::const_iterator wpi = waitingPackets.begin(); wpi != waitingPackets.end(); ++wpi)
+		{
+			const int bit = wpi->first - (lastInOrder + 2);
+			if (bit >= 32)
+				break;
+			sack |= (1u << bit);
+		}
 	}
 	else {
 		*(unsigned char*)(tempbuf+8) = 0;
 	}
-
-	memcpy(tempbuf+hsize, data, length);
-	mySocket->SendTo(tempbuf, length+hsize, &addr);
-	delete[] tempbuf;
+	tempbuf[9] = HEADER_VERSION | (compressOutgoing ? FLAG_ACCEPTS_COMPRESSED : 0) | (compressed ? FLAG_COMPRESSED : 0);
+	*(unsigned*)(tempbuf+10) = sack;
+	ackPending = false;
+	ackDue = false;
+
+	// header and payload are gathered straight into the socket's send ring
+	mySocket->QueueSendTo(tempbuf, hsize, data, length, &addr);
+	RawPacket::AddBytesCopied(length + hsize);
 
 	dataSent += length;
 	sentOverhead += hsize;
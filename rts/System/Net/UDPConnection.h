@@ -7,8 +7,11 @@
 #include <deque>
 #include <list>
 
+#include <boost/scoped_ptr.hpp>
+
 #include "Connection.h"
 #include "UDPSocket.h"
+#include "StreamCompression.h"
 
 namespace netcode {
 
@@ -17,6 +20,10 @@ How Spring protocolheader looks like (size in bytes):
 4 (int): number of packet (continuous)
 4 (int):	last in order (tell the client we recieved all packages with packetNumber less or equal)
 1 (unsigned char): nak (we missed x packets, starting with firstUnacked)
+1 (unsigned char): header version (upper 4 bits, see IsValidHeader) and flags (FLAG_COMPRESSED: payload is part of the deflate stream, FLAG_ACCEPTS_COMPRESSED: sender compresses too and can inflate)
+4 (unsigned): sack (bit i set: we have packet lastInOrder+2+i, so the sender only resends the holes)
+
+Datagrams with packet number -1 only carry the header (acks) and are not acked themselves.
 
 */
 
@@ -71,8 +78,29 @@ public:
 	
 	void SetMTU(unsigned mtu);
 
+	/// smoothed round trip time in ms (0 until the first sample)
+	unsigned GetRTT() const { return (unsigned)srtt; }
+	/// current retransmission timeout in ms
+	unsigned GetRTO() const { return rto; }
+	unsigned GetResentPackets() const { return resentPackets; }
+	/// everything we sent so far arrived at the other end
+	bool IsDrained() const { return outgoingData.empty() && unackedPackets.empty(); }
+
+	/**
+	@brief compress what we send (once the other side told us it can inflate)
+	Batches flushed together are compressed as one, small ones are sent as they are.
+	We only accept compressed data when this is enabled on both sides.
+	*/
+	void SetCompression(bool enable);
+
 	/// The size of the protocol-header (Packets smaller than this get rejected)
 	static const unsigned hsize;
+	/**
+	@brief the datagram is long enough and has our header version
+	Checked before anything else in the header is read, so datagrams of other
+	spring versions can not mess up a connection.
+	*/
+	static bool IsValidHeader(const unsigned char* data, const unsigned length);
 
 private:
 	void Init();
@@ -84,8 +112,27 @@ private:
 	typedef std::list< boost::shared_ptr<const RawPacket> > packetList;
 	/// all packets with number <= nextAck arrived at the other end
 	void AckPackets(const int nextAck);
+	/// the other end has packet num (out of order)
+	void SackPacket(const int num);
+	enum HeaderFlags
+	{
+		FLAG_COMPRESSED = 1,
+		FLAG_ACCEPTS_COMPRESSED = 2,
+		/// change this whenever the header changes; the old 9 byte header had the
+		/// first message id (always below 0x40) in this byte, so it never matches
+		HEADER_VERSION = 0x80,
+		HEADER_VERSION_MASK = 0xf0
+	};
+
+	/// resend unacked packet num
+	void ResendPacket(const int num, const unsigned curTime);
+	/// resend packets whose retransmission timeout expired
+	void ResendTimedOut(const unsigned curTime);
+	void AddRTTSample(const unsigned rtt);
+	/// the other side sent garbage, ignore it from now on and time out
+	void Break(const std::string& reason);
 	/// add header to data and send it
-	void SendRawPacket(const unsigned char* data, const unsigned length, const int packetNum);
+	void SendRawPacket(const unsigned char* data, const unsigned length, const int packetNum, const bool compressed);
 	/// address of the other end
 	sockaddr_in addr;
 
@@ -96,17 +143,49 @@ private:
 
 	///outgoing stuff (pure data without header) waiting to be sended
 	packetList outgoingData;
+	/// bytes of outgoingData.front() which already went out in an earlier datagram
+	unsigned outgoingOffset;
 
 	/// packets the other side didn't ack'ed until now
 	boost::ptr_deque<RawPacket> unackedPackets;
+	struct SentPacketInfo
+	{
+		unsigned firstSendTime;
+		unsigned lastSendTime;
+		unsigned numSends;
+		/// the other side has it, but not all packets before it
+		bool sacked;
+		/// payload is part of the deflate stream
+		bool compressed;
+	};
+	/// timing of unackedPackets (same indices)
+	std::deque<SentPacketInfo> unackedInfo;
 	int firstUnacked;
 	int currentNum;
 
 	/// packets we have recieved but not yet read
 	packetMap waitingPackets;
 	int lastInOrder;
-	int lastNak;
-	unsigned lastNakTime;
+	/// got a duplicate (our ack was lost or is late), ack in the next Update()
+	bool ackPending;
+	/// got new data and didn't send anything since, ack at ackDueTime
+	bool ackDue;
+	unsigned ackDueTime;
+
+	/// RTT estimation (RFC 2988 style), all in ms
+	float srtt;
+	float rttvar;
+	unsigned rto;
+
+	bool compressOutgoing;
+	bool peerAcceptsCompressed;
+	boost::scoped_ptr<StreamCompressor> compressor;
+	boost::scoped_ptr<StreamDecompressor> decompressor;
+	/// see Break()
+	bool broken;
+	/// payload bytes before compression / on the wire
+	unsigned long rawBytesSent, wireBytesSent;
+	unsigned long rawBytesRecv, wireBytesRecv;
 	std::deque< boost::shared_ptr<const RawPacket> > msgQueue;
 
 	/** Our socket.
@@ -23,6 +23,7 @@ UDPListener::UDPListener(int port)
 	boost::shared_ptr<UDPSocket> temp(new UDPSocket(port));
 	mySocket = temp;
 	acceptNewConnections = true;
+	compressNewConnections = false;
 }
 
 UDPListener::~UDPListener()
@@ -39,45 +40,51 @@ void UDPListener::Update()
 			++i;
 	}
 
-	unsigned char buffer[4096];
-	sockaddr_in fromAddr;
-	unsigned recieved;
-	while ((recieved = mySocket->RecvFrom(buffer, 4096, &fromAddr)) >= UDPConnection::hsize)
+	unsigned numRecieved;
+	while ((numRecieved = mySocket->RecvBatch()) > 0)
 	{
-		RawPacket* data = new RawPacket(buffer, recieved);
-
-		for (std::list< boost::weak_ptr<UDPConnection> >::iterator i = conn.begin(); i != conn.end(); ++i)
+		for (unsigned n = 0; n < numRecieved; ++n)
 		{
-			boost::shared_ptr<UDPConnection> locked(*i);
-			if (locked->CheckAddress(fromAddr))
-			{
-				locked->ProcessRawPacket(data);
-				data = 0; // UDPConnection takes ownership of packet
-				break;
-			}
-		}
-		
-		if (data) // still have the packet (means no connection with the sender's address found)
-		{		
-			const int packetNumber = *(int*)(data->data);
-			const int lastInOrder = *(int*)(data->data+4);
-			const unsigned char nak = data->data[8];
-			if (acceptNewConnections && packetNumber == 0 && lastInOrder == -1 && nak == 0)
+			const unsigned recieved = mySocket->GetBatchLength(n);
+			if (!UDPConnection::IsValidHeader(mySocket->GetBatchData(n), recieved))
+				continue;
+			const sockaddr_in& fromAddr = mySocket->GetBatchSender(n);
+			RawPacket* data = new RawPacket(mySocket->GetBatchData(n), recieved);
+
+			for (std::list< boost::weak_ptr<UDPConnection> >::iterator i = conn.begin(); i != conn.end(); ++i)
 			{
-				// new client wants to connect
-				boost::shared_ptr<UDPConnection> incoming(new UDPConnection(mySocket, fromAddr));
-				waiting.push(incoming);
-				conn.push_back(incoming);
-				incoming->ProcessRawPacket(data);
+				boost::shared_ptr<UDPConnection> locked(*i);
+				if (locked->CheckAddress(fromAddr))
+				{
+					locked->ProcessRawPacket(data);
+					data = 0; // UDPConnection takes ownership of packet
+					break;
+				}
 			}
-			else
+
+			if (data) // still have the packet (means no connection with the sender's address found)
 			{
-				// throw it
-				delete data;
+				const int packetNumber = *(int*)(data->data);
+				const int lastInOrder = *(int*)(data->data+4);
+				const unsigned char nak = data->data[8];
+				if (acceptNewConnections && packetNumber == 0 && lastInOrder == -1 && nak == 0)
+				{
+					// new client wants to connect
+					boost::shared_ptr<UDPConnection> incoming(new UDPConnection(mySocket, fromAddr));
+					incoming->SetCompression(compressNewConnections);
+					waiting.push(incoming);
+					conn.push_back(incoming);
+					incoming->ProcessRawPacket(data);
+				}
+				else
+				{
+					// throw it
+					delete data;
+				}
 			}
-		}	
+		}
 	}
-	
+
 	for (std::list< boost::weak_ptr< UDPConnection> >::iterator i = conn.begin(); i != conn.end(); ++i)
 	{
 		boost::shared_ptr<UDPConnection> temp = i->lock();
@@ -88,6 +95,7 @@ void UDPListener::Update()
 boost::shared_ptr<UDPConnection> UDPListener::SpawnConnection(const std::string& address, const unsigned port)
 {
 	boost::shared_ptr<UDPConnection> temp(new UDPConnection(mySocket, address, port));
+	temp->SetCompression(compressNewConnections);
 	conn.push_back(temp);
 	return temp;
 }
@@ -113,6 +121,11 @@ bool UDPListener::HasIncomingData(int timeout)
 	return mySocket->HasIncomingData(timeout);
 }
 
+int UDPListener::GetSocketFD() const
+{
+	return mySocket->GetFD();
+}
+
 boost::weak_ptr<UDPConnection> UDPListener::PreviewConnection()
 {
 	return waiting.front();
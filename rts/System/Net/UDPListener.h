@@ -48,9 +48,14 @@ public:
 	*/
 	bool Listen(const bool state);
 	bool Listen() const;
+
+	/// compress outgoing data on connections accepted from now on (see UDPConnection::SetCompression)
+	void SetCompression(const bool enable) { compressNewConnections = enable; }
 	
 	bool HasIncomingConnections() const;
 	bool HasIncomingData(int timeout);
+	/// native handle of our socket, to wait on several listeners at once
+	int GetSocketFD() const;
 	boost::weak_ptr<UDPConnection> PreviewConnection();
 	boost::shared_ptr<UDPConnection> AcceptConnection();
 	void RejectConnection();
@@ -61,6 +66,8 @@ private:
 	If true, we will create a new connection, if false, it get dropped
 	*/
 	bool acceptNewConnections;
+
+	bool compressNewConnections;
 	
 	/// Our socket
 	boost::shared_ptr<UDPSocket> mySocket;
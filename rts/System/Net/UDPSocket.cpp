@@ -1,5 +1,8 @@
 #include "UDPSocket.h"
 
+#include <string.h>
+#include <errno.h>
+
 #include "Exception.h"
 
 namespace netcode {
@@ -9,14 +12,54 @@ const int SOCKET_ERROR = -1;
 typedef int socklen_t;
 #endif
 
+const unsigned UDPSocket::batchSize = 32;
+const unsigned UDPSocket::maxDatagramSize = 4096;
+
 UDPSocket::UDPSocket(const int port) : Socket(DATAGRAM)
 {
 	Bind(port);
 	SetBlocking(false);
+
+	recvBuffer.resize(batchSize * maxDatagramSize);
+	recvLengths.resize(batchSize, 0);
+	recvAddrs.resize(batchSize);
+	sendBuffer.resize(batchSize * maxDatagramSize);
+	sendLengths.resize(batchSize, 0);
+	sendAddrs.resize(batchSize);
+	numQueued = 0;
+
+#ifdef UDPSOCKET_MMSG
+	// the message headers point into the buffers above and never change
+	recvMsgs.resize(batchSize);
+	recvIovs.resize(batchSize);
+	sendMsgs.resize(batchSize);
+	sendIovs.resize(batchSize);
+	memset(&recvMsgs[0], 0, batchSize * sizeof(mmsghdr));
+	memset(&sendMsgs[0], 0, batchSize * sizeof(mmsghdr));
+	for (unsigned i = 0; i < batchSize; ++i)
+	{
+		recvIovs[i].iov_base = &recvBuffer[i * maxDatagramSize];
+		recvIovs[i].iov_len = maxDatagramSize;
+		recvMsgs[i].msg_hdr.msg_iov = &recvIovs[i];
+		recvMsgs[i].msg_hdr.msg_iovlen = 1;
+		recvMsgs[i].msg_hdr.msg_name = &recvAddrs[i];
+
+		sendIovs[i].iov_base = &sendBuffer[i * maxDatagramSize];
+		sendMsgs[i].msg_hdr.msg_iov = &sendIovs[i];
+		sendMsgs[i].msg_hdr.msg_iovlen = 1;
+		sendMsgs[i].msg_hdr.msg_name = &sendAddrs[i];
+		sendMsgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+	}
+#endif
 }
 
 UDPSocket::~UDPSocket()
 {
+	try {
+		SendBatch();
+	} catch (const network_error&) {
+		// closing anyway
+	}
 }
 
 unsigned UDPSocket::RecvFrom(unsigned char* const buf, const unsigned bufLength, sockaddr_in* const fromAddress) const 
@@ -51,6 +94,107 @@ void UDPSocket::SendTo(const unsigned char* const buf, const unsigned dataLength
 }
 
 
+unsigned UDPSocket::RecvBatch()
+{
+#ifdef UDPSOCKET_MMSG
+	for (unsigned i = 0; i < batchSize; ++i)
+		recvMsgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+
+	const int num = recvmmsg(mySocket, &recvMsgs[0], batchSize, MSG_DONTWAIT, NULL);
+	if (num == SOCKET_ERROR)
+	{
+		if (IsFakeError())
+			return 0;
+		else
+			throw network_error(std::string("Error receiving data from socket: ") + GetErrorMsg());
+	}
+	for (int i = 0; i < num; ++i)
+		recvLengths[i] = recvMsgs[i].msg_len;
+	return (unsigned)num;
+#else
+	unsigned num = 0;
+	while (num < batchSize && (recvLengths[num] = RecvFrom(&recvBuffer[num * maxDatagramSize], maxDatagramSize, &recvAddrs[num])) > 0)
+		++num;
+	return num;
+#endif
+}
+
+void UDPSocket::QueueSendTo(const unsigned char* const buf, const unsigned dataLength, const sockaddr_in* const destination)
+{
+#ifdef UDPSOCKET_MMSG
+	if (dataLength > maxDatagramSize)
+	{
+		SendTo(buf, dataLength, destination);
+		return;
+	}
+	if (numQueued == batchSize)
+		SendBatch();
+
+	memcpy(&sendBuffer[numQueued * maxDatagramSize], buf, dataLength);
+	sendLengths[numQueued] = dataLength;
+	sendAddrs[numQueued] = *destination;
+	++numQueued;
+#else
+	SendTo(buf, dataLength, destination);
+#endif
+}
+
+void UDPSocket::QueueSendTo(const unsigned char* const header, const unsigned headerLength, const unsigned char* const buf, const unsigned dataLength, const sockaddr_in* const destination)
+{
+	const unsigned total = headerLength + dataLength;
+	if (total > maxDatagramSize)
+	{
+		std::vector<unsigned char> temp(total);
+		memcpy(&temp[0], header, headerLength);
+		memcpy(&temp[headerLength], buf, dataLength);
+		SendTo(&temp[0], total, destination);
+		return;
+	}
+#ifdef UDPSOCKET_MMSG
+	if (numQueued == batchSize)
+		SendBatch();
+
+	unsigned char* slot = &sendBuffer[numQueued * maxDatagramSize];
+	memcpy(slot, header, headerLength);
+	if (dataLength > 0)
+		memcpy(slot + headerLength, buf, dataLength);
+	sendLengths[numQueued] = total;
+	sendAddrs[numQueued] = *destination;
+	++numQueued;
+#else
+	unsigned char* slot = &sendBuffer[0];
+	memcpy(slot, header, headerLength);
+	if (dataLength > 0)
+		memcpy(slot + headerLength, buf, dataLength);
+	SendTo(slot, total, destination);
+#endif
+}
+
+void UDPSocket::SendBatch()
+{
+#ifdef UDPSOCKET_MMSG
+	unsigned sent = 0;
+	while (sent < numQueued)
+	{
+		for (unsigned i = sent; i < numQueued; ++i)
+			sendIovs[i].iov_len = sendLengths[i];
+
+		const int num = sendmmsg(mySocket, &sendMsgs[sent], numQueued - sent, 0);
+		if (num == SOCKET_ERROR)
+		{
+			if (IsFakeError())
+			{
+				++sent; // like SendTo(), drop the datagram which failed and go on
+				continue;
+			}
+			numQueued = 0;
+			throw network_error(std::string("Error sending data to socket: ") + GetErrorMsg());
+		}
+		sent += num;
+	}
+	numQueued = 0;
+#endif
+}
 
 } // namespace netcode
 
@@ -1,8 +1,17 @@
 #ifndef _UDPSOCKET
 #define _UDPSOCKET
 
+#include <vector>
+
 #include "Socket.h"
 
+#if defined(__linux__)
+// recvmmsg() / sendmmsg(): move a batch of datagrams per syscall
+#define UDPSOCKET_MMSG
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 namespace netcode {
 
 /**
@@ -24,7 +33,7 @@ public:
 	/**
 	@brief Close our socket
 	*/
-	~UDPSocket();
+	virtual ~UDPSocket();
 	
 	/**
 	@brief get data from the socket
@@ -44,8 +53,57 @@ public:
 	@throw network_error when data could not be sent
 	 */
 	void SendTo(const unsigned char* const buf, const unsigned dataLength, const sockaddr_in* const destination) const;
-	
+
+	/**
+	@brief receive as many waiting datagrams as fit in the receive ring
+	On linux this is one recvmmsg() call, elsewhere it loops over RecvFrom().
+	Datagrams can be read with GetBatchData() & co. until the next call.
+	@throw network_error when a error occurs
+	@return The amount of datagrams read (0 means no data)
+	*/
+	virtual unsigned RecvBatch();
+	const unsigned char* GetBatchData(const unsigned i) const { return &recvBuffer[i * maxDatagramSize]; }
+	unsigned GetBatchLength(const unsigned i) const { return recvLengths[i]; }
+	const sockaddr_in& GetBatchSender(const unsigned i) const { return recvAddrs[i]; }
+
+	/**
+	@brief queue a datagram for SendBatch()
+	The data is copied into the send ring, which is flushed automatically when it gets full.
+	Without sendmmsg() the datagram is sent right away.
+	*/
+	void QueueSendTo(const unsigned char* const buf, const unsigned dataLength, const sockaddr_in* const destination);
+	/// same as above, but gathers the datagram from a header and a payload
+	/// (virtual like RecvBatch, so tests can put a lossy link in between)
+	virtual void QueueSendTo(const unsigned char* const header, const unsigned headerLength, const unsigned char* const buf, const unsigned dataLength, const sockaddr_in* const destination);
+
+	/**
+	@brief send all queued datagrams
+	@throw network_error when data could not be sent
+	*/
+	void SendBatch();
+
+	/// datagrams moved per batch
+	static const unsigned batchSize;
+	/// largest datagram the receive ring holds (longer ones get truncated)
+	static const unsigned maxDatagramSize;
+
 protected:
+	/// preallocated buffers for batchSize datagrams each
+	std::vector<unsigned char> recvBuffer;
+	std::vector<unsigned> recvLengths;
+	std::vector<sockaddr_in> recvAddrs;
+
+	std::vector<unsigned char> sendBuffer;
+	std::vector<unsigned> sendLengths;
+	std::vector<sockaddr_in> sendAddrs;
+	unsigned numQueued;
+
+#ifdef UDPSOCKET_MMSG
+	std::vector<mmsghdr> recvMsgs;
+	std::vector<iovec> recvIovs;
+	std::vector<mmsghdr> sendMsgs;
+	std::vector<iovec> sendIovs;
+#endif
 };
 
 
@@ -40,6 +40,7 @@ void CNetProtocol::InitClient(const char *server_addr, unsigned portnum,unsigned
 	sock->SetBlocking(false);
 	netcode::UDPConnection* conn = new netcode::UDPConnection(sock, server_addr, portnum);
 	conn->SetMTU(configHandler.Get("MaximumTransmissionUnit", 0));
+	conn->SetCompression(configHandler.Get("NetworkCompression", false));
 	serverConn.reset(conn);
 	serverConn->SendData(CBaseNetProtocol::Get().SendAttemptConnect(myName, myVersion));
 	serverConn->Flush(true);
@@ -0,0 +1,57 @@
+/**
+@file WorkerThreads.h
+@brief Running one job queue on several threads
+
+The caller takes part as worker zero, so a single thread needs no extra
+thread at all. Sharing out the jobs is up to the workers.
+*/
+
+#ifndef WORKERTHREADS_H
+#define WORKERTHREADS_H
+
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/version.hpp>
+
+#include "ConfigHandler.h"
+
+/// Number of cores, 1 if unknown
+inline int GetHardwareThreadCount()
+{
+#if (BOOST_VERSION >= 103500)
+	const int count = boost::thread::hardware_concurrency();
+	return (count > 0) ? count : 1;
+#else
+	return 1;
+#endif
+}
+
+/// HardwareThreadCount from the config, the number of cores if that is 0
+inline int GetWorkerThreadCount()
+{
+	const int count = configHandler.Get("HardwareThreadCount", 0);
+	return (count > 0) ? count : GetHardwareThreadCount();
+}
+
+/**
+@brief Run worker on numThreads threads and wait for all of them
+The calling thread runs callerWorker if it is set, worker otherwise, so the
+caller can do its own share (report progress, ...) as worker zero.
+*/
+inline void RunWorkers(int numThreads, const boost::function<void()>& worker, const boost::function<void()>& callerWorker = boost::function<void()>())
+{
+	std::vector<boost::thread*> threads;
+	for (int i = 1; i < numThreads; ++i)
+		threads.push_back(new boost::thread(worker));
+	if (callerWorker)
+		callerWorker();
+	else
+		worker();
+	for (unsigned i = 0; i < threads.size(); ++i) {
+		threads[i]->join();
+		delete threads[i];
+	}
+}
+
+#endif
@@ -19,7 +19,11 @@ may change every Spring release without notice).
 
 /** The current demofile version. Only change on major modifications for which
 appending stuff to DemoFileHeader is not sufficient. */
-#define DEMOFILE_VERSION 3
+#define DEMOFILE_VERSION 4
+
+/** Version of demos written before stream compression was added. Readers
+still play them, their stream is never compressed. */
+#define DEMOFILE_VERSION_3 3
 
 #pragma pack(push, 1)
 
@@ -38,6 +42,9 @@ Demo file layout is like this:
 			  CTeam::Statistics for each team.
 			- Array of all CTeam::Statistics (total number of items is the
 			  sum of the elements in the array of dwords).
+		- Keyframe index (indexSize), consisting of:
+			- DemoIndexHeader
+			- numEntries DemoIndexEntry, ascending by frame number
 
 The header is designed to be extensible: it contains a version field and a
 headerSize field to support this. The version field is a major version number
@@ -47,6 +54,17 @@ minor version number, which happens to be equal to sizeof(DemoFileHeader).
 
 If Spring didn't cleanup properly (crashed), the demoStreamSize is 0 and it
 can be assumed the demo stream continues until the end of the file.
+
+Demos written before the keyframe index was added have a header which ends
+right before indexSize (DEMOFILE_HEADER_SIZE_NOINDEX), they are read as if
+the missing fields were 0.
+
+With streamCompression set (version 4 only) the demo stream chunk holds a sequence of
+DemoStreamBlockHeader, each followed by a zlib compressed block of the stream
+described below. demoStreamSize is the size of the compressed chunk then and
+rawStreamSize the size of the stream itself (offsets in the keyframe index
+refer to the latter). Blocks are compressed independently, so readers can
+start at any of them.
 */
 struct DemoFileHeader
 {
@@ -69,6 +87,9 @@ struct DemoFileHeader
 	int teamStatElemSize;   ///< sizeof(CTeam::Statistics)
 	int teamStatPeriod;     ///< Interval (in seconds) between team stats.
 	int winningAllyTeam;    ///< The ally team that won the game, -1 if unknown.
+	int indexSize;          ///< Size of the keyframe index chunk, 0 if there is none.
+	int streamCompression;  ///< DEMOFILE_COMPRESSION_NONE or DEMOFILE_COMPRESSION_ZLIB.
+	int rawStreamSize;      ///< Size of the demo stream after decompression.
 
 	/// Change structure from host endian to little endian or vice versa.
 	void swab() {
@@ -88,9 +109,15 @@ struct DemoFileHeader
 		teamStatElemSize = swabdword(teamStatElemSize);
 		teamStatPeriod = swabdword(teamStatPeriod);
 		winningAllyTeam = swabdword(winningAllyTeam);
+		indexSize = swabdword(indexSize);
+		streamCompression = swabdword(streamCompression);
+		rawStreamSize = swabdword(rawStreamSize);
 	}
 };
 
+/** Size of a DemoFileHeader without keyframe index (indexSize and later fields). */
+#define DEMOFILE_HEADER_SIZE_NOINDEX (sizeof(DemoFileHeader) - 3 * sizeof(int))
+
 /**
 @brief Spring demo stream chunk header
 
@@ -114,6 +141,70 @@ struct DemoStreamChunkHeader
 	}
 };
 
+#define DEMOFILE_COMPRESSION_NONE 0
+#define DEMOFILE_COMPRESSION_ZLIB 1
+
+/**
+@brief Spring demo stream block header (compressed demos only)
+*/
+struct DemoStreamBlockHeader
+{
+	int rawSize;        ///< Size of the block after decompression.
+	int compressedSize; ///< Size of the zlib data following this header.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		rawSize = swabdword(rawSize);
+		compressedSize = swabdword(compressedSize);
+	}
+};
+
+/** The recorder starts a new block once this much of the stream is collected. */
+#define DEMOFILE_BLOCK_SIZE (64 * 1024)
+/**
+Upper limit of DemoStreamBlockHeader::rawSize. A block ends with the packet
+which took it past DEMOFILE_BLOCK_SIZE, and packets are shorter than 64 KB.
+*/
+#define DEMOFILE_MAX_BLOCK_SIZE (DEMOFILE_BLOCK_SIZE + 128 * 1024)
+
+/** Number of frames between two entries of the keyframe index. */
+#define DEMOFILE_INDEX_INTERVAL 300
+
+/**
+@brief Spring demo keyframe index header
+
+Frames are counted like the server does: each NETMSG_NEWFRAME and
+NETMSG_KEYFRAME in the demo stream starts a new one.
+*/
+struct DemoIndexHeader
+{
+	int numEntries;    ///< Number of DemoIndexEntry following this header.
+	int frameInterval; ///< Frames between two entries (DEMOFILE_INDEX_INTERVAL when recorded).
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		numEntries = swabdword(numEntries);
+		frameInterval = swabdword(frameInterval);
+	}
+};
+
+/**
+@brief Spring demo keyframe index entry
+*/
+struct DemoIndexEntry
+{
+	int frameNum;      ///< Frame started by the message at streamOffset.
+	float modGameTime; ///< Gametime of the chunk at streamOffset.
+	int streamOffset;  ///< Offset of its DemoStreamChunkHeader relative to the start of the demo stream.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		frameNum = swabdword(frameNum);
+		modGameTime = swabfloat(modGameTime);
+		streamOffset = swabdword(streamOffset);
+	}
+};
+
 #pragma pack(pop)
 
 #endif // DEMOFILE_H
@@ -345,6 +345,11 @@ extern uLong ZEXPORT unzGetOffset (unzFile file);
 /* Set the current file offset */
 extern int ZEXPORT unzSetOffset (unzFile file, uLong pos);
 
+/* Get the position of the first byte of the (compressed) data of the current
+   file in the zipfile. Call it directly after unzOpenCurrentFile, returns 0
+   if no file is opened. (backported from minizip 1.1) */
+extern uLong ZEXPORT unzGetCurrentFileZStreamPos (unzFile file);
+
 
 
 #ifdef __cplusplus
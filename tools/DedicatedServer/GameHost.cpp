@@ -0,0 +1,114 @@
+#include "GameHost.h"
+
+#include <iostream>
+#include <SDL_timer.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include "Game/GameServer.h"
+#include "System/Exceptions.h"
+
+CGameHost::CGameHost()
+{
+#ifdef __linux__
+	epollFD = epoll_create(64);
+	if (epollFD < 0)
+		throw std::runtime_error("Failed to create epoll instance");
+#else
+	epollFD = -1;
+#endif
+}
+
+CGameHost::~CGameHost()
+{
+	while (!games.empty())
+		RemoveGame(games.size() - 1);
+#ifdef __linux__
+	close(epollFD);
+#endif
+}
+
+void CGameHost::AddGame(CGameServer* server)
+{
+#ifdef __linux__
+	const int fd = server->GetSocketFD();
+	if (fd >= 0)
+	{
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLPRI;
+		ev.data.u64 = 0;
+		ev.data.ptr = server;
+		if (epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &ev) != 0)
+			throw std::runtime_error("Failed to add game socket to epoll set");
+	}
+#endif
+	games.push_back(server);
+}
+
+void CGameHost::RemoveGame(unsigned index)
+{
+	CGameServer* server = games[index];
+#ifdef __linux__
+	const int fd = server->GetSocketFD();
+	if (fd >= 0)
+	{
+		epoll_event ev; // ignored, but must not be NULL on old kernels
+		epoll_ctl(epollFD, EPOLL_CTL_DEL, fd, &ev);
+	}
+#endif
+	games[index] = games.back();
+	games.pop_back();
+	delete server;
+}
+
+void CGameHost::Wait(int timeout, std::vector<bool>& ready)
+{
+	ready.assign(games.size(), false);
+#ifdef __linux__
+	epoll_event events[64];
+	const int numEvents = epoll_wait(epollFD, events, 64, timeout);
+	for (int e = 0; e < numEvents; ++e)
+	{
+		for (unsigned i = 0; i < games.size(); ++i)
+		{
+			if (games[i] == events[e].data.ptr)
+			{
+				ready[i] = true;
+				break;
+			}
+		}
+	}
+#else
+	// no epoll: sleep and let every server look at its socket itself
+	SDL_Delay(timeout);
+	ready.assign(games.size(), true);
+#endif
+}
+
+void CGameHost::Run()
+{
+	std::vector<bool> ready;
+	while (!games.empty())
+	{
+		// same 10ms granularity the per-game server threads use
+		Wait(10, ready);
+
+		for (unsigned i = 0; i < games.size(); ++i)
+			games[i]->Poll(ready[i]);
+
+		for (unsigned i = 0; i < games.size(); )
+		{
+			if (games[i]->HasFinished())
+			{
+				std::cout << "Game " << i << " finished, " << (games.size() - 1) << " still running" << std::endl;
+				RemoveGame(i);
+				ready[i] = ready.back();
+				ready.pop_back();
+			}
+			else
+				++i;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef GAMEHOST_H
+#define GAMEHOST_H
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+class CGameServer;
+
+/**
+@brief Runs several game servers in one process
+All servers are driven from the calling thread: one event loop waits on all of
+their sockets at once (epoll on linux) and then polls every server, so a host
+running many games pays neither a thread nor an archive scan per game.
+*/
+class CGameHost : boost::noncopyable
+{
+public:
+	CGameHost();
+	/// deletes all servers which are still running
+	~CGameHost();
+
+	/**
+	@brief Take ownership of a server
+	The server must have been created without its own thread.
+	*/
+	void AddGame(CGameServer* server);
+
+	/// Run until all games have finished
+	void Run();
+
+	unsigned NumGames() const { return games.size(); }
+
+private:
+	/// Wait up to timeout ms for data, mark games with incoming data in ready
+	void Wait(int timeout, std::vector<bool>& ready);
+	void RemoveGame(unsigned index);
+
+	std::vector<CGameServer*> games;
+	int epollFD;
+};
+
+#endif
@@ -0,0 +1,38 @@
+/**
+@file Relay.cpp
+@brief Spectator relay for a dedicated (or hosted) game server
+
+usage: spring-relay <hostaddr> <hostport> <name> <listenport> [delaySeconds]
+
+Connects to the game at hostaddr:hostport as player <name> (which should be a
+spectator in the game's script) and lets any number of spectators connect on
+listenport instead. Exits once the game ended and all spectators have been
+sent the rest of it. spring-dedicated-soak pointed at the relay port works as
+a loopback test.
+*/
+
+#include "Game/Server/GameRelay.h"
+
+#include <string>
+#include <iostream>
+#include <stdlib.h>
+#include <SDL_timer.h>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 5)
+	{
+		std::cout << "usage: " << argv[0] << " <hostaddr> <hostport> <name> <listenport> [delaySeconds]" << std::endl;
+		return 1;
+	}
+	const unsigned delay = (argc > 5) ? atoi(argv[5]) * 1000 : 0;
+
+	CGameRelay relay(argv[1], atoi(argv[2]), argv[3], atoi(argv[4]), delay);
+	while (!relay.HasFinished())
+	{
+		relay.Update();
+		SDL_Delay(10);
+	}
+	std::cout << "Game over, relayed " << relay.NumBacklogMessages() << " messages" << std::endl;
+	return 0;
+}
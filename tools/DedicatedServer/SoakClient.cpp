@@ -0,0 +1,134 @@
+/**
+@file SoakClient.cpp
+@brief Drives simulated players against a (multi-game) dedicated server
+
+usage: spring-dedicated-soak <host> <firstPort> <numGames> <playersPerGame> <seconds> [namePrefix]
+
+Game g is expected on port firstPort+g, its players named namePrefix0 ..
+namePrefix<playersPerGame-1> (default prefix "Player"). Every client connects,
+answers keyframes and sync requests like a real client would and counts the
+traffic it gets. Exits non-zero if any client was not accepted or was dropped.
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL_timer.h>
+#include <boost/shared_ptr.hpp>
+
+#include "System/Net/UDPConnection.h"
+#include "System/Net/UDPSocket.h"
+#include "System/Net/RawPacket.h"
+#include "System/BaseNetProtocol.h"
+#include "Game/GameVersion.h"
+
+using netcode::RawPacket;
+
+struct SoakClient
+{
+	boost::shared_ptr<netcode::UDPConnection> conn;
+	int playerNum;
+	bool quit;
+	unsigned packets;
+	unsigned bytes;
+	int lastFrame;
+};
+
+static void HandlePacket(SoakClient& c, boost::shared_ptr<const RawPacket> packet)
+{
+	c.packets++;
+	c.bytes += packet->length;
+
+	switch (packet->data[0])
+	{
+		case NETMSG_SETPLAYERNUM:
+			c.playerNum = packet->data[1];
+			break;
+		case NETMSG_KEYFRAME:
+			c.lastFrame = *(int*)&packet->data[1];
+			c.conn->SendData(CBaseNetProtocol::Get().SendKeyFrame(c.lastFrame));
+			break;
+		case NETMSG_SYNCREQUEST:
+			// all simulated clients agree on the checksum, so the server sees no desync
+			if (c.playerNum >= 0)
+				c.conn->SendData(CBaseNetProtocol::Get().SendSyncResponse(c.playerNum, *(int*)&packet->data[1], 0));
+			break;
+		case NETMSG_QUIT:
+			c.quit = true;
+			break;
+		default:
+			break;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 6)
+	{
+		std::cout << "usage: " << argv[0] << " <host> <firstPort> <numGames> <playersPerGame> <seconds> [namePrefix]" << std::endl;
+		return 1;
+	}
+	const std::string host = argv[1];
+	const int firstPort = atoi(argv[2]);
+	const int numGames = atoi(argv[3]);
+	const int playersPerGame = atoi(argv[4]);
+	const unsigned duration = atoi(argv[5]) * 1000;
+	const std::string prefix = (argc > 6) ? argv[6] : "Player";
+
+	std::vector<SoakClient> clients;
+	for (int g = 0; g < numGames; ++g)
+	{
+		for (int p = 0; p < playersPerGame; ++p)
+		{
+			boost::shared_ptr<netcode::UDPSocket> sock(new netcode::UDPSocket(0));
+			sock->SetBlocking(false);
+
+			SoakClient c;
+			c.conn.reset(new netcode::UDPConnection(sock, host, firstPort + g));
+			c.playerNum = -1;
+			c.quit = false;
+			c.packets = 0;
+			c.bytes = 0;
+			c.lastFrame = 0;
+
+			char name[64];
+			sprintf(name, "%s%i", prefix.c_str(), p);
+			c.conn->SendData(CBaseNetProtocol::Get().SendAttemptConnect(name, SpringVersion::Get()));
+			c.conn->Flush(true);
+			clients.push_back(c);
+		}
+	}
+	std::cout << "Started " << clients.size() << " clients" << std::endl;
+
+	const unsigned startTime = SDL_GetTicks();
+	while (SDL_GetTicks() - startTime < duration)
+	{
+		for (std::vector<SoakClient>::iterator c = clients.begin(); c != clients.end(); ++c)
+		{
+			if (c->quit)
+				continue;
+			c->conn->Update();
+			boost::shared_ptr<const RawPacket> packet;
+			while ((packet = c->conn->GetData()))
+				HandlePacket(*c, packet);
+			c->conn->Flush(false);
+		}
+		SDL_Delay(10);
+	}
+
+	int failed = 0;
+	for (unsigned i = 0; i < clients.size(); ++i)
+	{
+		const SoakClient& c = clients[i];
+		const bool ok = (c.playerNum >= 0) && !c.quit && !c.conn->CheckTimeout();
+		if (!ok)
+			++failed;
+		std::cout << "game " << (i / playersPerGame) << " client " << (i % playersPerGame)
+			<< ": player " << c.playerNum << ", " << c.packets << " packets, " << c.bytes
+			<< " bytes, last keyframe " << c.lastFrame << (ok ? "" : " FAILED") << std::endl;
+	}
+	std::cout << (clients.size() - failed) << "/" << clients.size() << " clients stayed connected" << std::endl;
+	return (failed == 0) ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include "Game/GameServer.h"
+#include "GameHost.h"
 #include "GameSetup.h"
 #include "GameData.h"
 #include "System/FileSystem/FileSystem.h"
@@ -17,6 +18,72 @@
 #include <windows.h>
 #endif
 
+/**
+@brief Set up a server for the given script
+@param ownThread false when the server is driven by a CGameHost
+*/
+static CGameServer* CreateServer(const std::string& script, bool ownThread)
+{
+	std::cout << "Loading script from file: " << script << std::endl;
+
+	LocalSetup* settings = new LocalSetup();
+	CFileHandler fh(script);
+	if (!fh.FileExists())
+		throw content_error("Setupscript doesn't exists in given location: "+script);
+
+	std::string buf;
+	if (!fh.LoadStringData(buf))
+		throw content_error("Setupscript cannot be read: "+script);
+	settings->Init(buf);
+
+	CGameSetup* gameSetup = new CGameSetup();	// to store the gamedata inside
+	if (!gameSetup->Init(buf))	// read the script provided by cmdline
+		throw content_error("Failed to load script: "+script);
+
+	std::cout << "Starting server..." << std::endl;
+	GameData* data = new GameData();
+	UnsyncedRNG rng;
+	rng.Seed(SDL_GetTicks());
+	rng.Seed(gameSetup->gameSetupText.length());
+	data->SetRandomSeed(SDL_GetTicks());
+
+	//  Use script provided hashes if they exist
+	if (gameSetup->mapHash != 0) {
+		data->SetMap(gameSetup->mapName, gameSetup->mapHash);
+	} else {
+		data->SetMap(gameSetup->mapName, archiveScanner->GetMapChecksum(gameSetup->mapName));
+
+		// the VFS is shared by all games of this process, so only the first
+		// game on a map has to add its archives
+		CFileHandler* f = new CFileHandler("maps/" + gameSetup->mapName);
+		if (!f->FileExists()) {
+			std::vector<std::string> ars = archiveScanner->GetArchivesForMap(gameSetup->mapName);
+			if (ars.empty()) {
+				throw content_error("Couldn't find any archives for map '" + gameSetup->mapName + "'.");
+			}
+			for (std::vector<std::string>::iterator i = ars.begin(); i != ars.end(); ++i) {
+				if (!vfsHandler->AddArchive(*i, false)) {
+					throw content_error("Couldn't load archive '" + *i + "' for map '" + gameSetup->mapName + "'.");
+				}
+			}
+		}
+		delete f;
+
+		gameSetup->LoadStartPositions();
+	}
+
+	if (gameSetup->modHash != 0) {
+		data->SetMod(gameSetup->baseMod, gameSetup->modHash);
+	} else {
+		const std::string modArchive = archiveScanner->ModNameToModArchive(gameSetup->baseMod);
+		data->SetMod(gameSetup->baseMod, archiveScanner->GetModChecksum(modArchive));
+	}
+
+	data->SetScript(gameSetup->scriptName);
+	data->SetSetup(gameSetup->gameSetupText);
+	return new CGameServer(settings, false, data, gameSetup, ownThread);
+}
+
 int main(int argc, char *argv[])
 {
 	try {
@@ -25,72 +92,11 @@ int main(int argc, char *argv[])
 	ConfigHandler::Instantiate("");
 	FileSystemHandler::Cleanup();
 	FileSystemHandler::Initialize(false);
-	CGameServer* server = 0;
-	CGameSetup* gameSetup = 0;
 
-	if (argc > 1)
+	if (argc == 2)
 	{
-		const std::string script(argv[0]);
-		std::cout << "Loading script from file: " << script << std::endl;
-
-		LocalSetup* settings = new LocalSetup();
-		CFileHandler fh(argv[1]);
-		if (!fh.FileExists())
-			throw content_error("Setupscript doesn't exists in given location: "+script);
-		
-		std::string buf;
-		if (!fh.LoadStringData(buf))
-			throw content_error("Setupscript cannot be read: "+script);
-		settings->Init(buf);
-		
-		gameSetup = new CGameSetup();	// to store the gamedata inside
-		if (!gameSetup->Init(buf))	// read the script provided by cmdline
-		{
-			std::cout << "Failed to load script" << std::endl;
-			return 1;
-		}
-		
-		std::cout << "Starting server..." << std::endl;
 		// Create the server, it will run in a separate thread
-		GameData* data = new GameData();
-		UnsyncedRNG rng;
-		rng.Seed(SDL_GetTicks());
-		rng.Seed(gameSetup->gameSetupText.length());
-		data->SetRandomSeed(SDL_GetTicks());
-
-		//  Use script provided hashes if they exist
-		if (gameSetup->mapHash != 0) {
-			data->SetMap(gameSetup->mapName, gameSetup->mapHash);
-		} else {
-			data->SetMap(gameSetup->mapName, archiveScanner->GetMapChecksum(gameSetup->mapName));
-
-			CFileHandler* f = new CFileHandler("maps/" + gameSetup->mapName);
-			if (!f->FileExists()) {
-				std::vector<std::string> ars = archiveScanner->GetArchivesForMap(gameSetup->mapName);
-				if (ars.empty()) {
-					throw content_error("Couldn't find any archives for map '" + gameSetup->mapName + "'.");
-				}
-				for (std::vector<std::string>::iterator i = ars.begin(); i != ars.end(); ++i) {
-					if (!vfsHandler->AddArchive(*i, false)) {
-						throw content_error("Couldn't load archive '" + *i + "' for map '" + gameSetup->mapName + "'.");
-					}
-				}
-			}
-			delete f;
-		
-			gameSetup->LoadStartPositions();
-                }
-
-		if (gameSetup->modHash != 0) {
-			data->SetMod(gameSetup->baseMod, gameSetup->modHash);
-		} else {
-			const std::string modArchive = archiveScanner->ModNameToModArchive(gameSetup->baseMod);
-			data->SetMod(gameSetup->baseMod, archiveScanner->GetModChecksum(modArchive));
-		}
-
-		data->SetScript(gameSetup->scriptName);
-		data->SetSetup(gameSetup->gameSetupText);
-		server = new CGameServer(settings, false, data, gameSetup);
+		CGameServer* server = CreateServer(argv[1], true);
 
 		while (!server->HasFinished()) // check if still running
 #ifdef _WIN32
@@ -100,11 +106,22 @@ int main(int argc, char *argv[])
 #endif
 		delete server;	// delete the server after usage
 	}
+	else if (argc > 2)
+	{
+		// host mode: all games share this process, its archive scan and VFS
+		// and are driven by one event loop; every script needs its own HostPort
+		CGameHost host;
+		for (int i = 1; i < argc; ++i)
+			host.AddGame(CreateServer(argv[i], false));
+
+		std::cout << "Hosting " << host.NumGames() << " games" << std::endl;
+		host.Run();
+	}
 	else
 	{
-		std::cout << "usage: dedicated <full_path_to_script>" << std::endl;
+		std::cout << "usage: dedicated <full_path_to_script> [<more_scripts> ...]" << std::endl;
 	}
-	
+
 	FileSystemHandler::Cleanup();
 	}
 	catch (const std::exception& err)
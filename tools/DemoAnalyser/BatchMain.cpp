@@ -0,0 +1,341 @@
+/**
+@file BatchMain.cpp
+@brief Statistics over many demos at once
+
+usage: demostats [-j threads] [--csv prefix] [--json file] <demo or directory> ...
+
+Directories are searched (not recursively) for .sdf files. The demos are
+scanned in parallel, the results are written in the order the files were
+given / found, as CSV (prefix_demos.csv, prefix_players.csv,
+prefix_builds.csv) and / or as one JSON object holding the same three tables
+column by column. Without --csv or --json a summary per demo is printed.
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "DemoStats.h"
+#include "WorkerThreads.h"
+
+using namespace std;
+
+static bool IsDirectory(const string& path)
+{
+#ifdef _WIN32
+	const DWORD attr = GetFileAttributesA(path.c_str());
+	return (attr != INVALID_FILE_ATTRIBUTES) && (attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat st;
+	return (stat(path.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+#endif
+}
+
+static bool IsDemoName(const string& name)
+{
+	return name.size() > 4 && name.compare(name.size() - 4, 4, ".sdf") == 0;
+}
+
+/// .sdf files in dir, sorted so the output does not depend on the file system
+static void ListDemos(const string& dir, vector<string>& files)
+{
+	vector<string> found;
+#ifdef _WIN32
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA((dir + "\\*.sdf").c_str(), &fd);
+	if (h != INVALID_HANDLE_VALUE) {
+		do {
+			found.push_back(dir + "\\" + fd.cFileName);
+		} while (FindNextFileA(h, &fd));
+		FindClose(h);
+	}
+#else
+	DIR* dp = opendir(dir.c_str());
+	if (!dp)
+		return;
+	while (struct dirent* ep = readdir(dp)) {
+		if (IsDemoName(ep->d_name))
+			found.push_back(dir + "/" + ep->d_name);
+	}
+	closedir(dp);
+#endif
+	sort(found.begin(), found.end());
+	files.insert(files.end(), found.begin(), found.end());
+}
+
+/// Hands out the demos to the worker threads
+class BatchScan
+{
+public:
+	BatchScan(const vector<string>& files) : files(files), results(files.size()), next(0) {}
+
+	void Run(int numThreads)
+	{
+		RunWorkers(numThreads, boost::bind(&BatchScan::Worker, this));
+	}
+
+	const vector<DemoStats>& Results() const { return results; }
+
+private:
+	void Worker()
+	{
+		CDemoScanner scanner;
+		while (true) {
+			unsigned i;
+			{
+				boost::mutex::scoped_lock lock(nextMutex);
+				if (next >= files.size())
+					return;
+				i = next++;
+			}
+			scanner.Scan(files[i], results[i]);
+		}
+	}
+
+	const vector<string>& files;
+	vector<DemoStats> results;
+	boost::mutex nextMutex;
+	unsigned next;
+};
+
+static string CSVString(const string& s)
+{
+	string out = "\"";
+	for (unsigned i = 0; i < s.size(); ++i) {
+		if (s[i] == '"')
+			out += '"';
+		out += s[i];
+	}
+	return out + "\"";
+}
+
+static string JSONString(const string& s)
+{
+	string out = "\"";
+	for (unsigned i = 0; i < s.size(); ++i) {
+		const unsigned char c = s[i];
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (c < 0x20) {
+			char buf[8];
+			sprintf(buf, "\\u%04x", c);
+			out += buf;
+		} else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+/// build orders of all demos, per unit def id
+static vector<unsigned> TotalBuilds(const vector<DemoStats>& results)
+{
+	vector<unsigned> total;
+	for (unsigned d = 0; d < results.size(); ++d) {
+		const vector<unsigned>& b = results[d].buildCommands;
+		if (b.size() > total.size())
+			total.resize(b.size(), 0);
+		for (unsigned u = 0; u < b.size(); ++u)
+			total[u] += b[u];
+	}
+	return total;
+}
+
+static void WriteCSV(const string& prefix, const vector<DemoStats>& results)
+{
+	ofstream demos((prefix + "_demos.csv").c_str());
+	demos << "file,error,version,frames,gameTime,wallclockTime,winningAllyTeam,gameOver,compressed,packets,bytes,players,commands,avgAPM\n";
+	for (unsigned d = 0; d < results.size(); ++d) {
+		const DemoStats& s = results[d];
+		unsigned commands = 0, active = 0;
+		float apm = 0.0f;
+		for (unsigned p = 0; p < s.players.size(); ++p) {
+			commands += s.players[p].commands;
+			if (s.players[p].commands + s.players[p].selections > 0) {
+				apm += s.players[p].APM(s.frames);
+				++active;
+			}
+		}
+		demos << CSVString(s.file) << ',' << CSVString(s.error) << ',' << CSVString(s.version) << ','
+			<< s.frames << ',' << s.gameTime << ',' << s.wallclockTime << ',' << s.winningAllyTeam << ','
+			<< s.gameOver << ',' << s.compressed << ',' << s.packets << ',' << s.bytes << ','
+			<< s.players.size() << ',' << commands << ',' << (active ? apm / active : 0.0f) << '\n';
+	}
+
+	ofstream players((prefix + "_players.csv").c_str());
+	players << "file,player,name,commands,selections,chatMessages,leftFrame,apm\n";
+	for (unsigned d = 0; d < results.size(); ++d) {
+		const DemoStats& s = results[d];
+		for (unsigned p = 0; p < s.players.size(); ++p) {
+			const DemoPlayerStats& ps = s.players[p];
+			players << CSVString(s.file) << ',' << p << ',' << CSVString(ps.name) << ',' << ps.commands << ','
+				<< ps.selections << ',' << ps.chatMessages << ',' << ps.leftFrame << ',' << ps.APM(s.frames) << '\n';
+		}
+	}
+
+	ofstream builds((prefix + "_builds.csv").c_str());
+	builds << "unitDefID,count\n";
+	const vector<unsigned> total = TotalBuilds(results);
+	for (unsigned u = 0; u < total.size(); ++u) {
+		if (total[u] > 0)
+			builds << u << ',' << total[u] << '\n';
+	}
+}
+
+/// Write one column of a table
+template<typename T>
+static void JSONColumn(ostream& out, const char* name, const vector<T>& values, bool last = false)
+{
+	out << "\t\t\"" << name << "\": [";
+	for (unsigned i = 0; i < values.size(); ++i)
+		out << (i ? "," : "") << values[i];
+	out << "]" << (last ? "\n" : ",\n");
+}
+
+static void WriteJSON(const string& file, const vector<DemoStats>& results)
+{
+	ofstream out(file.c_str());
+
+	vector<string> names, errors, versions, gameOver, compressed;
+	vector<int> frames, gameTime, wallclockTime, winner;
+	vector<unsigned> packets, bytes;
+	for (unsigned d = 0; d < results.size(); ++d) {
+		const DemoStats& s = results[d];
+		names.push_back(JSONString(s.file));
+		errors.push_back(JSONString(s.error));
+		versions.push_back(JSONString(s.version));
+		frames.push_back(s.frames);
+		gameTime.push_back(s.gameTime);
+		wallclockTime.push_back(s.wallclockTime);
+		winner.push_back(s.winningAllyTeam);
+		gameOver.push_back(s.gameOver ? "true" : "false");
+		compressed.push_back(s.compressed ? "true" : "false");
+		packets.push_back(s.packets);
+		bytes.push_back(s.bytes);
+	}
+	out << "{\n\t\"demos\": {\n";
+	JSONColumn(out, "file", names);
+	JSONColumn(out, "error", errors);
+	JSONColumn(out, "version", versions);
+	JSONColumn(out, "frames", frames);
+	JSONColumn(out, "gameTime", gameTime);
+	JSONColumn(out, "wallclockTime", wallclockTime);
+	JSONColumn(out, "winningAllyTeam", winner);
+	JSONColumn(out, "gameOver", gameOver);
+	JSONColumn(out, "compressed", compressed);
+	JSONColumn(out, "packets", packets);
+	JSONColumn(out, "bytes", bytes, true);
+
+	vector<unsigned> demo, player, commands, selections, chat;
+	vector<int> leftFrame;
+	vector<string> playerNames;
+	vector<float> apm;
+	for (unsigned d = 0; d < results.size(); ++d) {
+		const DemoStats& s = results[d];
+		for (unsigned p = 0; p < s.players.size(); ++p) {
+			const DemoPlayerStats& ps = s.players[p];
+			demo.push_back(d);
+			player.push_back(p);
+			playerNames.push_back(JSONString(ps.name));
+			commands.push_back(ps.commands);
+			selections.push_back(ps.selections);
+			chat.push_back(ps.chatMessages);
+			leftFrame.push_back(ps.leftFrame);
+			apm.push_back(ps.APM(s.frames));
+		}
+	}
+	out << "\t},\n\t\"players\": {\n";
+	JSONColumn(out, "demo", demo);
+	JSONColumn(out, "player", player);
+	JSONColumn(out, "name", playerNames);
+	JSONColumn(out, "commands", commands);
+	JSONColumn(out, "selections", selections);
+	JSONColumn(out, "chatMessages", chat);
+	JSONColumn(out, "leftFrame", leftFrame);
+	JSONColumn(out, "apm", apm, true);
+
+	const vector<unsigned> total = TotalBuilds(results);
+	vector<unsigned> ids, counts;
+	for (unsigned u = 0; u < total.size(); ++u) {
+		if (total[u] > 0) {
+			ids.push_back(u);
+			counts.push_back(total[u]);
+		}
+	}
+	out << "\t},\n\t\"builds\": {\n";
+	JSONColumn(out, "unitDefID", ids);
+	JSONColumn(out, "count", counts, true);
+	out << "\t}\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int numThreads = 0;
+	string csvPrefix, jsonFile;
+	vector<string> files;
+
+	for (int i = 1; i < argc; ++i) {
+		const string arg = argv[i];
+		if (arg == "-j" && i + 1 < argc)
+			numThreads = atoi(argv[++i]);
+		else if (arg == "--csv" && i + 1 < argc)
+			csvPrefix = argv[++i];
+		else if (arg == "--json" && i + 1 < argc)
+			jsonFile = argv[++i];
+		else if (IsDirectory(arg))
+			ListDemos(arg, files);
+		else
+			files.push_back(arg);
+	}
+	if (files.empty()) {
+		cout << "usage: " << argv[0] << " [-j threads] [--csv prefix] [--json file] <demo or directory> ..." << endl;
+		return 1;
+	}
+	if (numThreads <= 0)
+		numThreads = GetHardwareThreadCount();
+
+	BatchScan scan(files);
+	scan.Run(min(numThreads, (int)files.size()));
+	const vector<DemoStats>& results = scan.Results();
+
+	int failed = 0;
+	for (unsigned d = 0; d < results.size(); ++d) {
+		if (!results[d].error.empty()) {
+			cerr << results[d].file << ": " << results[d].error << endl;
+			++failed;
+		}
+	}
+
+	if (!csvPrefix.empty())
+		WriteCSV(csvPrefix, results);
+	if (!jsonFile.empty())
+		WriteJSON(jsonFile, results);
+	if (csvPrefix.empty() && jsonFile.empty()) {
+		for (unsigned d = 0; d < results.size(); ++d) {
+			const DemoStats& s = results[d];
+			if (!s.error.empty())
+				continue;
+			cout << s.file << ": " << s.frames << " frames, winner " << s.winningAllyTeam << endl;
+			for (unsigned p = 0; p < s.players.size(); ++p) {
+				if (s.players[p].name[0])
+					cout << "\t" << s.players[p].name << ": " << s.players[p].APM(s.frames) << " APM" << endl;
+			}
+		}
+	}
+	cout << (results.size() - failed) << "/" << results.size() << " demos read with " << numThreads << " threads" << endl;
+	return 0;
+}
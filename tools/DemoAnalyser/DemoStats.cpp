@@ -0,0 +1,300 @@
+#include "DemoStats.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <algorithm>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../../rts/System/demofile.h"
+#include "BaseNetProtocol.h"
+
+namespace {
+
+const int gameSpeed = 30; // GAME_SPEED
+/// no mod comes close, a build command beyond it means the demo is corrupt
+const int maxUnitDefID = 32767;
+
+/**
+@brief Read-only view of a whole file
+mmap'd where available, read into memory otherwise.
+*/
+class MappedFile
+{
+public:
+	MappedFile(const std::string& name) : data(NULL), size(0)
+	{
+#ifdef _WIN32
+		FILE* f = fopen(name.c_str(), "rb");
+		if (!f)
+			return;
+		fseek(f, 0, SEEK_END);
+		const long len = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		if (len > 0) {
+			buffer.resize(len);
+			if (fread(&buffer[0], 1, len, f) == (size_t)len) {
+				data = &buffer[0];
+				size = len;
+			}
+		}
+		fclose(f);
+#else
+		const int fd = open(name.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				data = (const unsigned char*)p;
+				size = st.st_size;
+			}
+		}
+		close(fd); // the mapping stays valid
+#endif
+	}
+	~MappedFile()
+	{
+#ifndef _WIN32
+		if (data)
+			munmap((void*)data, size);
+#endif
+	}
+
+	const unsigned char* data;
+	unsigned size;
+
+private:
+#ifdef _WIN32
+	std::vector<unsigned char> buffer;
+#endif
+};
+
+template<typename T>
+T ReadAt(const unsigned char* p)
+{
+	T t;
+	memcpy(&t, p, sizeof(T)); // stream data is unaligned
+	return t;
+}
+
+}
+
+DemoPlayerStats::DemoPlayerStats()
+: commands(0)
+, selections(0)
+, chatMessages(0)
+, leftFrame(-1)
+{
+	name[0] = 0;
+}
+
+float DemoPlayerStats::APM(int frames) const
+{
+	if (frames <= 0)
+		return 0.0f;
+	return (commands + selections) * 60.0f * gameSpeed / frames;
+}
+
+DemoStats::DemoStats()
+: gameTime(0)
+, wallclockTime(0)
+, winningAllyTeam(-1)
+, compressed(false)
+, gameOver(false)
+, frames(0)
+, packets(0)
+, bytes(0)
+{
+}
+
+bool CDemoScanner::Scan(const std::string& file, DemoStats& stats)
+{
+	stats.file = file;
+
+	MappedFile f(file);
+	if (!f.data) {
+		stats.error = "cannot read file";
+		return false;
+	}
+	if (f.size < DEMOFILE_HEADER_SIZE_NOINDEX) {
+		stats.error = "file too short";
+		return false;
+	}
+
+	DemoFileHeader header;
+	memset(&header, 0, sizeof(header));
+	const unsigned headerSize = swabdword(ReadAt<int>(f.data + offsetof(DemoFileHeader, headerSize)));
+	memcpy(&header, f.data, std::min((unsigned)sizeof(header), std::min(headerSize, f.size)));
+	header.swab();
+
+	// unlike CDemoReader we don't care which spring version recorded the demo
+	if (memcmp(header.magic, DEMOFILE_MAGIC, sizeof(header.magic))
+			|| (header.version != DEMOFILE_VERSION && header.version != DEMOFILE_VERSION_3)
+			|| (header.version == DEMOFILE_VERSION_3 && header.streamCompression != DEMOFILE_COMPRESSION_NONE)
+			|| header.headerSize < (int)DEMOFILE_HEADER_SIZE_NOINDEX) {
+		stats.error = "not a demo or unsupported demo version";
+		return false;
+	}
+
+	const char* versionEnd = (const char*)memchr(header.versionString, 0, sizeof(header.versionString));
+	stats.version.assign(header.versionString, versionEnd ? versionEnd - header.versionString : sizeof(header.versionString));
+	stats.gameTime = header.gameTime;
+	stats.wallclockTime = header.wallclockTime;
+	stats.winningAllyTeam = header.winningAllyTeam;
+	stats.compressed = (header.streamCompression != DEMOFILE_COMPRESSION_NONE);
+
+	const unsigned streamStart = header.headerSize + header.scriptSize;
+	if (streamStart > f.size) {
+		stats.error = "truncated";
+		return false;
+	}
+	// demoStreamSize is 0 if spring crashed, the stream runs until EOF then
+	unsigned streamSize = f.size - streamStart;
+	if (header.demoStreamSize > 0 && (unsigned)header.demoStreamSize < streamSize)
+		streamSize = header.demoStreamSize;
+
+	bool streamOk = true;
+	if (header.streamCompression == DEMOFILE_COMPRESSION_NONE) {
+		streamOk = ParseStream(f.data + streamStart, streamSize, stats);
+	} else if (header.streamCompression == DEMOFILE_COMPRESSION_ZLIB) {
+		if (!Inflate(f.data + streamStart, streamSize, header.demoStreamSize > 0)) {
+			stats.error = "corrupt compressed stream";
+			return false;
+		}
+		if (!streamBuffer.empty())
+			streamOk = ParseStream(&streamBuffer[0], streamBuffer.size(), stats);
+	} else {
+		stats.error = "unknown stream compression";
+		return false;
+	}
+	if (!streamOk) {
+		stats.error = "corrupt demo stream";
+		return false;
+	}
+	return true;
+}
+
+bool CDemoScanner::Inflate(const unsigned char* data, unsigned size, bool sizeKnown)
+{
+	streamBuffer.clear();
+	unsigned pos = 0;
+	while (pos + sizeof(DemoStreamBlockHeader) <= size) {
+		DemoStreamBlockHeader header = ReadAt<DemoStreamBlockHeader>(data + pos);
+		header.swab();
+		pos += sizeof(header);
+		if (header.rawSize <= 0 || header.compressedSize <= 0 || (unsigned)header.compressedSize > size - pos)
+			return !sizeKnown; // a crash may have cut off the last block
+		if (header.rawSize > DEMOFILE_MAX_BLOCK_SIZE)
+			return false;
+
+		const unsigned start = streamBuffer.size();
+		streamBuffer.resize(start + header.rawSize);
+		uLongf rawSize = header.rawSize;
+		if (uncompress(&streamBuffer[start], &rawSize, data + pos, header.compressedSize) != Z_OK || (int)rawSize != header.rawSize)
+			return false;
+		pos += header.compressedSize;
+	}
+	return true;
+}
+
+bool CDemoScanner::ParseStream(const unsigned char* stream, unsigned size, DemoStats& stats)
+{
+	unsigned pos = 0;
+	while (pos + sizeof(DemoStreamChunkHeader) <= size) {
+		DemoStreamChunkHeader chunk = ReadAt<DemoStreamChunkHeader>(stream + pos);
+		chunk.swab();
+		pos += sizeof(chunk);
+		if (chunk.length == 0 || chunk.length > size - pos)
+			break; // crashed while writing this one
+
+		if (!ParsePacket(stream + pos, chunk.length, stats))
+			return false;
+		pos += chunk.length;
+	}
+	return true;
+}
+
+bool CDemoScanner::ParsePacket(const unsigned char* data, unsigned length, DemoStats& stats)
+{
+	stats.packets++;
+	stats.bytes += length;
+
+	// the player number of player messages, see CBaseNetProtocol for the layouts
+	int player = -1;
+	switch (data[0])
+	{
+		case NETMSG_KEYFRAME:
+		case NETMSG_NEWFRAME:
+			stats.frames++;
+			return true;
+		case NETMSG_GAMEOVER:
+			stats.gameOver = true;
+			return true;
+		case NETMSG_PLAYERNAME:
+		case NETMSG_CHAT:
+			if (length >= 3)
+				player = data[2];
+			break;
+		case NETMSG_COMMAND:
+		case NETMSG_SELECT:
+			if (length >= 4)
+				player = data[3];
+			break;
+		case NETMSG_PLAYERLEFT:
+			if (length >= 2)
+				player = data[1];
+			break;
+		default:
+			return true;
+	}
+	if (player < 0)
+		return true;
+
+	if (player >= (int)stats.players.size())
+		stats.players.resize(player + 1);
+	DemoPlayerStats& p = stats.players[player];
+
+	switch (data[0])
+	{
+		case NETMSG_PLAYERNAME: {
+			const unsigned n = std::min(length - 3, (unsigned)sizeof(p.name) - 1);
+			memcpy(p.name, data + 3, n);
+			p.name[n] = 0;
+			break;
+		}
+		case NETMSG_CHAT:
+			p.chatMessages++;
+			break;
+		case NETMSG_COMMAND:
+			p.commands++;
+			if (length >= 8) {
+				const int id = ReadAt<int>(data + 4);
+				if (id < 0) {
+					if (id < -maxUnitDefID)
+						return false;
+					if (-id >= (int)stats.buildCommands.size())
+						stats.buildCommands.resize(-id + 1, 0);
+					stats.buildCommands[-id]++;
+				}
+			}
+			break;
+		case NETMSG_SELECT:
+			p.selections++;
+			break;
+		case NETMSG_PLAYERLEFT:
+			p.leftFrame = stats.frames;
+			break;
+	}
+	return true;
+}
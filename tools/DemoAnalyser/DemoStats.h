@@ -0,0 +1,81 @@
+#ifndef DEMOSTATS_H
+#define DEMOSTATS_H
+
+#include <string>
+#include <vector>
+
+/**
+@brief Per player numbers gathered from one demo
+*/
+struct DemoPlayerStats
+{
+	DemoPlayerStats();
+
+	/// from NETMSG_PLAYERNAME, empty if the player never connected
+	char name[32];
+	/// NETMSG_COMMAND sent by this player
+	unsigned commands;
+	/// NETMSG_SELECT sent by this player
+	unsigned selections;
+	unsigned chatMessages;
+	/// frame of NETMSG_PLAYERLEFT, -1 if the player stayed
+	int leftFrame;
+
+	/// commands and selections per minute of game time
+	float APM(int frames) const;
+};
+
+/**
+@brief Numbers gathered from one demo by CDemoScanner
+*/
+struct DemoStats
+{
+	DemoStats();
+
+	std::string file;
+	/// empty if the demo was read, reason otherwise
+	std::string error;
+
+	std::string version;
+	int gameTime;
+	int wallclockTime;
+	int winningAllyTeam;
+	bool compressed;
+	/// the stream ended with NETMSG_GAMEOVER
+	bool gameOver;
+
+	/// NETMSG_NEWFRAME and NETMSG_KEYFRAME in the stream
+	int frames;
+	unsigned packets;
+	unsigned bytes;
+
+	/// indexed by player number, players up to the highest one seen
+	std::vector<DemoPlayerStats> players;
+	/// build orders (negative command ids) indexed by unit def id
+	std::vector<unsigned> buildCommands;
+};
+
+/**
+@brief Reads demos without going through the VFS
+Demo files are mapped into memory and their stream is decoded in place
+(compressed demos are inflated into a buffer which is reused for every demo),
+so scanning does not allocate per packet. One scanner per thread.
+*/
+class CDemoScanner
+{
+public:
+	/// @return false if the file is no demo we can read (stats.error says why)
+	bool Scan(const std::string& file, DemoStats& stats);
+
+private:
+	/// inflate the blocks of a compressed stream into streamBuffer
+	bool Inflate(const unsigned char* data, unsigned size, bool sizeKnown);
+	/// @return false if a packet makes no sense (see ParsePacket)
+	bool ParseStream(const unsigned char* stream, unsigned size, DemoStats& stats);
+	/// @return false if the packet can only come from a corrupt demo
+	bool ParsePacket(const unsigned char* data, unsigned length, DemoStats& stats);
+
+	std::vector<unsigned char> streamBuffer;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <string>
 #include <iostream>
 #include <limits>
+#include <stdlib.h>
 
 #include "../../rts/System/DemoReader.h"
 #include "System/FileSystem/FileSystem.h"
@@ -14,7 +15,9 @@ using namespace netcode;
 
 /*
 Usage:
-Start with the full! path to the demofile as the only argument
+Start with the full! path to the demofile as the first argument,
+optionally followed by the frame to start at (uses the demo's keyframe index,
+from the start of the demo if it has none)
 
 Please note that not all NETMSG's are implemented, expand if needed.
 */
@@ -27,6 +30,11 @@ int main (int argc, char* argv[])
 
 	CDemoReader reader(string(argv[1]), 0.0f);
 	DemoFileHeader header = reader.GetFileHeader();
+	if (argc > 2)
+	{
+		const int frame = reader.SeekToFrame(atoi(argv[2]), 0.0f);
+		cout << "Starting at frame " << frame << (reader.HasIndex() ? "" : " (no index)") << endl;
+	}
 	
 	while (!reader.ReachedEnd())
 	{
@@ -324,7 +324,7 @@ static void read_demofile(ScopedMessage& message, const Path& source_file)
 	// Check whether the DemoFileHeader contains the right magic,
 	// is of the right version and the right size.
 	if (memcmp(fileHeader.magic, DEMOFILE_MAGIC, sizeof(fileHeader.magic)) ||
-			fileHeader.version != DEMOFILE_VERSION ||
+			(fileHeader.version != DEMOFILE_VERSION && fileHeader.version != DEMOFILE_VERSION_3) ||
 			fileHeader.headerSize != sizeof(DemoFileHeader) ||
 			fileHeader.playerStatElemSize != sizeof(PlayerStatistics) ||
 			fileHeader.teamStatElemSize != sizeof(TeamStatistics)) {
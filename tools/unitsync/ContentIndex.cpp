@@ -0,0 +1,360 @@
+#include "StdAfx.h"
+#include "ContentIndex.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <boost/bind.hpp>
+
+#include "System/exportdefines.h"
+#include "unitsync_api.h"
+#include "FileSystem/ArchiveFactory.h"
+#include "FileSystem/CacheFile.h"
+#include "FileSystem/CRC.h"
+#include "FileSystem/FileSystem.h"
+#include "Game/GameVersion.h"
+#include "Map/SMF/mapfile.h"
+#include "LogOutput.h"
+#include "Util.h"
+#include "WorkerThreads.h"
+
+/// change when the layout of the cache files changes
+static const unsigned int formatVersion = 1;
+
+#define RM	0x0000F800
+#define GM  0x000007E0
+#define BM  0x0000001F
+
+#define RED_RGB565(x) ((x&RM)>>11)
+#define GREEN_RGB565(x) ((x&GM)>>5)
+#define BLUE_RGB565(x) (x&BM)
+#define PACKRGB(r, g, b) (((r<<11)&RM) | ((g << 5)&GM) | (b&BM) )
+
+
+int GetSMFMinimapOffset(int miplevel, int* size)
+{
+	int mipsize = 1024;
+	int offset = 0;
+
+	for ( int i = 0; i < miplevel; i++ ) {
+		offset += ((mipsize+3)/4)*((mipsize+3)/4)*8;
+		mipsize >>= 1;
+	}
+
+	*size = ((mipsize+3)/4)*((mipsize+3)/4)*8;
+	return offset;
+}
+
+
+void DecodeSMFMinimap(const unsigned char* dxt, int mipsize, unsigned short* colors)
+{
+	const int numblocks = ((mipsize+3)/4)*((mipsize+3)/4);
+	const unsigned char* temp = dxt;
+
+	for ( int i = 0; i < numblocks; i++ ) {
+		unsigned short color0 = (*(unsigned short*)&temp[0]);
+		unsigned short color1 = (*(unsigned short*)&temp[2]);
+		unsigned int bits = (*(unsigned int*)&temp[4]);
+
+		for ( int a = 0; a < 4; a++ ) {
+			for ( int b = 0; b < 4; b++ ) {
+				int x = 4*(i % ((mipsize+3)/4))+b;
+				int y = 4*(i / ((mipsize+3)/4))+a;
+				unsigned char code = bits & 0x3;
+				bits >>= 2;
+
+				if ( color0 > color1 ) {
+					if ( code == 0 ) {
+						colors[y*mipsize+x] = color0;
+					}
+					else if ( code == 1 ) {
+						colors[y*mipsize+x] = color1;
+					}
+					else if ( code == 2 ) {
+						colors[y*mipsize+x] = PACKRGB((2*RED_RGB565(color0)+RED_RGB565(color1))/3, (2*GREEN_RGB565(color0)+GREEN_RGB565(color1))/3, (2*BLUE_RGB565(color0)+BLUE_RGB565(color1))/3);
+					}
+					else {
+						colors[y*mipsize+x] = PACKRGB((2*RED_RGB565(color1)+RED_RGB565(color0))/3, (2*GREEN_RGB565(color1)+GREEN_RGB565(color0))/3, (2*BLUE_RGB565(color1)+BLUE_RGB565(color0))/3);
+					}
+				}
+				else {
+					if ( code == 0 ) {
+						colors[y*mipsize+x] = color0;
+					}
+					else if ( code == 1 ) {
+						colors[y*mipsize+x] = color1;
+					}
+					else if ( code == 2 ) {
+						colors[y*mipsize+x] = PACKRGB((RED_RGB565(color0)+RED_RGB565(color1))/2, (GREEN_RGB565(color0)+GREEN_RGB565(color1))/2, (BLUE_RGB565(color0)+BLUE_RGB565(color1))/2);
+					}
+					else {
+						colors[y*mipsize+x] = 0;
+					}
+				}
+			}
+		}
+		temp += 8;
+	}
+}
+
+
+//////////////////////////
+//////////////////////////
+
+CContentIndex::CContentIndex() : miplevel(0), nextMinimapJob(0)
+{
+	memset(&index, 0, sizeof(index));
+}
+
+
+std::string CContentIndex::CacheKey(const Map& map) const
+{
+	char buf[64];
+	sprintf(buf, "%u\n%u\n%d\n", formatVersion, map.checksum, miplevel);
+	return SpringVersion::GetFull() + "\n" + buf + map.name;
+}
+
+
+std::string CContentIndex::CacheFile(const std::string& key)
+{
+	char filename[64];
+	sprintf(filename, "cache/unitsync/%08x.bin", CRC().Update(key.data(), key.size()).GetDigest());
+	return filename;
+}
+
+
+bool CContentIndex::LoadCached(Map& map) const
+{
+	const std::string key = CacheKey(map);
+	CCacheBlob in;
+	if (!LoadCacheFile(filesystem.LocateFile(CacheFile(key)), key, in.GetData())) {
+		return false;
+	}
+
+	MapInfo& info = map.info;
+	in.GetString(map.description);
+	in.GetString(map.author);
+	in.Get(info.tidalStrength);
+	in.Get(info.gravity);
+	in.Get(info.maxMetal);
+	in.Get(info.extractorRadius);
+	in.Get(info.minWind);
+	in.Get(info.maxWind);
+	in.Get(info.width);
+	in.Get(info.height);
+	in.Get(info.posCount);
+	if (info.posCount < 0 || info.posCount > 16) {
+		return false;
+	}
+	in.Read(info.positions, info.posCount * sizeof(StartPos));
+	in.GetVector(map.minimap);
+	return in.AtEnd();
+}
+
+
+void CContentIndex::SaveCached(const Map& map) const
+{
+	const MapInfo& info = map.info;
+	CCacheBlob out;
+	out.PutString(map.description);
+	out.PutString(map.author);
+	out.Put(info.tidalStrength);
+	out.Put(info.gravity);
+	out.Put(info.maxMetal);
+	out.Put(info.extractorRadius);
+	out.Put(info.minWind);
+	out.Put(info.maxWind);
+	out.Put(info.width);
+	out.Put(info.height);
+	out.Put(info.posCount);
+	out.Write(info.positions, info.posCount * sizeof(StartPos));
+	out.PutVector(map.minimap);
+
+	if (!filesystem.CreateDirectory("cache/unitsync")) {
+		return;
+	}
+	const std::string key = CacheKey(map);
+	SaveCacheFile(filesystem.LocateFile(CacheFile(key), FileSystem::WRITE), key, out.GetData());
+}
+
+
+/*
+ * Runs on the worker threads, so only the map's own archive is used
+ * (the first one of GetArchivesForMap) and neither the VFS nor the log.
+ */
+void CContentIndex::ReadMinimap(Map& map) const
+{
+	std::auto_ptr<CArchiveBase> ar(CArchiveFactory::OpenArchive(map.archives[0]));
+	if (!ar.get()) {
+		return;
+	}
+	const int fh = ar->OpenFile("maps/" + map.name);
+	if (fh == 0) {
+		return;
+	}
+
+	int size;
+	const int offset = GetSMFMinimapOffset(miplevel, &size);
+	const int mipsize = 1024 >> miplevel;
+
+	SMFHeader mh;
+	std::vector<unsigned char> buffer(size);
+	if (ar->ReadFile(fh, &mh, sizeof(mh)) == sizeof(mh)
+			&& strcmp(mh.magic, "spring map file") == 0
+			&& mh.minimapPtr > 0 && mh.minimapPtr + offset + size <= ar->FileSize(fh)) {
+		ar->Seek(fh, mh.minimapPtr + offset);
+		if (ar->ReadFile(fh, &buffer[0], size) == size) {
+			map.minimap.resize(mipsize * mipsize);
+			DecodeSMFMinimap(&buffer[0], mipsize, &map.minimap[0]);
+		}
+	}
+	ar->CloseFile(fh);
+}
+
+
+void CContentIndex::MinimapWorker()
+{
+	while (true) {
+		unsigned job;
+		{
+			boost::mutex::scoped_lock lock(minimapMutex);
+			if (nextMinimapJob >= minimapJobs.size())
+				return;
+			job = minimapJobs[nextMinimapJob++];
+		}
+		try {
+			ReadMinimap(maps[job]);
+		} catch (const std::exception&) {
+			// GetMinimap tries again on the calling thread
+		}
+	}
+}
+
+
+void CContentIndex::ReadMapInfos(const std::vector<unsigned>* misses)
+{
+	std::vector<char> description(256), author(201);
+	for (unsigned m = 0; m < misses->size(); ++m) {
+		Map& map = maps[(*misses)[m]];
+		map.info.description = &description[0];
+		map.info.author = &author[0];
+		description[0] = author[0] = 0;
+		const bool valid = !!GetMapInfoEx(map.name.c_str(), &map.info, 1);
+		(valid ? map.description : map.error) = &description[0];
+		map.author = &author[0];
+		if (map.error.empty() && !valid) {
+			map.error = "unknown error";
+		}
+	}
+
+	// then this thread is the last worker
+	MinimapWorker();
+}
+
+
+const ContentIndex* CContentIndex::Update(const std::vector<std::string>& mapNames,
+                                          const std::vector<CArchiveScanner::ModData>& modData, int miplevel)
+{
+	this->miplevel = miplevel;
+
+	// look everything up in the cache
+	maps.clear();
+	maps.resize(mapNames.size());
+	minimapJobs.clear();
+	nextMinimapJob = 0;
+	std::vector<unsigned> misses;
+	for (unsigned i = 0; i < maps.size(); ++i) {
+		Map& map = maps[i];
+		memset(&map.info, 0, sizeof(map.info));
+		map.name = mapNames[i];
+		map.archives = archiveScanner->GetArchivesForMap(map.name);
+		map.checksum = map.archives.empty() ? 0 : archiveScanner->GetMapChecksum(map.name);
+		map.cached = (map.checksum != 0) && LoadCached(map);
+		if (map.cached) {
+			continue;
+		}
+		map.description.clear();
+		map.author.clear();
+		map.minimap.clear();
+		misses.push_back(i);
+		if (!map.archives.empty() && StringToLower(map.name.substr(map.name.find_last_of('.') + 1)) == "smf") {
+			minimapJobs.push_back(i);
+		}
+	}
+	logOutput.Print("content index: %u of %u maps cached", (unsigned)(maps.size() - misses.size()), (unsigned)maps.size());
+
+	// the workers read the SMF minimaps while this thread parses the map infos
+	RunWorkers(std::min(GetWorkerThreadCount(), (int)minimapJobs.size()),
+		boost::bind(&CContentIndex::MinimapWorker, this),
+		boost::bind(&CContentIndex::ReadMapInfos, this, &misses));
+
+	const int mipsize = 1024 >> miplevel;
+	for (unsigned m = 0; m < misses.size(); ++m) {
+		Map& map = maps[misses[m]];
+		if (!map.error.empty()) {
+			continue;
+		}
+		if (map.minimap.empty()) {
+			// SM3, outside of an archive or failed on the worker
+			const unsigned short* minimap = (const unsigned short*)GetMinimap(map.name.c_str(), miplevel);
+			if (minimap) {
+				map.minimap.assign(minimap, minimap + mipsize * mipsize);
+			}
+		}
+		if (map.checksum != 0) {
+			SaveCached(map);
+		}
+	}
+
+	// the mods are cached by the archive scanner already
+	mods.clear();
+	mods.resize(modData.size());
+	for (unsigned i = 0; i < mods.size(); ++i) {
+		Mod& mod = mods[i];
+		mod.data = modData[i];
+		const std::string& archive = mod.data.dependencies[0];
+		mod.checksum = archiveScanner->GetModChecksum(archive);
+		mod.archives = archiveScanner->GetArchives(archive);
+		mod.archiveNames.clear();
+		for (unsigned a = 0; a < mod.archives.size(); ++a) {
+			mod.archiveNames.push_back(mod.archives[a].c_str());
+		}
+	}
+
+	mapEntries.resize(maps.size());
+	for (unsigned i = 0; i < maps.size(); ++i) {
+		Map& map = maps[i];
+		MapIndexEntry& entry = mapEntries[i];
+		entry.name = map.name.c_str();
+		entry.checksum = map.checksum;
+		entry.error = map.error.empty() ? NULL : map.error.c_str();
+		entry.info = map.info;
+		entry.info.description = const_cast<char*>(map.description.c_str());
+		entry.info.author = const_cast<char*>(map.author.c_str());
+		entry.minimap = map.minimap.empty() ? NULL : &map.minimap[0];
+	}
+	modEntries.resize(mods.size());
+	for (unsigned i = 0; i < mods.size(); ++i) {
+		const Mod& mod = mods[i];
+		ModIndexEntry& entry = modEntries[i];
+		entry.name = mod.data.name.c_str();
+		entry.shortName = mod.data.shortName.c_str();
+		entry.version = mod.data.version.c_str();
+		entry.mutator = mod.data.mutator.c_str();
+		entry.game = mod.data.game.c_str();
+		entry.shortGame = mod.data.shortGame.c_str();
+		entry.description = mod.data.description.c_str();
+		entry.archive = mod.data.dependencies[0].c_str();
+		entry.checksum = mod.checksum;
+		entry.archiveCount = mod.archiveNames.size();
+		entry.archives = mod.archiveNames.empty() ? NULL : &mod.archiveNames[0];
+	}
+
+	index.miplevel = miplevel;
+	index.mapCount = mapEntries.size();
+	index.maps = mapEntries.empty() ? NULL : &mapEntries[0];
+	index.modCount = modEntries.size();
+	index.mods = modEntries.empty() ? NULL : &modEntries[0];
+	return &index;
+}
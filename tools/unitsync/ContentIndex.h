@@ -0,0 +1,89 @@
+#ifndef CONTENTINDEX_H
+#define CONTENTINDEX_H
+
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+#include "unitsync.h"
+#include "FileSystem/ArchiveScanner.h"
+
+/// Byte offset and size of a miplevel in the dxt1 compressed SMF minimap
+int GetSMFMinimapOffset(int miplevel, int* size);
+/// Decode one miplevel of the SMF minimap to RGB-565, mipsize pixels square
+void DecodeSMFMinimap(const unsigned char* dxt, int mipsize, unsigned short* colors);
+
+/**
+@brief Storage and disk cache behind GetContentIndex
+The metadata of every map is stored in cache/unitsync/, keyed by the
+checksum of its archives and the minimap miplevel, so refreshing the index
+only reads the maps that were added or changed since. For the maps not in
+the cache, worker threads read the SMF minimaps straight from the map
+archives while the calling thread parses the map infos, which needs the VFS.
+*/
+class CContentIndex
+{
+public:
+	CContentIndex();
+
+	/**
+	@brief Gather the metadata of all maps and mods
+	@param mapNames as listed by GetMapCount
+	@param mods as listed by GetPrimaryModCount
+	@return valid until the next call
+	*/
+	const ContentIndex* Update(const std::vector<std::string>& mapNames,
+	                           const std::vector<CArchiveScanner::ModData>& mods, int miplevel);
+
+private:
+	struct Map
+	{
+		std::string name;
+		/// 0 for maps outside of archives, these are not cached
+		unsigned int checksum;
+		/// archives holding the map and its dependencies
+		std::vector<std::string> archives;
+		/// empty if the map info was read
+		std::string error;
+		std::string description;
+		std::string author;
+		/// description and author point nowhere until Update returns
+		MapInfo info;
+		/// empty if the minimap could not be read
+		std::vector<unsigned short> minimap;
+		bool cached;
+	};
+	struct Mod
+	{
+		CArchiveScanner::ModData data;
+		unsigned int checksum;
+		std::vector<std::string> archives;
+		std::vector<const char*> archiveNames;
+	};
+
+	bool LoadCached(Map& map) const;
+	void SaveCached(const Map& map) const;
+	std::string CacheKey(const Map& map) const;
+	static std::string CacheFile(const std::string& key);
+
+	/// read the minimaps of the queued maps until none is left
+	void MinimapWorker();
+	/// GetMapInfoEx for maps[misses], then help with the minimaps
+	void ReadMapInfos(const std::vector<unsigned>* misses);
+	void ReadMinimap(Map& map) const;
+
+	int miplevel;
+	std::vector<Map> maps;
+	std::vector<Mod> mods;
+
+	/// indices of the maps whose minimap is read by the workers
+	std::vector<unsigned> minimapJobs;
+	unsigned nextMinimapJob;
+	boost::mutex minimapMutex;
+
+	std::vector<MapIndexEntry> mapEntries;
+	std::vector<ModIndexEntry> modEntries;
+	ContentIndex index;
+};
+
+#endif // CONTENTINDEX_H
@@ -29,6 +29,7 @@
 
 
 // unitsync only:
+#include "ContentIndex.h"
 #include "LuaParserAPI.h"
 #include "Syncer.h"
 
@@ -811,11 +812,6 @@ EXPORT(unsigned int) GetMapChecksumFromName(const char* mapName)
 #define GM  0x000007E0
 #define BM  0x0000001F
 
-#define RED_RGB565(x) ((x&RM)>>11)
-#define GREEN_RGB565(x) ((x&GM)>>5)
-#define BLUE_RGB565(x) (x&BM)
-#define PACKRGB(r, g, b) (((r<<11)&RM) | ((g << 5)&GM) | (b&BM) )
-
 // Used to return the image
 static char* imgbuf[1024*1024*2];
 
@@ -858,19 +854,8 @@ static void* GetMinimapSM3(string mapName, int miplevel)
 
 static void* GetMinimapSMF(string mapName, int miplevel)
 {
-	// Calculate stuff
-
-	int mipsize = 1024;
-	int offset = 0;
-
-	for ( int i = 0; i < miplevel; i++ ) {
-		int size = ((mipsize+3)/4)*((mipsize+3)/4)*8;
-		offset += size;
-		mipsize >>= 1;
-	}
-
-	int size = ((mipsize+3)/4)*((mipsize+3)/4)*8;
-	int numblocks = size/8;
+	int size;
+	const int offset = GetSMFMinimapOffset(miplevel, &size);
 
 	// Read the map data
 	CFileHandler in("maps/" + mapName);
@@ -886,59 +871,9 @@ static void* GetMinimapSMF(string mapName, int miplevel)
 	in.Seek(mh.minimapPtr + offset);
 	in.Read(buffer, size);
 
-	// Do stuff
-
-	void* ret = (void*)imgbuf;
-	unsigned short* colors = (unsigned short*)ret;
-
-	unsigned char* temp = buffer;
-
-	for ( int i = 0; i < numblocks; i++ ) {
-		unsigned short color0 = (*(unsigned short*)&temp[0]);
-		unsigned short color1 = (*(unsigned short*)&temp[2]);
-		unsigned int bits = (*(unsigned int*)&temp[4]);
-
-		for ( int a = 0; a < 4; a++ ) {
-			for ( int b = 0; b < 4; b++ ) {
-				int x = 4*(i % ((mipsize+3)/4))+b;
-				int y = 4*(i / ((mipsize+3)/4))+a;
-				unsigned char code = bits & 0x3;
-				bits >>= 2;
-
-				if ( color0 > color1 ) {
-					if ( code == 0 ) {
-						colors[y*mipsize+x] = color0;
-					}
-					else if ( code == 1 ) {
-						colors[y*mipsize+x] = color1;
-					}
-					else if ( code == 2 ) {
-						colors[y*mipsize+x] = PACKRGB((2*RED_RGB565(color0)+RED_RGB565(color1))/3, (2*GREEN_RGB565(color0)+GREEN_RGB565(color1))/3, (2*BLUE_RGB565(color0)+BLUE_RGB565(color1))/3);
-					}
-					else {
-						colors[y*mipsize+x] = PACKRGB((2*RED_RGB565(color1)+RED_RGB565(color0))/3, (2*GREEN_RGB565(color1)+GREEN_RGB565(color0))/3, (2*BLUE_RGB565(color1)+BLUE_RGB565(color0))/3);
-					}
-				}
-				else {
-					if ( code == 0 ) {
-						colors[y*mipsize+x] = color0;
-					}
-					else if ( code == 1 ) {
-						colors[y*mipsize+x] = color1;
-					}
-					else if ( code == 2 ) {
-						colors[y*mipsize+x] = PACKRGB((RED_RGB565(color0)+RED_RGB565(color1))/2, (GREEN_RGB565(color0)+GREEN_RGB565(color1))/2, (BLUE_RGB565(color0)+BLUE_RGB565(color1))/2);
-					}
-					else {
-						colors[y*mipsize+x] = 0;
-					}
-				}
-			}
-		}
-		temp += 8;
-	}
+	DecodeSMFMinimap(buffer, 1024 >> miplevel, (unsigned short*)imgbuf);
 	free(buffer);
-	return (void*)ret;
+	return (void*)imgbuf;
 }
 
 /**
@@ -1393,6 +1328,49 @@ EXPORT(unsigned int) GetPrimaryModChecksumFromName(const char* name)
 }
 
 
+//////////////////////////
+//////////////////////////
+
+static CContentIndex contentIndex;
+
+
+/**
+ * @brief Retrieve the metadata of all maps and mods in one call
+ * @param miplevel Which miplevel of the minimaps to return, see GetMinimap()
+ * @return NULL on error; the metadata of all maps and mods on success
+ *
+ * This is equivalent to calling GetMapCount(), GetMapChecksum(),
+ * GetMapInfoEx() with version 1 and GetMinimap() for every map, and
+ * GetPrimaryModCount() and the GetPrimaryMod* functions for every mod, and
+ * it updates the map and mod lists used by those functions the same way.
+ *
+ * The map metadata is cached on disk per map archive checksum and miplevel,
+ * so only new or changed maps are read. Their minimaps are read by
+ * HardwareThreadCount threads while the map infos are parsed.
+ * Maps which could not be read have their error set and no other metadata.
+ *
+ * The returned memory belongs to unitsync and stays valid until the next
+ * call of GetContentIndex(). A 1024x1024 minimap takes 2 MB, so a large
+ * content index should use a miplevel of 2 or more.
+ */
+EXPORT(const ContentIndex*) GetContentIndex(int miplevel)
+{
+	try {
+		CheckInit();
+
+		if (miplevel < 0 || miplevel > 8)
+			throw std::out_of_range("Miplevel must be between 0 and 8 (inclusive) in GetContentIndex.");
+
+		GetMapCount(); // updates mapNames
+		modData = archiveScanner->GetPrimaryMods();
+
+		return contentIndex.Update(mapNames, modData, miplevel);
+	}
+	UNITSYNC_CATCH_BLOCKS;
+	return NULL;
+}
+
+
 //////////////////////////
 //////////////////////////
 
@@ -56,6 +56,54 @@ enum BitmapType {
 	bm_grayscale_16 = 2  ///< 16 bits per pixel grayscale bitmap
 };
 
+
+/**
+ * @brief Metadata of a map in the content index
+ * @sa GetContentIndex
+ */
+struct MapIndexEntry
+{
+	const char* name;      ///< Name of the map, e.g. "SmallDivide.smf"
+	unsigned int checksum; ///< Same as GetMapChecksumFromName(name)
+	const char* error;     ///< NULL if the map was read; why not otherwise (info is not filled then)
+	MapInfo info;          ///< Same as filled by GetMapInfoEx(name, &info, 1)
+	const void* minimap;   ///< Same as returned by GetMinimap(name, miplevel); NULL if it could not be read
+};
+
+
+/**
+ * @brief Metadata of a mod in the content index
+ * @sa GetContentIndex
+ */
+struct ModIndexEntry
+{
+	const char* name;        ///< Same as GetPrimaryModName
+	const char* shortName;   ///< Same as GetPrimaryModShortName
+	const char* version;     ///< Same as GetPrimaryModVersion
+	const char* mutator;     ///< Same as GetPrimaryModMutator
+	const char* game;        ///< Same as GetPrimaryModGame
+	const char* shortGame;   ///< Same as GetPrimaryModShortGame
+	const char* description; ///< Same as GetPrimaryModDescription
+	const char* archive;     ///< Same as GetPrimaryModArchive
+	unsigned int checksum;   ///< Same as GetPrimaryModChecksum
+	int archiveCount;        ///< Same as GetPrimaryModArchiveCount
+	const char* const* archives; ///< Same as GetPrimaryModArchiveList for 0 to archiveCount-1
+};
+
+
+/**
+ * @brief Metadata of all maps and mods
+ * @sa GetContentIndex
+ */
+struct ContentIndex
+{
+	int miplevel;                ///< Miplevel of the minimaps
+	int mapCount;                ///< Same as GetMapCount
+	const MapIndexEntry* maps;   ///< In the order of GetMapName
+	int modCount;                ///< Same as GetPrimaryModCount
+	const ModIndexEntry* mods;   ///< In the order of GetPrimaryModName
+};
+
 /** @} */
 
 
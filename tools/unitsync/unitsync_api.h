@@ -55,6 +55,8 @@ EXPORT(int         ) GetPrimaryModIndex(const char* name);
 EXPORT(unsigned int) GetPrimaryModChecksum(int index);
 EXPORT(unsigned int) GetPrimaryModChecksumFromName(const char* name);
 
+EXPORT(const ContentIndex*) GetContentIndex(int miplevel);
+
 EXPORT(int         ) GetSideCount();
 EXPORT(const char* ) GetSideName(int side);
 EXPORT(const char* ) GetSideStartUnit(int side);